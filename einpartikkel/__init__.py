@@ -19,4 +19,4 @@ sys.path.append(PypropLocation)
 from utils import ProjectNamespace
 
 __all__ = ["analysis", "core", "eigenvalues", "utils", "quantumnumbers",\
-"namegenerator"]
+"namegenerator", "instrumentation", "memoryledger"]
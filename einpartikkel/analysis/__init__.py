@@ -6,5 +6,5 @@ Subpackage for performing various analysis tasks for EinPartikkel problems.
 
 """
 
-__all__ = ["analysis", "above", "namegenerator", "eigenstates", "coulombwaves"]
+__all__ = ["analysis", "above", "namegenerator", "eigenstates", "coulombwaves", "parallel", "perturbation"]
 
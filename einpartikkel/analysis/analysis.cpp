@@ -3,12 +3,17 @@
 #include <gsl/gsl_sf_gamma.h>
 #include <gsl/gsl_errno.h>
 
+#include "../core/instrumentation.h"
+
 /*
  * Sets the radial Coulomb wave F_l(k*r, eta), with eta = Z/k into data for all radial
  * grid points specified by r
  */
 void SetRadialCoulombWave(int Z, int l, double k, blitz::Array<double, 1> r, blitz::Array<double, 1> data)
 {
+	INSTRUMENT_SCOPE("SetRadialCoulombWave");
+	INSTRUMENT_BYTES("SetRadialCoulombWave", data.size() * sizeof(double));
+
 	double eta = Z / k;
 
 	for (int i=0; i<r.size(); i++)
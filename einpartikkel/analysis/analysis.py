@@ -4,6 +4,10 @@ from numpy import conj, dot, abs, diff, r_, zeros, double, complex, array, linsp
 from numpy import maximum, sum, arctan2, imag, real, outer, sqrt, cos, sin, exp, shape
 import eigenstates
 import coulombwaves
+import boundstates
+from ..core.overlap import GetOverlapPsi, InvalidateOverlap
+from ..core.layout import ApplyWavefunctionLayout, GetAngularMajorData
+from parallel import ParallelReduce, GetDefaultProcessCount
 import os.path
 import tables
 from scipy.special import gamma, sph_harm
@@ -34,9 +38,11 @@ class EigenstateAnalysis:
 		self.Config = conf
 		self.BoundThreshold = 0.0
 		self.m = 0
+		self.ProcessCount = GetDefaultProcessCount()
 	    
 	def Setup(self):
-		#Setup pyprop problem.
+		#Setup pyprop problem, in the layout of the propagation
+		ApplyWavefunctionLayout(self.Config)
 		self.Problem = pyprop.Problem(self.Config)
 		self.Problem.SetupStep()
 		
@@ -61,7 +67,7 @@ class EigenstateAnalysis:
 		
 		for angIdx, curE, curV, l, m in self.Eigenstate.IterateBoundStates(self.BoundThreshold):
 			#Get projection on eigenstates
-			psiSlice = overlapPsi.GetData()[angIdx, :]
+			psiSlice = GetAngularMajorData(overlapPsi)[angIdx, :]
 			proj = dot(conj(curV.transpose()), psiSlice)
 
 			#Interpolate to get equispaced dP/dE
@@ -100,7 +106,7 @@ class EigenstateAnalysis:
 		
 		for angIdx, curE, curV, l, m in self.Eigenstate.IterateBoundStates(self.BoundThreshold):
 			#Get projection on eigenstates
-			psiSlice = overlapPsi.GetData()[angIdx, :]
+			psiSlice = GetAngularMajorData(overlapPsi)[angIdx, :]
 			proj = dot(conj(curV.transpose()), psiSlice)
 
 
@@ -118,16 +124,18 @@ class EigenstateAnalysis:
 		"""Remove projection on bound states in-place
 
 		"""
+		#The bound states do not change, setup native projector once
+		if getattr(self, "BoundStateProjector", None) is None:
+			lStates = {}
+			angularStates = []
+			for angIdx, curE, curV, l, m in self.Eigenstate.IterateBoundStates(self.BoundThreshold):
+				if not l in lStates:
+					lStates[l] = curV[:,0,:]
+				angularStates.append(lStates[l])
+			self.BoundStateProjector = boundstates.CreateBoundStateProjector(psi, angularStates)
 
-		#Multiply overlap on wavefunction
-		overlapPsi = self.MultiplyOverlap(psi)
-
-		for angIdx, curE, curV, l, m in self.Eigenstate.IterateBoundStates(self.BoundThreshold):
-			#Get projection on eigenstates
-			psiSlice = overlapPsi.GetData()[angIdx, :]
-			proj = dot(conj(curV.transpose()), psiSlice)
-			for p, v in zip(proj, curV.transpose()):
-				psi.GetData()[angIdx, :] -= p * v[0,:]
+		self.BoundStateProjector.RemoveProjection(psi.GetData())
+		InvalidateOverlap(psi)
 
 
 	def CalculateBoundProbability(self, psi):
@@ -151,18 +159,23 @@ class EigenstateAnalysis:
 		return boundTotal
     
 
-	def CalculateEnergyDistribution(self, psi, minE, maxE, dE):
+	def CalculateEnergyDistribution(self, psi, minE, maxE, dE, lList=None, mList=None):
 		"""
 		E, energyDistr = CalculateEnergyDistribution(self, psi)
 
 		Calculates the energy distribution of the ejected electron.
 
+		Only the eigenstates inside [minE, maxE] (and their nearest neighbours,
+		needed for the interpolation) are loaded and projected on.
+
 		Parametres
 		----------
 		psi:  PyProp wavefunction object. The wavefunction after propagation.
 		minE: lower cutoff in energy spectrum
 		maxE: upper cutoff in energy spectrum
 		dE:   spacing of interpolated energies in spectrum
+		lList: list of l values to include (default all)
+		mList: list of m values to include (default all)
 
 		Returns
 		-------
@@ -179,21 +192,21 @@ class EigenstateAnalysis:
 		#Create energy grid.
 		E = r_[minE:maxE:dE]
 		
-		#Initialise energy distribution array.
-		energyDistr = zeros(len(E), dtype=double)
-		
-		#Initialise total ionisation.
-		totalIon = 0
+		#Eigenstates in the energy window, and S psi
+		blocks = self._GetStateBlocks(overlapPsi, minE, maxE, lList, mList)
+
+		def addBlock(block, energyDistr, totalIon):
+			angIdx, curE, curV, l, m, psiSlice = block
+			if len(curE) < 2:
+				return
 
-		#Loops over {l,m}, and corresponding eigenvalues/eigenvectors.
-		for angIdx, curE, curV, l, m in self.Eigenstate.IterateStates(self.BoundThreshold):
 			#Get projection on eigenstates.
 			# | < V | S Psi > |**2
-			psiSlice = overlapPsi.GetData()[angIdx, :]
 			proj = abs(dot(conj(curV.transpose()), psiSlice))**2
 			
-			#Add to total ionisation.
-			totalIon += sum(proj)
+			#Add to total ionisation (padding states excluded).
+			inWindow = (curE >= minE) & (curE <= maxE)
+			totalIon += sum(proj.ravel()[inWindow])
 
 			#Calculate density of states
 			interiorSpacing = list((diff(curE[:-1]) + diff(curE[1:])) / 2.)
@@ -205,6 +218,11 @@ class EigenstateAnalysis:
 
 			#Interpolate to get equispaced dP/dE
 			energyDistr +=  scipy.interp(E, curE, proj.ravel() * density, left=0, right=0) 
+
+		#Loop over {l,m} blocks in local worker processes
+		energyDistr, totalIon = ParallelReduce(addBlock, blocks, \
+			[((len(E),), double), ((1,), double)], self.ProcessCount)
+		totalIon = totalIon[0]
 		
 		#TODO:Controlling interpolation error. Remove when testd#|
 		totalIon2 = sum(sum(array(energyDistr), axis=0)) * dE	#|
@@ -379,16 +397,21 @@ class EigenstateAnalysis:
 
 
 
-	def CalculateAngularDistribution(self, psi, minE, maxE, dE, Z=1):
+	def CalculateAngularDistribution(self, psi, minE, maxE, dE, Z=1, lList=None, mList=None):
 		"""
 		theta, E, phi, angularDistribution = CalculateAngularDistribution(self, psi)
 
 		Calculates the angular distribution.
 
+		Only the eigenstates inside [minE, maxE] (and their nearest neighbours,
+		needed for the interpolation) are loaded and projected on.
+
 		Parametres
 		----------
 		psi : PyProp wavefunction object. The wavefunction after propagation.
 		Z:    (int) Coulomb wave charge
+		lList: list of l values to include (default all)
+		mList: list of m values to include (default all)
 
 		Returns
 		-------
@@ -416,16 +439,18 @@ class EigenstateAnalysis:
 		leg = self.GetLegendrePoly(theta, phi)
 
 		
-		#Initialising the angular distribution array.
-		angularDistrProj = zeros((thetaCount, len(E), phiCount), dtype=complex)
+		#Eigenstates in the energy window, and S psi
+		blocks = self._GetStateBlocks(overlapPsi, minE, maxE, lList, mList)
 			
-		#Loops over ls, and corresponding eigenvalues/eigenvectors.
+		#Loops over {l,m}, and corresponding eigenvalues/eigenvectors.
 		#   curE is a 1D array,
 		#   curV is a 2D array.	
-		#Loops over {l,m}, and corresponding eigenvalues/eigenvectors.
 		print "Projection ..."
-		
-		for angIdx, curE, curV, l, m in self.Eigenstate.IterateStates(self.BoundThreshold):
+		def addBlock(block, angularDistrProj):
+			angIdx, curE, curV, l, m, psiSlice = block
+			if len(curE) < 2:
+				return
+
 			#From energy to momentum (k).
 			curk = sqrt(curE*2.)
 
@@ -434,8 +459,6 @@ class EigenstateAnalysis:
 			phase = (-1.j)**l * exp(1.j * sigma)
 
 			#Get projection on eigenstates
-			psiSlice = overlapPsi.GetData()[angIdx, :]
-			
 			proj = dot(conj(curV.transpose()), psiSlice)
 
 			#Calculate density of states
@@ -454,13 +477,12 @@ class EigenstateAnalysis:
 			argr = cos(i)
 			argi = sin(i)
 			
-			for ind in range(len(curE)):
-				interpR    = UnivariateSpline(curE, r   , k=1, s=0)(E)
-				interpArgR = UnivariateSpline(curE, argr, k=1, s=0)(E)
-				interpArgI = UnivariateSpline(curE, argi, k=1, s=0)(E)
+			interpR    = UnivariateSpline(curE, r   , k=1, s=0)(E)
+			interpArgR = UnivariateSpline(curE, argr, k=1, s=0)(E)
+			interpArgI = UnivariateSpline(curE, argi, k=1, s=0)(E)
 
-				interpPhase = (interpArgR + 1.j*interpArgI) / sqrt(interpArgR**2 + interpArgI**2)
-				interpProj = sqrt(maximum(interpR, 0)) * interpPhase
+			interpPhase = (interpArgR + 1.j*interpArgI) / sqrt(interpArgR**2 + interpArgI**2)
+			interpProj = sqrt(maximum(interpR, 0)) * interpPhase
 				
 			print angIdx
 
@@ -468,24 +490,42 @@ class EigenstateAnalysis:
 			for ind in range(phiCount):
 				angularDistrProj[:,:,ind] += outer(leg[angIdx,:,ind], interpProj)
 
-#			#TODO REMOVE
-#			return proj, angIdx, curE, outer(leg[angIdx,:,ind], interpProj)
-#			#
+		#Loop over {l,m} blocks in local worker processes
+		angularDistrProj, = ParallelReduce(addBlock, blocks, \
+			[((thetaCount, len(E), phiCount), complex)], self.ProcessCount)
 
 		return theta, E, phi, abs(angularDistrProj)**2
 
 
-	def MultiplyOverlap(self, inPsi):
-		"""Multiply overlap matrix on wavefunction, return new wavefunction
+	def _GetStateBlocks(self, overlapPsi, minE, maxE, lList, mList):
+		"""
+		Returns a list of (angIdx, E, V, l, m, psiSlice) for the eigenstates
+		in the energy window (with one padding state on either side). 
+		Eigenvectors are shared between all m for a given l, and psiSlice is
+		a view of S psi. Nothing is copied: forked analysis workers read the
+		arrays copy-on-write.
 
 		"""
-		#Get a copy of psi
-		outPsi = inPsi.Copy()
+		eigenstates = {}
+		overlapData = GetAngularMajorData(overlapPsi)
+		blocks = []
+		states = self.Eigenstate.IterateStatesInWindow(self.BoundThreshold, \
+			(minE, maxE), lList, mList, padding=1)
+		for angIdx, curE, curV, l, m in states:
+			if not l in eigenstates:
+				eigenstates[l] = (curE, curV)
+			curE, curV = eigenstates[l]
+			blocks.append((angIdx, curE, curV, l, m, overlapData[angIdx, :]))
+		return blocks
 
-		#Muliply overlap
-		outPsi.GetRepresentation().MultiplyOverlap(outPsi)
 
-		return outPsi
+	def MultiplyOverlap(self, inPsi):
+		"""Multiply overlap matrix on wavefunction, return S psi
+
+		S psi is cached on inPsi and reused until inPsi is modified, so
+		the returned wavefunction must be treated as read-only.
+		"""
+		return GetOverlapPsi(inPsi)
 
 
 class CoulombwaveAnalysis(EigenstateAnalysis):
@@ -497,6 +537,7 @@ class CoulombwaveAnalysis(EigenstateAnalysis):
 		self.Config = conf
 		self.BoundThreshold = 0.0
 		self.m = 0
+		self.ProcessCount = GetDefaultProcessCount()
 		self.Z = Z
 		self.FileList = fileList
 	    
@@ -0,0 +1,190 @@
+#include <core/common.h>
+#include <vector>
+#include <algorithm>
+
+#include "../core/instrumentation.h"
+
+extern "C"
+{
+#include <cblas.h>
+}
+
+/*
+ * Projector on the bound states of a one-particle problem, 
+ *
+ *     P psi_lm = V_l (S V_l)^H psi_lm
+ *
+ * where the columns of V_l are the bound radial eigenvectors belonging to
+ * angular index lm, and S is the radial overlap matrix.
+ *
+ * The bound states V and the overlap-multiplied states S V of each block 
+ * (usually one block per l, shared by all m) are stored contiguously as 
+ * (radial x bound) matrices, so applying P or 1 - P is two matrix-vector 
+ * products per angular index. Angular indices are processed in parallel when 
+ * compiled with OpenMP.
+ *
+ * The wavefunction data is assumed to be [angular, radial].
+ */
+class BoundStateProjector
+{
+public:
+	typedef blitz::Array<cplx, 2> MatrixType;
+
+	BoundStateProjector() : RadialCount(0) {}
+	virtual ~BoundStateProjector() {}
+
+	/*
+	 * Set the wavefunction shape. Angular indices have no bound states until
+	 * they are given a block with SetAngularBlock
+	 */
+	void Setup(int angularCount, int radialCount)
+	{
+		RadialCount = radialCount;
+		AngularBlocks.resize(angularCount);
+		AngularBlocks = -1;
+		States.clear();
+		OverlapStates.clear();
+	}
+
+	/*
+	 * Add a block of bound states. states and overlapStates are 
+	 * (radial x bound) matrices containing V and S V respectively.
+	 * Returns the index of the block.
+	 */
+	int AddBlock(const MatrixType &states, const MatrixType &overlapStates)
+	{
+		if (states.extent(0) != RadialCount) throw std::runtime_error("Invalid radial size of states");
+		if (overlapStates.extent(0) != states.extent(0) || overlapStates.extent(1) != states.extent(1)) 
+			throw std::runtime_error("states and overlapStates must have the same shape");
+
+		//copy() gives contiguous row major storage
+		States.push_back(MatrixType(states.copy()));
+		OverlapStates.push_back(MatrixType(overlapStates.copy()));
+		return States.size() - 1;
+	}
+
+	void SetAngularBlock(int angularIndex, int blockIndex)
+	{
+		if (angularIndex < 0 || angularIndex >= AngularBlocks.size()) throw std::runtime_error("Invalid angular index");
+		if (blockIndex < -1 || blockIndex >= (int)States.size()) throw std::runtime_error("Invalid block index");
+		AngularBlocks(angularIndex) = blockIndex;
+	}
+
+	int GetBoundStateCount(int angularIndex)
+	{
+		int block = AngularBlocks(angularIndex);
+		return block == -1 ? 0 : States[block].extent(1);
+	}
+
+	/*
+	 * data <- P data. Returns the bound state population of data
+	 */
+	double ApplyProjection(MatrixType data)
+	{
+		return Project(data, ProjectOnBound);
+	}
+
+	/*
+	 * data <- (1 - P) data. Returns the bound state population of data 
+	 * before the projection was removed
+	 */
+	double RemoveProjection(MatrixType data)
+	{
+		return Project(data, ProjectOnContinuum);
+	}
+
+	/*
+	 * Returns sum_lm |(S V_l)^H psi_lm|^2 without modifying data
+	 */
+	double GetBoundPopulation(MatrixType data)
+	{
+		return Project(data, PopulationOnly);
+	}
+
+private:
+	enum ProjectionMode
+	{
+		PopulationOnly,
+		ProjectOnBound,
+		ProjectOnContinuum
+	};
+
+	int RadialCount;
+	blitz::Array<int, 1> AngularBlocks;
+	std::vector<MatrixType> States;
+	std::vector<MatrixType> OverlapStates;
+
+	double Project(MatrixType &data, ProjectionMode mode)
+	{
+		INSTRUMENT_SCOPE("BoundStateProjector::Project");
+		INSTRUMENT_BYTES("BoundStateProjector::Project", data.size() * sizeof(cplx));
+
+		int angCount = data.extent(0);
+		if (angCount != AngularBlocks.size()) throw std::runtime_error("Invalid angular size");
+		if (data.extent(1) != RadialCount) throw std::runtime_error("Invalid radial size");
+		if (data.stride(1) != 1) throw std::runtime_error("Radial rank of data must be contiguous");
+
+		int maxBoundCount = 0;
+		for (int i=0; i<(int)States.size(); i++)
+		{
+			maxBoundCount = std::max(maxBoundCount, States[i].extent(1));
+		}
+
+		//Per angular index populations, summed in order afterwards to get 
+		//the same result regardless of thread count
+		std::vector<double> population(angCount, 0.0);
+
+		#pragma omp parallel
+		{
+			std::vector<cplx> coeff(std::max(maxBoundCount, 1));
+			const cplx one(1.0), zero(0.0), minusOne(-1.0);
+
+			#pragma omp for schedule(dynamic)
+			for (int angIdx=0; angIdx<angCount; angIdx++)
+			{
+				int block = AngularBlocks(angIdx);
+				cplx *psi = &data(angIdx, 0);
+				if (block == -1) 
+				{
+					if (mode == ProjectOnBound) std::fill(psi, psi + RadialCount, zero);
+					continue;
+				}
+
+				const MatrixType &V = States[block];
+				const MatrixType &SV = OverlapStates[block];
+				int boundCount = V.extent(1);
+
+				//c = (S V)^H psi
+				cblas_zgemv(CblasRowMajor, CblasConjTrans, RadialCount, boundCount, &one, 
+					SV.data(), boundCount, psi, 1, &zero, &coeff[0], 1);
+
+				double curPopulation = 0;
+				for (int i=0; i<boundCount; i++)
+				{
+					curPopulation += std::norm(coeff[i]);
+				}
+				population[angIdx] = curPopulation;
+
+				//psi <- V c  or  psi <- psi - V c
+				if (mode == ProjectOnBound)
+				{
+					cblas_zgemv(CblasRowMajor, CblasNoTrans, RadialCount, boundCount, &one, 
+						V.data(), boundCount, &coeff[0], 1, &zero, psi, 1);
+				}
+				else if (mode == ProjectOnContinuum)
+				{
+					cblas_zgemv(CblasRowMajor, CblasNoTrans, RadialCount, boundCount, &minusOne, 
+						V.data(), boundCount, &coeff[0], 1, &one, psi, 1);
+				}
+			}
+		}
+
+		double totalPopulation = 0;
+		for (int angIdx=0; angIdx<angCount; angIdx++)
+		{
+			totalPopulation += population[angIdx];
+		}
+		return totalPopulation;
+	}
+};
+
@@ -9,9 +9,13 @@ Basic bound state operations are provided. These are:
 
 """
 import numpy
-from numpy import zeros, complex, array, dot, conj
+from numpy import zeros, complex, array, dot, conj, ascontiguousarray
 import pyprop
 from einpartikkel.utils import RegisterAll
+from above import BoundStateProjector
+from ..core.bufferpool import GetDefaultBufferPool
+from ..memoryledger import GetMemoryLedger
+from ..core.layout import GetAngularRepresentation, RequireAngularMajor
 from einpartikkel.eigenvalues.eigenvalues_iter import LoadEigenpairs
 from ..eigenvalues.eigenvalues import SetupRadialEigenstates, SetupOverlapMatrix
 
@@ -30,6 +34,7 @@ class Boundstates(object):
 		self.States = []
 		self.Psi = None
 		self.Overlap = None
+		self.Projector = None
 		self.IsSetup = False
 
 		self.Logger = pyprop.GetClassLogger(self)
@@ -53,6 +58,19 @@ class Boundstates(object):
 		#Setup overlap matrix
 		#self.Overlap = SetupOverlapMatrix(self.Config.OverlapPotential, \
 		#		self.Psi)
+
+		#Setup native projector, states are stored as (radial x bound)
+		RequireAngularMajor(self.Psi, "The bound state projector")
+		angRange = GetAngularRepresentation(self.Psi).Range
+		angularStates = [None] * self.Psi.GetData().shape[0]
+		for idx, (l,m) in enumerate(self.LmList):
+			angIdx = angRange.GetGridIndex(pyprop.core.LmIndex(l,m))
+			assert (angIdx > -1)
+			curV = self.States[idx]
+			if len(curV) == 0:
+				continue
+			angularStates[angIdx] = array(curV).transpose()
+		self.Projector = CreateBoundStateProjector(self.Psi, angularStates)
 		
 		self.IsSetup = True
 
@@ -62,31 +80,71 @@ class Boundstates(object):
 		"""
 		assert self.IsSetup
 
-		#Copy psi
-		psiTmp = psi.Copy()
+		self.Logger.info("Removing projection on bound states")
+		self.Projector.RemoveProjection(psi.GetData())
 
-		#Multiply overlap
-		#radialRank = 1
-		psiTmp.GetRepresentation().MultiplyOverlap(psiTmp)
 
-		angRange = psi.GetRepresentation().GetRepresentation(0).Range
-		for idx, (l,m) in enumerate(self.LmList):
-			if len(self.States) == 0:
-				continue
-			self.Logger.info("Removing projection on (l,m) = (%i,%i)" % (l,m))
-			angIdx = angRange.GetGridIndex(pyprop.core.LmIndex(l,m))
-			assert (angIdx > -1)
-			curV = self.States[idx]
-			if len(curV) == 0:
-				continue
-			#psiSlice = psi.GetData()[angIdx, :]
-			#overlapPsi = dot(self.Overlap, psiSlice)
-			#proj = dot(conj(curV), overlapPsi)
-			psiSlice = psiTmp.GetData()[angIdx, :]
-			proj = dot(conj(curV), psiSlice)
-			#print "l=%s, m=%s, p=%s" % (l,m, proj)
-			for p, v in zip(proj, curV):
-				psi.GetData()[angIdx, :] -= p * v[:]
+@RegisterAll
+def CreateBoundStateProjector(psi, angularStates):
+	"""Create a native BoundStateProjector for the layout of psi
+
+	The overlap matrix is applied to the bound states here, once, so that
+	projecting on (or removing) bound states later on costs two matrix-vector 
+	products per angular index.
+
+	Input
+	-----
+	psi:           (wavefunction) a wavefunction with the desired representation
+	angularStates: (list) for each angular index of psi, a (radial x bound) 
+	               array of bound eigenvectors, or None. Angular indices given 
+	               the same array object share one block in the projector.
+
+	Returns
+	-------
+	BoundStateProjector instance
+
+	"""
+	angularCount, radialCount = psi.GetData().shape
+	projector = BoundStateProjector()
+	projector.Setup(angularCount, radialCount)
+
+	#One block per distinct array, with a representative angular index
+	blocks = {}
+	for angIdx, V in enumerate(angularStates):
+		if V is None or V.shape[1] == 0:
+			continue
+		if id(V) not in blocks:
+			blocks[id(V)] = (angIdx, V)
+
+	#Calculate S V for all blocks at once, one overlap multiplication
+	#per bound state index
+	overlapStates = dict([(key, zeros(V.shape, dtype=complex)) \
+		for key, (angIdx, V) in blocks.iteritems()])
+	maxBoundCount = max([0] + [V.shape[1] for angIdx, V in blocks.itervalues()])
+	pool = GetDefaultBufferPool()
+	tmpPsi = pool.Checkout(psi)
+	for i in range(maxBoundCount):
+		tmpPsi.GetData()[:] = 0
+		for angIdx, V in blocks.itervalues():
+			if i < V.shape[1]:
+				tmpPsi.GetData()[angIdx, :] = V[:, i]
+		tmpPsi.GetRepresentation().MultiplyOverlap(tmpPsi)
+		for key, (angIdx, V) in blocks.iteritems():
+			if i < V.shape[1]:
+				overlapStates[key][:, i] = tmpPsi.GetData()[angIdx, :]
+	pool.Return(tmpPsi)
+
+	blockIndices = {}
+	for key, (angIdx, V) in blocks.iteritems():
+		blockIndices[key] = projector.AddBlock(ascontiguousarray(V, \
+			dtype=complex), overlapStates[key])
+		GetMemoryLedger().Register("BoundStateProjector", "Projector block %i" % \
+			blockIndices[key], 2 * V.shape[0] * V.shape[1] * 16, owner=projector)
+	for angIdx, V in enumerate(angularStates):
+		if V is not None and id(V) in blockIndices:
+			projector.SetAngularBlock(angIdx, blockIndices[id(V)])
+
+	return projector
 
 
 def SetupOverlapMatrix(confSec, psi):
@@ -14,12 +14,15 @@ import sys
 import os, errno
 import tables
 from numpy import array, where, r_, sqrt, zeros, array, abs, dot, conj, pi, \
-	double, complex, iterable, diff
+	double, complex, iterable, diff, newaxis
 import pyprop
 from einpartikkel.eigenvalues.eigenvalues import SetupRadialEigenstates
 from einpartikkel.utils import RegisterAll
+from einpartikkel.memoryledger import GetMemoryLedger
+from einpartikkel.core.layout import GetRadialRepresentation
 from einpartikkel.namegenerator import GetRadialPostfix, GetAngularPostfix
 from above import SetRadialCoulombWave
+from eigenstates import GetWindowRange
 
 @RegisterAll
 class CoulombWaves(object):
@@ -61,6 +64,16 @@ class CoulombWaves(object):
 	def SetData(self, data):
 		self._Data = data
 		self._SetupComplete = True
+		self._RegisterMemory()
+
+
+	def _RegisterMemory(self):
+		"""Register the Coulomb wave arrays with the memory ledger
+		"""
+		ledger = GetMemoryLedger()
+		for name, item in self._Data.iteritems():
+			if name.startswith("CoulombWaves_l"):
+				ledger.Register("CoulombWaves", name, item.nbytes, owner=item)
 
 
 	@classmethod
@@ -139,6 +152,7 @@ class CoulombWaves(object):
 			d["CoulombWaves_l%i" % l] = cw
 
 		self._SetupComplete = True
+		self._RegisterMemory()
     
     
 	def Serialize(self):
@@ -191,6 +205,27 @@ class CoulombWaves(object):
 		----------
 		threshold : (float) lower energy cutoff
 
+		"""
+		return self.IterateStatesInWindow(threshold)
+
+
+	def IterateStatesInWindow(self, threshold, window=None, lList=None, \
+			mList=None, padding=0):
+		"""
+		IterateStatesInWindow(self, threshold, window, lList, mList, padding)
+		
+		Iterate over the states with energies over threshold, restricted to 
+		an energy window and a subset of (l,m). Same arguments as 
+		Eigenstates.IterateStatesInWindow().
+
+		Parametres
+		----------
+		threshold : (float) lower energy cutoff
+		window :    (tuple) (minE, maxE), or None for no restriction
+		lList :     (list) l values to include, None means all
+		mList :     (list) m values to include, None means all
+		padding :   (int) number of states outside window on each side
+
 		"""
 		assert (self._SetupComplete)
 		#enList = self._Data["Energies"]
@@ -201,6 +236,10 @@ class CoulombWaves(object):
 			#Get current l and m
 			l = lmIdx.l
 			m = lmIdx.m
+			if lList is not None and l not in lList:
+				continue
+			if mList is not None and m not in mList:
+				continue
 			
 			#Get energies and Coulomb waves
 			curE = self._Data["Energies_l%i" % l]
@@ -210,15 +249,15 @@ class CoulombWaves(object):
 			#curE = array(enList[l])
 			#curCW = array(cwList[l])
 
-			#Filter out unwanted energies.
-			idx = where(curE > threshold)
-			filteredE = curE[idx]
-			filteredCW = curCW[:,idx]
+			#Filter out unwanted energies (energies are sorted)
+			start, stop = GetWindowRange(curE, threshold, window, padding)
+			filteredE = curE[start:stop]
+			filteredCW = curCW[:,newaxis,start:stop]
 			#filteredCW = curCW[idx,:]
 			
 			#Test:normalize
 			k = sqrt(2*filteredE)
-			dE = diff(filteredE)[0]
+			dE = diff(curE)[0]
 			factor = sqrt(2*dE/(pi*k))
 
 
@@ -284,7 +323,7 @@ def SetupRadialCoulombStatesEnergyNormalized(psi, Z, l, Emax, dE):
 	E = r_[dE:Emax:dE]
 	k = sqrt(E*2)
 	
-	bspline = psi.GetRepresentation().GetRepresentation(1).GetBSplineObject()
+	bspline = GetRadialRepresentation(psi).GetBSplineObject()
 	#l = array(psi.GetRepresentation().GetGlobalGrid(0), dtype=int)
 
 	#Setup Radial Waves for given l
@@ -13,11 +13,12 @@ Basic eigenstate operations are provided. These are:
 from __future__ import with_statement
 import os, errno
 import tables
-from numpy import array, where
+from numpy import array, searchsorted, newaxis
 import pyprop
 from ..eigenvalues.eigenvalues import SetupRadialEigenstates
 from einpartikkel.namegenerator import GetRadialPostfix, GetAngularPostfix
 from einpartikkel.utils import RegisterAll
+from einpartikkel.memoryledger import GetMemoryLedger
 
 @RegisterAll
 class Eigenstates(object):
@@ -118,9 +119,10 @@ class Eigenstates(object):
 	"""
 	f = tables.openFile(self.FileName, "r")
 	try:
-	    #Saving the lists of indices and results.
+	    #Saving the lists of indices and results. The eigenvectors are 
+	    #not read here, see EigenVectors and GetEigenvectors().
 	    self.EigenValues = f.root.Eigenvalues[:]
-	    self.EigenVectors = f.root.Eigenstates[:]
+	    self._EigenVectors = None
 	    self.AngularIndices = f.root.AngularIndex[:]
 	    
 	    #Saving lm index list.
@@ -150,17 +152,89 @@ class Eigenstates(object):
 	>>> for angIdx, E, V, l, m in my_eigenstates.IterateStates(threshold):
 	>>>	ionisation_probability += projection_method(my_wavefunction, V)	 
 	"""
+	return self.IterateStatesInWindow(threshold)
+
+    def IterateStatesInWindow(self, threshold, window=None, lList=None, \
+	    mList=None, padding=0):
+	"""
+	IterateStatesInWindow(self, threshold, window, lList, mList, padding)
+
+	Iterate over the states with energies over threshold, restricted to an
+	energy window and a subset of the angular indices. Only the eigenvectors
+	that are yielded are read from disk.
+
+	Parametres
+	----------
+	threshold : float, states with energies below this are never included.
+	window : (minE, maxE) tuple of floats, only states with minE <= E <= maxE
+	    are included. None means no restriction.
+	lList : list of int, l values to include. None means all.
+	mList : list of int, m values to include. None means all.
+	padding : int, number of states just outside the window to include on each
+	    side, so that interpolation onto the window edges is well defined.
+	    Padding never goes below threshold.
+
+	Example
+	-------
+	>>> states = my_eigenstates.IterateStatesInWindow(0, (0, 2), lList=[0,1])
+	>>> for angIdx, E, V, l, m in states:
+	>>>	print angIdx, l, m, E.min(), E.max()
+	"""
+	#Eigenvectors of the last l read, shared between the m's of that l.
+	cache = {}
 	for angIdx, lm in enumerate(self.Config.AngularRepresentation.index_iterator.__iter__()):
 	    l = lm.l
 	    m = lm.m
+	    if lList is not None and l not in lList:
+		continue
+	    if mList is not None and m not in mList:
+		continue
 	    curE = array(self.EigenValues[l])
-	    curV = array(self.EigenVectors[l])
-	    
-	    #Filter out unwanted energies.
-	    idx = where(curE > threshold)
-	    curE = curE[idx]
-	    curV = curV[:,idx]
-	    yield angIdx, curE, curV, l, m
+
+	    #Eigenvalues are sorted, the states wanted are a contiguous range.
+	    start, stop = GetWindowRange(curE, threshold, window, padding)
+	    if not (l, start, stop) in cache:
+		cache.clear()
+		cache[(l, start, stop)] = self.GetEigenvectors(l, start, stop)
+		GetMemoryLedger().Register("Eigenpairs", "Eigenvectors l=%i [%i:%i]" % \
+		    (l, start, stop), cache[(l, start, stop)].nbytes, owner=cache[(l, start, stop)])
+	    curV = cache[(l, start, stop)]
+
+	    #Same (radial, 1, state) layout as the where()-indexed arrays
+	    #yielded by IterateStates() historically.
+	    yield angIdx, curE[start:stop], curV[:,newaxis,:], l, m
+
+    def GetEigenvectors(self, l, start=None, stop=None):
+	"""
+	V = GetEigenvectors(l, start, stop)
+
+	Returns eigenvectors start:stop (columns of V) for angular momentum l, 
+	only reading that part of the eigenvector array from disk.
+	"""
+	if self._EigenVectors is not None:
+	    return array(self._EigenVectors[l][:, start:stop])
+
+	f = tables.openFile(self.FileName, "r")
+	try:
+	    V = f.root.Eigenstates[l, :, start:stop]
+	finally:
+	    f.close()
+	return V
+
+    @property
+    def EigenVectors(self):
+	"""
+	All eigenvectors, read from disk on first access.
+	"""
+	if self._EigenVectors is None:
+	    f = tables.openFile(self.FileName, "r")
+	    try:
+		self._EigenVectors = f.root.Eigenstates[:]
+		GetMemoryLedger().Register("Eigenpairs", "Eigenvectors (all)", \
+		    self._EigenVectors.nbytes, owner=self._EigenVectors)
+	    finally:
+		f.close()
+	return self._EigenVectors
 
     def IterateBoundStates(self, threshold):
 	"""
@@ -194,14 +268,11 @@ class Eigenstates(object):
 	    l = lm.l
 	    m = lm.m
 	    curE = array(self.EigenValues[l])
-	    curV = array(self.EigenVectors[l])
 
-	    
-	    #Filter out unwanted energies.
-	    idx = where(curE < threshold)
-	    curE = curE[idx]
-	    curV = curV[:,idx]
-	    yield angIdx, curE, curV, l, m
+	    #Filter out unwanted energies (eigenvalues are sorted).
+	    stop = searchsorted(curE, threshold, side="left")
+	    curV = self.GetEigenvectors(l, 0, stop)
+	    yield angIdx, curE[:stop], curV[:,newaxis,:], l, m
 
 
 
@@ -236,3 +307,27 @@ class Eigenstates(object):
 	
 	return my_name
 
+
+@RegisterAll
+def GetWindowRange(energies, threshold, window=None, padding=0):
+    """
+    start, stop = GetWindowRange(energies, threshold, window, padding)
+
+    Returns the index range of the sorted energies that are over threshold and
+    inside window, extended with padding states on each side (but never below 
+    threshold).
+
+    Parametres
+    ----------
+    energies : 1D double array, sorted energies.
+    threshold : float, lower energy cutoff.
+    window : (minE, maxE) tuple of floats, or None.
+    padding : int, number of extra states to include on each side of window.
+    """
+    start = searchsorted(energies, threshold, side="right")
+    stop = len(energies)
+    if window is not None:
+	minE, maxE = window
+	start = max(start, searchsorted(energies, minE, side="left") - padding)
+	stop = min(stop, searchsorted(energies, maxE, side="right") + padding)
+    return start, max(start, stop)
@@ -0,0 +1,263 @@
+#include <core/common.h>
+#include <vector>
+#include <string>
+
+#include "../core/instrumentation.h"
+
+/*
+ * Native propagation tasks, evaluated at every time step without a python
+ * callback per task.
+ *
+ * A NativeTaskList holds a number of tasks, each producing one complex value
+ * per step. Step() runs all tasks on the current wavefunction data and
+ * appends the values to per-task buffers, which are retrieved with
+ * GetSampleTimes() and GetResults() when the propagation is finished.
+ *
+ * Built-in tasks:
+ *
+ *   TensorExpectation  <psi|V|psi> for a tensor potential given by its
+ *                      PotentialData and (angular, radial) basis pairs.
+ *                      The overlap potential gives the norm, the (static
+ *                      part of) a laser potential gives the dipole moment
+ *   BoundPopulation    sum_lm |(S V_l)^H psi_lm|^2 of a BoundStateProjector
+ *
+ * The wavefunction data is assumed to be [angular, radial], and not
+ * distributed.
+ *
+ * BoundStateProjector (boundstateprojector.cpp) must be declared before this
+ * file is included.
+ */
+class NativeTask
+{
+public:
+	NativeTask(const std::string &name) : Name(name) {}
+	virtual ~NativeTask() {}
+
+	virtual void Setup(int angularCount, int radialCount) {}
+	virtual cplx Step(double t, blitz::Array<cplx, 2> &data) = 0;
+	virtual void PostProcess() {}
+
+	std::string Name;
+	std::vector<cplx> Values;
+};
+
+
+class TensorExpectationTask : public NativeTask
+{
+public:
+	typedef blitz::Array<int, 2> BasisPairType;
+
+	TensorExpectationTask(const std::string &name, blitz::Array<cplx, 2> potentialData,
+			BasisPairType angularPairs, BasisPairType radialPairs)
+		: NativeTask(name)
+	{
+		if (potentialData.extent(0) != angularPairs.extent(0)) throw std::runtime_error("Invalid number of angular basis pairs");
+		if (potentialData.extent(1) != radialPairs.extent(0)) throw std::runtime_error("Invalid number of radial basis pairs");
+		if (angularPairs.extent(1) != 2 || radialPairs.extent(1) != 2) throw std::runtime_error("Basis pairs must have shape (n, 2)");
+
+		//Own copies, the python potential may be freed or rescaled
+		PotentialData.reference(potentialData.copy());
+		AngularPairs.reference(angularPairs.copy());
+		RadialPairs.reference(radialPairs.copy());
+	}
+
+	virtual void Setup(int angularCount, int radialCount)
+	{
+		if (blitz::max(AngularPairs) >= angularCount || blitz::min(AngularPairs) < 0)
+			throw std::runtime_error("Angular basis pairs out of range of the wavefunction");
+		if (blitz::max(RadialPairs) >= radialCount || blitz::min(RadialPairs) < 0)
+			throw std::runtime_error("Radial basis pairs out of range of the wavefunction");
+	}
+
+	virtual cplx Step(double t, blitz::Array<cplx, 2> &data)
+	{
+		int angularPairCount = AngularPairs.extent(0);
+		int radialPairCount = RadialPairs.extent(0);
+
+		//Per angular pair sums, summed in order afterwards to get the same
+		//result regardless of thread count
+		std::vector<cplx> partial(angularPairCount, cplx(0.0));
+
+		#pragma omp parallel for schedule(static)
+		for (int angPair=0; angPair<angularPairCount; angPair++)
+		{
+			const cplx *left = &data(AngularPairs(angPair, 0), 0);
+			const cplx *right = &data(AngularPairs(angPair, 1), 0);
+			const cplx *V = &PotentialData(angPair, 0);
+
+			cplx sum = 0;
+			for (int radPair=0; radPair<radialPairCount; radPair++)
+			{
+				sum += conj(left[RadialPairs(radPair, 0)]) * V[radPair] * right[RadialPairs(radPair, 1)];
+			}
+			partial[angPair] = sum;
+		}
+
+		cplx total = 0;
+		for (int angPair=0; angPair<angularPairCount; angPair++)
+		{
+			total += partial[angPair];
+		}
+		return total;
+	}
+
+private:
+	blitz::Array<cplx, 2> PotentialData;
+	BasisPairType AngularPairs;
+	BasisPairType RadialPairs;
+};
+
+
+class BoundPopulationTask : public NativeTask
+{
+public:
+	BoundPopulationTask(const std::string &name, BoundStateProjector &projector)
+		: NativeTask(name), Projector(&projector) {}
+
+	virtual cplx Step(double t, blitz::Array<cplx, 2> &data)
+	{
+		return Projector->GetBoundPopulation(data);
+	}
+
+private:
+	//Kept alive by the python wrapper (with_custodian_and_ward)
+	BoundStateProjector *Projector;
+};
+
+
+class NativeTaskList
+{
+public:
+	typedef blitz::Array<cplx, 2> DataType;
+
+	NativeTaskList() : AngularCount(0), RadialCount(0) {}
+
+	virtual ~NativeTaskList()
+	{
+		for (size_t i=0; i<Tasks.size(); i++)
+		{
+			delete Tasks[i];
+		}
+	}
+
+	/*
+	 * Add a <psi|V|psi> task. Returns the index of the task
+	 */
+	int AddTensorExpectationTask(std::string name, blitz::Array<cplx, 2> potentialData,
+			blitz::Array<int, 2> angularPairs, blitz::Array<int, 2> radialPairs)
+	{
+		return AddTask(new TensorExpectationTask(name, potentialData, angularPairs, radialPairs));
+	}
+
+	/*
+	 * Add a bound state population task. projector must outlive this object.
+	 * Returns the index of the task
+	 */
+	int AddBoundPopulationTask(std::string name, BoundStateProjector &projector)
+	{
+		return AddTask(new BoundPopulationTask(name, projector));
+	}
+
+	/*
+	 * Set the wavefunction shape, and reserve result buffers for
+	 * expectedStepCount steps. Clears previous results.
+	 */
+	void Setup(int angularCount, int radialCount, int expectedStepCount)
+	{
+		AngularCount = angularCount;
+		RadialCount = radialCount;
+		SampleTimes.clear();
+		SampleTimes.reserve(expectedStepCount);
+		for (size_t i=0; i<Tasks.size(); i++)
+		{
+			Tasks[i]->Setup(angularCount, radialCount);
+			Tasks[i]->Values.clear();
+			Tasks[i]->Values.reserve(expectedStepCount);
+		}
+	}
+
+	/*
+	 * Run all tasks on data at time t, and buffer the results
+	 */
+	void Step(double t, DataType data)
+	{
+		INSTRUMENT_SCOPE("NativeTaskList::Step");
+		INSTRUMENT_BYTES("NativeTaskList::Step", Tasks.size() * data.size() * sizeof(cplx));
+
+		if (data.extent(0) != AngularCount || data.extent(1) != RadialCount) throw std::runtime_error("Invalid wavefunction shape, call Setup() first");
+		if (data.stride(1) != 1) throw std::runtime_error("Radial rank of data must be contiguous");
+
+		SampleTimes.push_back(t);
+		for (size_t i=0; i<Tasks.size(); i++)
+		{
+			Tasks[i]->Values.push_back(Tasks[i]->Step(t, data));
+		}
+	}
+
+	void PostProcess()
+	{
+		for (size_t i=0; i<Tasks.size(); i++)
+		{
+			Tasks[i]->PostProcess();
+		}
+	}
+
+	int GetTaskCount()
+	{
+		return Tasks.size();
+	}
+
+	std::string GetTaskName(int taskIndex)
+	{
+		return GetTask(taskIndex).Name;
+	}
+
+	int GetSampleCount()
+	{
+		return SampleTimes.size();
+	}
+
+	blitz::Array<double, 1> GetSampleTimes()
+	{
+		blitz::Array<double, 1> times(SampleTimes.size());
+		for (size_t i=0; i<SampleTimes.size(); i++)
+		{
+			times(i) = SampleTimes[i];
+		}
+		return times;
+	}
+
+	blitz::Array<cplx, 1> GetResults(int taskIndex)
+	{
+		const std::vector<cplx> &values = GetTask(taskIndex).Values;
+		blitz::Array<cplx, 1> results(values.size());
+		for (size_t i=0; i<values.size(); i++)
+		{
+			results(i) = values[i];
+		}
+		return results;
+	}
+
+private:
+	int AngularCount;
+	int RadialCount;
+	std::vector<NativeTask*> Tasks;
+	std::vector<double> SampleTimes;
+
+	//Tasks are owned, so the list can not be copied
+	NativeTaskList(const NativeTaskList&);
+	NativeTaskList& operator=(const NativeTaskList&);
+
+	int AddTask(NativeTask *task)
+	{
+		Tasks.push_back(task);
+		return Tasks.size() - 1;
+	}
+
+	NativeTask& GetTask(int taskIndex)
+	{
+		if (taskIndex < 0 || taskIndex >= (int)Tasks.size()) throw std::runtime_error("Invalid task index");
+		return *Tasks[taskIndex];
+	}
+};
+
@@ -0,0 +1,137 @@
+"""
+parallel
+========
+
+Shared memory, multi-process execution of analysis tasks over angular blocks.
+
+Read-only inputs (eigenvectors, Legendre polynomials, S psi) are not
+copied: forked worker processes share them copy-on-write with the parent.
+Each worker processes a fixed, interleaved subset of the angular blocks and
+accumulates into its own partial result, which is placed in an anonymous
+shared memory map so the parent can read it. With one process nothing is
+forked, and the results are ordinary arrays. The partial results are summed in worker order by the parent
+process, so a given worker count always gives the same result.
+
+The workers are forked after pyprop has set up the problem, when OpenMP and
+BLAS thread pools may be running. Not every runtime supports this (a child
+can deadlock on a lock held by a thread that does not exist in it), so the
+work is done in the calling process unless the number of workers is given,
+e.g. with the environment variable EINPARTIKKEL_ANALYSIS_PROCS.
+
+"""
+import os
+import sys
+import mmap
+import traceback
+import numpy
+import pyprop
+from einpartikkel.utils import RegisterAll
+
+
+@RegisterAll
+def CreateSharedArray(shape, dtype=numpy.double):
+	"""
+	a = CreateSharedArray(shape, dtype)
+
+	Returns a zero initialised numpy array backed by an anonymous shared memory
+	map. Changes made by forked child processes are visible to the parent.
+	"""
+	dtype = numpy.dtype(dtype)
+	count = int(numpy.prod(shape))
+	buf = mmap.mmap(-1, max(1, count * dtype.itemsize))
+	return numpy.frombuffer(buf, dtype=dtype, count=count).reshape(shape)
+
+
+DefaultProcessCount = 1
+
+
+@RegisterAll
+def GetDefaultProcessCount():
+	"""
+	Number of local worker processes to use for analysis. Can be set with
+	the environment variable EINPARTIKKEL_ANALYSIS_PROCS, and is otherwise
+	DefaultProcessCount (1, see above). Analysis is run in a single process
+	when running under MPI.
+	"""
+	if not pyprop.IsSingleProc():
+		return 1
+	if "EINPARTIKKEL_ANALYSIS_PROCS" in os.environ:
+		return max(1, int(os.environ["EINPARTIKKEL_ANALYSIS_PROCS"]))
+	return DefaultProcessCount
+
+
+@RegisterAll
+def ParallelReduce(func, blocks, resultSpecs, procCount=None):
+	"""
+	results = ParallelReduce(func, blocks, resultSpecs, procCount)
+
+	Calls func(block, *partials) for every block in blocks, where partials
+	are the arrays described by resultSpecs, and func adds its contribution
+	to them. Blocks are distributed interleaved over procCount forked worker
+	processes, and the partial results are summed in worker order.
+
+	Parametres
+	----------
+	func : callable, func(block, *partials). Must only add to partials.
+	blocks : list of work items. Available to the workers through fork,
+	         so they need not be picklable.
+	resultSpecs : list of (shape, dtype) for the result arrays.
+	procCount : number of worker processes (default GetDefaultProcessCount())
+
+	Returns
+	-------
+	results : list of reduced arrays, one for each entry in resultSpecs.
+
+	"""
+	if procCount == None:
+		procCount = GetDefaultProcessCount()
+	procCount = max(1, min(procCount, len(blocks)))
+
+	#Run serially in this process
+	if procCount == 1:
+		results = [numpy.zeros(shape, dtype=dtype) for shape, dtype in resultSpecs]
+		for block in blocks:
+			func(block, *results)
+		return results
+
+	#One partial result per worker, in shared memory
+	partials = [CreateSharedArray((procCount,) + tuple(shape), dtype) \
+		for shape, dtype in resultSpecs]
+
+	sys.stdout.flush()
+	sys.stderr.flush()
+	pids = []
+	for rank in range(procCount):
+		pid = os.fork()
+		if pid == 0:
+			exitCode = 0
+			try:
+				try:
+					outs = [p[rank] for p in partials]
+					for block in blocks[rank::procCount]:
+						func(block, *outs)
+				except:
+					traceback.print_exc()
+					exitCode = 1
+			finally:
+				sys.stdout.flush()
+				sys.stderr.flush()
+				os._exit(exitCode)
+		pids.append(pid)
+
+	failed = []
+	for rank, pid in enumerate(pids):
+		status = os.waitpid(pid, 0)[1]
+		if status != 0:
+			failed.append(rank)
+	if len(failed) > 0:
+		raise RuntimeError("Analysis worker(s) %s failed" % failed)
+
+	#Deterministic reduction, summing in worker order
+	results = []
+	for p in partials:
+		result = numpy.array(p[0])
+		for rank in range(1, procCount):
+			result += p[rank]
+		results.append(result)
+	return results
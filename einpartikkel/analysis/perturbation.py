@@ -0,0 +1,217 @@
+"""
+perturbation
+============
+
+Lowest order perturbation theory amplitudes for n photon ionisation by a
+weak, linearly polarised field, for cross section scans over the photon
+energy without propagating.
+
+With the coupling D (e.g. z from CustomPotential_LaserLength_Z, or the
+velocity gauge couplings), the perturbed states are the chain
+
+	psi_0 = initial state, energy E0
+	psi_k = G(E0 + k w) D psi_(k-1),  k = 1..n-1
+	G(E)  = (E + i eps - H)^-1 = -(H - E - i eps)^-1
+
+which is solved per angular index with the banded radial matrices of
+eigenvalues.py, since H is diagonal in l. The n photon amplitude to the
+energy normalised Coulomb wave of each partial wave at the final energy
+E = E0 + n w is
+
+	M_l = <C_l(E)| D |psi_(n-1)>
+
+using the same Coulomb waves as coulombwaves.py (per unit energy, i.e.
+without the sqrt(dE) of SetupRadialCoulombStatesEnergyNormalized), so
+M_l exp(-i sigma_l) i^-l with sigma_l = GetCoulombPhase(l, -Z/k) gives
+the angular distributions in the same way as for the propagated states.
+
+The frequencies are distributed over worker processes with
+ParallelReduce, each frequency costing (n-1) banded solves per partial
+wave.
+
+Example
+-------
+>>> pert = PerturbativeAmplitudes(prop, [0, 1, 2], ["LaserPotentialLengthZ"], E0)
+>>> M = pert.GetAmplitudes(frequencies, photonCount=2)
+>>> sigma = GetGeneralizedCrossSection(M, frequencies, photonCount=2)
+
+"""
+from numpy import array, zeros, sqrt, pi, abs, double, complex, asarray
+import scipy.linalg
+import pyprop
+from pyprop.pyproplogging import GetFunctionLogger
+from einpartikkel.utils import RegisterAll
+from einpartikkel.core.layout import GetAngularRepresentation, GetRadialRepresentation, \
+	GetAngularMajorData
+from einpartikkel.eigenvalues.eigenvalues import SetupBandedRadialMatrix, \
+	SetupBandedOverlapMatrix, GetGeneralBandedMatrix
+from einpartikkel.eigenvalues.complexscaling import SetupCoupledMatrix
+from coulombwaves import GetRadialCoulombWaveBSplines
+from parallel import ParallelReduce
+
+#Fine structure constant
+FineStructureConstant = 1.0 / 137.035999
+
+@RegisterAll
+class PerturbativeAmplitudes(object):
+	"""
+	Perturbative n photon amplitudes from one initial state
+
+	Parametres
+	----------
+	prop:                  (pyprop.Problem) the problem
+	hamiltonianPotentials: (list) field free potentials, indices into the
+	                       propagator potential list or TensorPotentials
+	couplingPotentials:    (list) the dipole coupling, config sections
+	                       (names), TensorPotentials, or (potential, factor)
+	initialEnergy:         (float) E0
+	initialState:          (array) [angular, radial] coefficients of the
+	                       initial state, default prop.psi
+	Z:                     (float) Coulomb charge of the final states
+	epsilon:               (float) the i eps of the propagators, needed
+	                       only above intermediate thresholds
+	"""
+
+	def __init__(self, prop, hamiltonianPotentials, couplingPotentials, initialEnergy, \
+			initialState=None, Z=1.0, epsilon=1e-6):
+		if not pyprop.IsSingleProc():
+			raise Exception("Works only on a single processor")
+
+		self.Logger = GetFunctionLogger()
+		self.InitialEnergy = initialEnergy
+		self.Z = Z
+		self.Epsilon = epsilon
+		if initialState is None:
+			initialState = GetAngularMajorData(prop.psi)
+		self.InitialState = array(initialState, dtype=complex)
+		self.AngularCount, self.RadialCount = self.InitialState.shape
+
+		angRange = GetAngularRepresentation(prop.psi).Range
+		self.AngularMomenta = [angRange.GetLmIndex(i).l for i in range(self.AngularCount)]
+		self.BSpline = GetRadialRepresentation(prop.psi).GetBSplineObject()
+
+		#Coupling over the full (angular, radial) space
+		couplings = []
+		for item in couplingPotentials:
+			if isinstance(item, tuple):
+				couplings.append(item)
+			else:
+				couplings.append((item, 1.0))
+		self.Coupling = SetupCoupledMatrix(prop, couplings).tocsr()
+
+		#Banded radial matrices of every partial wave, general storage for solve_banded
+		#(padded to a common bandwidth, the overlap may be narrower than H)
+		S, bandwidthS = SetupBandedOverlapMatrix(prop)
+		H = [SetupBandedRadialMatrix(prop, hamiltonianPotentials, angIdx)[0] \
+			for angIdx in range(self.AngularCount)]
+		self.Bandwidth = max([bandwidthS] + [h.shape[0] - 1 for h in H])
+		self.Overlap = GetGeneralBandedMatrix(self.PadBandwidth(S))
+		self.Hamiltonian = [GetGeneralBandedMatrix(self.PadBandwidth(h)) for h in H]
+
+	def PadBandwidth(self, banded):
+		padded = zeros((self.Bandwidth + 1, banded.shape[1]), dtype=banded.dtype)
+		padded[self.Bandwidth + 1 - banded.shape[0]:, :] = banded
+		return padded
+
+	def ApplyCoupling(self, psi):
+		return (self.Coupling * psi.ravel()).reshape(psi.shape)
+
+	def ApplyPropagator(self, energy, rhs):
+		"""
+		G(energy) rhs = (energy + i eps - H)^-1 rhs, per angular index.
+		Angular indices without source are skipped
+		"""
+		result = zeros(rhs.shape, dtype=complex)
+		z = energy + 1.0j * self.Epsilon
+		bandwidth = self.Bandwidth
+		for angIdx in range(self.AngularCount):
+			if not rhs[angIdx, :].any():
+				continue
+			shifted = z * self.Overlap - self.Hamiltonian[angIdx]
+			result[angIdx, :] = scipy.linalg.solve_banded((bandwidth, bandwidth), \
+				shifted, rhs[angIdx, :], check_finite=False)
+		return result
+
+	def GetPerturbedStates(self, frequency, photonCount):
+		"""
+		The chain psi_k, k = 0..photonCount-1, at the given photon energy
+		"""
+		states = [self.InitialState]
+		for k in range(1, photonCount):
+			energy = self.InitialEnergy + k * frequency
+			states.append(self.ApplyPropagator(energy, self.ApplyCoupling(states[-1])))
+		return states
+
+	def GetFinalStateCoefficients(self, l, energy):
+		"""
+		B-spline coefficients of the Coulomb wave with angular momentum l,
+		normalised per unit energy
+		"""
+		k = sqrt(2 * energy)
+		return sqrt(2 / (pi * k)) * GetRadialCoulombWaveBSplines(self.Z, l, k, self.BSpline)
+
+	def GetFrequencyAmplitudes(self, frequency, photonCount):
+		"""
+		M_l for all angular indices at one photon energy, zero for final
+		energies below threshold
+		"""
+		amplitudes = zeros(self.AngularCount, dtype=complex)
+		finalEnergy = self.InitialEnergy + photonCount * frequency
+		if finalEnergy <= 0:
+			return amplitudes
+
+		states = self.GetPerturbedStates(frequency, photonCount)
+		source = self.ApplyCoupling(states[-1])
+		for angIdx in range(self.AngularCount):
+			if not source[angIdx, :].any():
+				continue
+			coulombWave = self.GetFinalStateCoefficients(self.AngularMomenta[angIdx], finalEnergy)
+			amplitudes[angIdx] = (coulombWave.conj() * source[angIdx, :]).sum()
+		return amplitudes
+
+	def GetAmplitudes(self, frequencies, photonCount=1, procCount=None):
+		"""
+		M[frequencyIndex, angularIndex] for all frequencies, computed in
+		parallel over the frequencies
+		"""
+		frequencies = asarray(frequencies, dtype=double)
+		self.Logger.info("Computing %i photon amplitudes for %i frequencies" % \
+			(photonCount, len(frequencies)))
+
+		def amplitudeFunc(block, amplitudes):
+			freqIdx, frequency = block
+			amplitudes[freqIdx, :] += self.GetFrequencyAmplitudes(frequency, photonCount)
+
+		blocks = list(enumerate(frequencies))
+		resultSpecs = [((len(frequencies), self.AngularCount), complex)]
+		return ParallelReduce(amplitudeFunc, blocks, resultSpecs, procCount)[0]
+
+
+@RegisterAll
+def GetGeneralizedCrossSection(amplitudes, frequencies, photonCount=1, gauge="length"):
+	"""
+	sigma = GetGeneralizedCrossSection(amplitudes, frequencies, photonCount, gauge)
+
+	The generalised n photon cross section in atomic units
+	(a0^2n t^(n-1)), for a linearly polarised field with intensity
+	I = F^2 / (8 pi alpha),
+
+		sigma_n = 2 pi (2 pi alpha w)^n sum_l |M_l|^2
+
+	Parametres
+	----------
+	amplitudes:  (array) M[frequencyIndex, angularIndex] from
+	             PerturbativeAmplitudes.GetAmplitudes
+	frequencies: (array) the photon energies
+	photonCount: (int) n
+	gauge:       (string) "length" for the z coupling, "velocity" for
+	             the p_z coupling, whose on shell amplitudes are larger
+	             by w^n
+	"""
+	frequencies = asarray(frequencies, dtype=double)
+	probability = (abs(amplitudes)**2).sum(axis=1)
+	if gauge == "velocity":
+		probability /= frequencies**(2 * photonCount)
+	elif gauge != "length":
+		raise Exception("Unknown gauge '%s'" % gauge)
+	return 2 * pi * (2 * pi * FineStructureConstant * frequencies)**photonCount * probability
@@ -5,6 +5,8 @@
 
 // Includes ====================================================================
 #include <analysis.cpp>
+#include <boundstateprojector.cpp>
+#include <nativetasks.cpp>
 
 // Using =======================================================================
 using namespace boost::python;
@@ -12,6 +14,34 @@ using namespace boost::python;
 // Module ======================================================================
 BOOST_PYTHON_MODULE(libeinpartikkelanalysis)
 {
+    class_< BoundStateProjector >("BoundStateProjector", init<  >())
+        .def(init< const BoundStateProjector& >())
+        .def("Setup", &BoundStateProjector::Setup)
+        .def("AddBlock", &BoundStateProjector::AddBlock)
+        .def("SetAngularBlock", &BoundStateProjector::SetAngularBlock)
+        .def("GetBoundStateCount", &BoundStateProjector::GetBoundStateCount)
+        .def("ApplyProjection", &BoundStateProjector::ApplyProjection)
+        .def("RemoveProjection", &BoundStateProjector::RemoveProjection)
+        .def("GetBoundPopulation", &BoundStateProjector::GetBoundPopulation)
+    ;
+
+    class_< NativeTaskList, boost::noncopyable >("NativeTaskList", init<  >())
+        .def("AddTensorExpectationTask", &NativeTaskList::AddTensorExpectationTask)
+        .def("AddBoundPopulationTask", &NativeTaskList::AddBoundPopulationTask, with_custodian_and_ward< 1, 3 >())
+        .def("Setup", &NativeTaskList::Setup)
+        .def("Step", &NativeTaskList::Step)
+        .def("PostProcess", &NativeTaskList::PostProcess)
+        .def("GetTaskCount", &NativeTaskList::GetTaskCount)
+        .def("GetTaskName", &NativeTaskList::GetTaskName)
+        .def("GetSampleCount", &NativeTaskList::GetSampleCount)
+        .def("GetSampleTimes", &NativeTaskList::GetSampleTimes)
+        .def("GetResults", &NativeTaskList::GetResults)
+    ;
+
     def("SetRadialCoulombWave",  SetRadialCoulombWave);
+    def("GetInstrumentationReport", GetInstrumentationReport);
+    def("ResetInstrumentation", ResetInstrumentation);
+    def("IsInstrumentationEnabled", IsInstrumentationEnabled);
+    def("IsPerfCountersAvailable", IsPerfCountersAvailable);
 }
 
@@ -18,4 +18,5 @@ for key in above.__dict__.iterkeys():
 	if not key.startswith("__"):
 		RegisterProjectNamespace(eval(key))
 
-__all__ = ["above", "preconditioner", "indexiterators"]
+__all__ = ["above", "preconditioner", "indexiterators", "bufferpool", "overlap", \
+	"potentialgeneration", "fedvr", "prolatespheroidal", "laserpulse", "layout", "memoryplacement"]
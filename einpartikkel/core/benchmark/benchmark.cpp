@@ -0,0 +1,424 @@
+/*
+ * Benchmark for the potential evaluators exported in wrapper.pyste.
+ *
+ * For every (lmax, xsize, order) combination a spherical harmonic/B-spline
+ * wavefunction is set up through pyprop (embedded python), and
+ * UpdatePotentialData is called repeatedly for each evaluator on a
+ * potential data array of the shape given by the evaluator's angular
+ * geometry. Wall time, heap allocations and bytes written per call are
+ * reported as JSON.
+ *
+ * The non-dipole evaluators use the "Dense" angular geometry, as in
+ * propagation. Evaluators whose potential data would exceed
+ * --max-data-mb (default 1024) are skipped.
+ *
+ * --layout selects the wavefunction layouts (see einpartikkel/core/layout.py),
+ * angular_major storing data as [angular, radial] and radial_major as
+ * [radial, angular].
+ *
+ * Usage:
+ *   evaluatorbenchmark [--lmax 5,10] [--xsize 20,40] [--order 5,7]
+ *                      [--layout angular_major,radial_major]
+ *                      [--repeat 5] [--max-data-mb 1024]
+ *                      [--config benchmark.ini] [--output file]
+ */
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <new>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <time.h>
+
+#include <boost/python.hpp>
+
+#include <diatomicpotential.cpp>
+#include <nondipole.cpp>
+#include <potential.cpp>
+#include <spherical.cpp>
+#include <sphericallength.cpp>
+#include <sphericalvelocity.cpp>
+#include <sphericalvelocity_x.cpp>
+#include <sphericalvelocity_y.cpp>
+#include <tabulatedpotential.cpp>
+
+namespace bp = boost::python;
+
+/*
+ * Heap allocation counting. Only active while an evaluator is timed.
+ */
+namespace AllocationCounter
+{
+	volatile bool Enabled = false;
+	volatile long Count = 0;
+	volatile long Bytes = 0;
+
+	inline void Record(std::size_t size)
+	{
+		if (Enabled)
+		{
+			__sync_fetch_and_add(&Count, 1);
+			__sync_fetch_and_add(&Bytes, (long)size);
+		}
+	}
+}
+
+#if __cplusplus >= 201103L
+#define BENCHMARK_THROW_BADALLOC
+#define BENCHMARK_NOTHROW noexcept
+#else
+#define BENCHMARK_THROW_BADALLOC throw(std::bad_alloc)
+#define BENCHMARK_NOTHROW throw()
+#endif
+
+void* operator new(std::size_t size) BENCHMARK_THROW_BADALLOC
+{
+	AllocationCounter::Record(size);
+	void *ptr = std::malloc(size == 0 ? 1 : size);
+	if (ptr == 0) throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new[](std::size_t size) BENCHMARK_THROW_BADALLOC
+{
+	AllocationCounter::Record(size);
+	void *ptr = std::malloc(size == 0 ? 1 : size);
+	if (ptr == 0) throw std::bad_alloc();
+	return ptr;
+}
+
+void operator delete(void *ptr) BENCHMARK_NOTHROW
+{
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr) BENCHMARK_NOTHROW
+{
+	std::free(ptr);
+}
+
+/*
+ * Python code setting up the wavefunction for one benchmark point
+ */
+static const char *SetupCode =
+	"import pyprop\n"
+	"import einpartikkel\n"
+	"from einpartikkel.core.indexiterators import DefaultLmIndexIterator\n"
+	"from einpartikkel.core.layout import ApplyWavefunctionLayout\n"
+	"def SetupBenchmarkProblem(configFile, lmax, xsize, order, layout):\n"
+	"	conf = pyprop.Load(configFile)\n"
+	"	conf.SetValue('AngularRepresentation', 'index_iterator', DefaultLmIndexIterator(lmax))\n"
+	"	conf.SetValue('RadialRepresentation', 'xsize', xsize)\n"
+	"	conf.SetValue('RadialRepresentation', 'order', order)\n"
+	"	ApplyWavefunctionLayout(conf, layout)\n"
+	"	prop = pyprop.Problem(conf)\n"
+	"	return conf, prop.psi\n";
+
+typedef blitz::Array<int, 2> BasisPairList;
+
+double GetWallTime()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+/*
+ * Angular basis pairs for the geometries used by the evaluators
+ */
+BasisPairList CreateAngularBasisPairs(const std::string &geometry, Wavefunction<2>::Ptr psi, int angularRank)
+{
+	typedef CombinedRepresentation<2> CmbRepr;
+	CmbRepr::Ptr repr = boost::static_pointer_cast< CmbRepr >(psi->GetRepresentation());
+	SphericalHarmonicBasisRepresentation::Ptr angRepr = boost::static_pointer_cast< SphericalHarmonicBasisRepresentation >(repr->GetRepresentation(angularRank));
+	int angCount = psi->GetData().extent(angularRank);
+
+	std::vector<int> left, right;
+	for (int i=0; i<angCount; i++)
+	{
+		LmIndex lmLeft = angRepr->Range.GetLmIndex(i);
+		for (int j=0; j<angCount; j++)
+		{
+			LmIndex lmRight = angRepr->Range.GetLmIndex(j);
+			int dl = std::abs(lmLeft.l - lmRight.l);
+			int dm = std::abs(lmLeft.m - lmRight.m);
+
+			bool include;
+			if (geometry == "diagonal") include = (i == j);
+			else if (geometry == "linear") include = (dl == 1 && dm == 0);
+			else if (geometry == "perpendicular") include = (dl == 1 && dm == 1);
+			else if (geometry == "diatomic") include = (dl % 2 == 0 && dm == 0);
+			else if (geometry == "dense") include = true;
+			else throw std::runtime_error("Unknown benchmark geometry " + geometry);
+
+			if (include)
+			{
+				left.push_back(i);
+				right.push_back(j);
+			}
+		}
+	}
+
+	BasisPairList pairs(left.size(), 2);
+	for (int i=0; i<(int)left.size(); i++)
+	{
+		pairs(i, 0) = left[i];
+		pairs(i, 1) = right[i];
+	}
+	return pairs;
+}
+
+struct BenchmarkPoint
+{
+	int Lmax;
+	int XSize;
+	int Order;
+	std::string Layout;
+	int Repeat;
+	double MaxDataBytes;
+	bp::object Config;
+	Wavefunction<2>::Ptr Psi;
+	std::vector<std::string> Results;
+};
+
+/*
+ * Time UpdatePotentialData on data for an initialized evaluator
+ */
+template<class Evaluator>
+void TimeEvaluator(const std::string &name, const std::string &geometry, Evaluator &evaluator, blitz::Array<cplx, 2> data, BenchmarkPoint &point)
+{
+	cplx timeStep(0.01, 0);
+	double curTime = 1.0;
+
+	//Warmup call, not timed
+	evaluator.UpdatePotentialData(data, point.Psi, timeStep, curTime);
+
+	double minTime = 1e300;
+	double totalTime = 0;
+	AllocationCounter::Count = 0;
+	AllocationCounter::Bytes = 0;
+	for (int i=0; i<point.Repeat; i++)
+	{
+		AllocationCounter::Enabled = true;
+		double start = GetWallTime();
+		evaluator.UpdatePotentialData(data, point.Psi, timeStep, curTime);
+		double elapsed = GetWallTime() - start;
+		AllocationCounter::Enabled = false;
+
+		minTime = std::min(minTime, elapsed);
+		totalTime += elapsed;
+	}
+
+	std::ostringstream json;
+	json << "{\"evaluator\": \"" << name << "\", "
+	     << "\"geometry\": \"" << geometry << "\", "
+	     << "\"lmax\": " << point.Lmax << ", "
+	     << "\"xsize\": " << point.XSize << ", "
+	     << "\"order\": " << point.Order << ", "
+	     << "\"layout\": \"" << point.Layout << "\", "
+	     << "\"shape\": [" << data.extent(0) << ", " << data.extent(1) << "], "
+	     << "\"repeat\": " << point.Repeat << ", "
+	     << "\"time_min\": " << minTime << ", "
+	     << "\"time_mean\": " << totalTime / point.Repeat << ", "
+	     << "\"allocations_per_call\": " << (double)AllocationCounter::Count / point.Repeat << ", "
+	     << "\"allocated_bytes_per_call\": " << (double)AllocationCounter::Bytes / point.Repeat << ", "
+	     << "\"bytes_written_per_call\": " << data.size() * sizeof(cplx) << "}";
+	point.Results.push_back(json.str());
+	std::cerr << "  " << name << ": " << minTime << " s" << std::endl;
+}
+
+/*
+ * Evaluators with angular basis pairs (CustomPotential)
+ */
+template<class Evaluator>
+void RunCustomEvaluator(const std::string &name, const std::string &section, const std::string &geometry, BenchmarkPoint &point)
+{
+	ConfigSection config(point.Config.attr(section.c_str()));
+	int angularRank, radialRank;
+	config.Get("angular_rank", angularRank);
+	config.Get("radial_rank", radialRank);
+
+	BasisPairList pairs = CreateAngularBasisPairs(geometry, point.Psi, angularRank);
+	blitz::TinyVector<int, 2> shape;
+	shape(angularRank) = pairs.extent(0);
+	shape(radialRank) = point.Psi->GetRepresentation()->GetLocalGrid(radialRank).extent(0);
+	double dataBytes = (double)shape(0) * shape(1) * sizeof(cplx);
+	if (dataBytes > point.MaxDataBytes)
+	{
+		std::cerr << "  " << name << ": skipped, " << dataBytes / (1024*1024) << " MB of potential data" << std::endl;
+		return;
+	}
+
+	Evaluator evaluator;
+	evaluator.ApplyConfigSection(config);
+	evaluator.SetBasisPairs(angularRank, pairs);
+	blitz::Array<cplx, 2> data(shape);
+
+	TimeEvaluator(name, geometry, evaluator, data, point);
+}
+
+/*
+ * Evaluators on the diagonal grid (PotentialBase through DynamicPotentialEvaluator)
+ */
+template<class Potential>
+void RunGridEvaluator(const std::string &name, const std::string &section, BenchmarkPoint &point)
+{
+	ConfigSection config(point.Config.attr(section.c_str()));
+
+	DynamicPotentialEvaluator<Potential, 2> evaluator;
+	evaluator.ApplyConfigSection(config);
+
+	blitz::Array<cplx, 2> data(point.Psi->GetData().shape());
+	TimeEvaluator(name, "diagonal", evaluator, data, point);
+}
+
+void RunBenchmarkPoint(BenchmarkPoint &point)
+{
+	RunCustomEvaluator< CustomPotential_AngularKineticEnergy_Spherical<2> >("CustomPotential_AngularKineticEnergy_Spherical", "AngularKineticEnergy", "diagonal", point);
+	RunCustomEvaluator< SphericalKineticEnergyEvaluator<2> >("SphericalKineticEnergyEvaluator", "AngularKineticEnergy", "diagonal", point);
+	RunCustomEvaluator< CustomPotential_LaserLength_Z<2> >("CustomPotential_LaserLength_Z", "LaserLength", "linear", point);
+	RunCustomEvaluator< CustomPotential_LaserLength_X<2> >("CustomPotential_LaserLength_X", "LaserLength", "perpendicular", point);
+	RunCustomEvaluator< CustomPotential_LaserLength_Y<2> >("CustomPotential_LaserLength_Y", "LaserLength", "perpendicular", point);
+	RunCustomEvaluator< CustomPotential_LaserVelocity<2> >("CustomPotential_LaserVelocity", "LaserVelocity", "linear", point);
+	RunCustomEvaluator< CustomPotential_LaserVelocity_X<2> >("CustomPotential_LaserVelocity_X", "LaserVelocity", "perpendicular", point);
+	RunCustomEvaluator< CustomPotential_LaserVelocity_Y<2> >("CustomPotential_LaserVelocity_Y", "LaserVelocity", "perpendicular", point);
+	RunCustomEvaluator< CustomPotential_LaserVelocityDerivativeR<2> >("CustomPotential_LaserVelocityDerivativeR", "LaserVelocity", "linear", point);
+	RunCustomEvaluator< CustomPotential_LaserVelocityDerivativeR_X<2> >("CustomPotential_LaserVelocityDerivativeR_X", "LaserVelocity", "perpendicular", point);
+	RunCustomEvaluator< CustomPotential_LaserVelocityDerivativeR_Y<2> >("CustomPotential_LaserVelocityDerivativeR_Y", "LaserVelocity", "perpendicular", point);
+	RunCustomEvaluator< DiatomicCoulombPotential<2> >("DiatomicCoulombPotential", "DiatomicCoulombPotential", "diatomic", point);
+	RunCustomEvaluator< CustomPotential_TabulatedRadial<2> >("CustomPotential_TabulatedRadial", "TabulatedPotential", "diagonal", point);
+	RunCustomEvaluator< CustomPotential_NonDipole<2> >("CustomPotential_NonDipole", "NonDipolePotential", "dense", point);
+	RunCustomEvaluator< CustomPotential_NonDipoleVelocity<2> >("CustomPotential_NonDipoleVelocity", "NonDipoleVelocity", "dense", point);
+	RunCustomEvaluator< CustomPotential_NonDipoleVelocityDerivativeR<2> >("CustomPotential_NonDipoleVelocityDerivativeR", "NonDipoleVelocity", "dense", point);
+
+	RunGridEvaluator< KineticEnergyPotential<2> >("KineticEnergyPotential", "RadialKineticEnergy", point);
+	RunGridEvaluator< CoulombPotential<2> >("CoulombPotential", "CoulombPotential", point);
+	RunGridEvaluator< SingleActiveElectronPotential<2> >("SingleActiveElectronPotential", "SAEPotential", point);
+	RunGridEvaluator< OverlapPotential<2> >("OverlapPotential", "OverlapPotential", point);
+	RunGridEvaluator< ComplexAbsorbingPotential<2> >("ComplexAbsorbingPotential", "Absorber", point);
+}
+
+std::vector<int> ParseIntList(const std::string &str)
+{
+	std::vector<int> values;
+	std::istringstream stream(str);
+	std::string item;
+	while (std::getline(stream, item, ','))
+	{
+		values.push_back(std::atoi(item.c_str()));
+	}
+	return values;
+}
+
+std::vector<std::string> ParseStringList(const std::string &str)
+{
+	std::vector<std::string> values;
+	std::istringstream stream(str);
+	std::string item;
+	while (std::getline(stream, item, ','))
+	{
+		values.push_back(item);
+	}
+	return values;
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<int> lmaxList = ParseIntList("5,10,20");
+	std::vector<int> xsizeList = ParseIntList("40,80");
+	std::vector<int> orderList = ParseIntList("5,7");
+	std::vector<std::string> layoutList = ParseStringList("angular_major");
+	int repeat = 5;
+	double maxDataMB = 1024;
+	std::string configFile = "benchmark.ini";
+	std::string outputFile = "";
+
+	for (int i=1; i<argc; i++)
+	{
+		std::string arg = argv[i];
+		if (i+1 >= argc)
+		{
+			std::cerr << "Missing value for " << arg << std::endl;
+			return 1;
+		}
+		std::string value = argv[++i];
+		if (arg == "--lmax") lmaxList = ParseIntList(value);
+		else if (arg == "--xsize") xsizeList = ParseIntList(value);
+		else if (arg == "--order") orderList = ParseIntList(value);
+		else if (arg == "--layout") layoutList = ParseStringList(value);
+		else if (arg == "--repeat") repeat = std::max(1, std::atoi(value.c_str()));
+		else if (arg == "--max-data-mb") maxDataMB = std::atof(value.c_str());
+		else if (arg == "--config") configFile = value;
+		else if (arg == "--output") outputFile = value;
+		else
+		{
+			std::cerr << "Unknown argument " << arg << std::endl;
+			return 1;
+		}
+	}
+
+	Py_Initialize();
+	std::vector<std::string> results;
+	try
+	{
+		bp::object mainModule = bp::import("__main__");
+		bp::object mainNamespace = mainModule.attr("__dict__");
+		bp::exec(SetupCode, mainNamespace, mainNamespace);
+		bp::object setupProblem = mainNamespace["SetupBenchmarkProblem"];
+
+		for (size_t li=0; li<lmaxList.size(); li++)
+		for (size_t xi=0; xi<xsizeList.size(); xi++)
+		for (size_t oi=0; oi<orderList.size(); oi++)
+		for (size_t ai=0; ai<layoutList.size(); ai++)
+		{
+			BenchmarkPoint point;
+			point.Lmax = lmaxList[li];
+			point.XSize = xsizeList[xi];
+			point.Order = orderList[oi];
+			point.Layout = layoutList[ai];
+			point.Repeat = repeat;
+			point.MaxDataBytes = maxDataMB * 1024 * 1024;
+
+			std::cerr << "lmax = " << point.Lmax << ", xsize = " << point.XSize << ", order = " << point.Order << ", layout = " << point.Layout << std::endl;
+			bp::tuple problem = bp::extract<bp::tuple>(setupProblem(configFile, point.Lmax, point.XSize, point.Order, point.Layout));
+			point.Config = problem[0];
+			point.Psi = bp::extract<Wavefunction<2>::Ptr>(problem[1]);
+
+			RunBenchmarkPoint(point);
+			results.insert(results.end(), point.Results.begin(), point.Results.end());
+		}
+	}
+	catch (bp::error_already_set &)
+	{
+		PyErr_Print();
+		return 1;
+	}
+	catch (std::exception &ex)
+	{
+		std::cerr << "Benchmark failed: " << ex.what() << std::endl;
+		return 1;
+	}
+
+	std::ostringstream json;
+	json << "{\"benchmark\": \"evaluators\", \"results\": [" << std::endl;
+	for (size_t i=0; i<results.size(); i++)
+	{
+		json << "  " << results[i] << (i+1 < results.size() ? "," : "") << std::endl;
+	}
+	json << "]}" << std::endl;
+
+	if (outputFile.empty())
+	{
+		std::cout << json.str();
+	}
+	else
+	{
+		std::ofstream out(outputFile.c_str());
+		out << json.str();
+	}
+
+	return 0;
+}
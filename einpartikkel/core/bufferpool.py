@@ -0,0 +1,135 @@
+"""
+bufferpool
+==========
+
+Reusable wavefunction buffers for temporaries.
+
+Creating a temporary with psi.Copy() allocates (and page faults) a full
+wavefunction every time. A WavefunctionBufferPool hands out wavefunctions
+of the same shape and representation as a template psi, and recycles them
+when they are returned.
+
+The pool counts checkouts, reuses and allocations, and the high-water mark
+of the bytes checked out at once and held by the pool (checked out and
+free), reported by FormatReport(). Propagate logs the report of the
+default pool when the propagation is finished.
+
+"""
+from __future__ import with_statement
+from contextlib import contextmanager
+from pyprop.pyproplogging import GetClassLogger
+from ..utils import RegisterAll
+from ..memoryledger import GetMemoryLedger
+
+
+@RegisterAll
+class WavefunctionBufferPool(object):
+	"""
+	A pool of wavefunction buffers with checkout/return semantics.
+
+	Buffers are keyed on data shape and representation type, so a buffer
+	checked out with one psi can be reused for any psi of the same layout.
+
+	Example
+	-------
+	>>> pool = WavefunctionBufferPool()
+	>>> with pool.Buffer(psi, copyData=True) as tmpPsi:
+	>>>     tmpPsi.GetRepresentation().MultiplyOverlap(tmpPsi)
+	"""
+
+	def __init__(self):
+		self.Logger = GetClassLogger(self)
+		self._FreeBuffers = {}
+		self._CheckedOut = set()
+		self.AllocationCount = 0
+		self.CheckoutCount = 0
+		self.CheckedOutBytes = 0
+		self.PeakCheckedOutBytes = 0
+		self.PooledBytes = 0
+		self.PeakPooledBytes = 0
+
+	def _GetKey(self, psi):
+		data = psi.GetData()
+		return (data.shape, data.dtype.str, \
+			psi.GetRepresentation().__class__.__name__)
+
+	def Checkout(self, psi, copyData=False):
+		"""
+		Returns a wavefunction with the same layout as psi. The data is
+		undefined unless copyData is True, in which case it is a copy of
+		the data of psi.
+		"""
+		freeList = self._FreeBuffers.setdefault(self._GetKey(psi), [])
+		if len(freeList) > 0:
+			buf = freeList.pop()
+			#The data of a reused buffer changes, drop any cached S psi of it
+			from overlap import InvalidateOverlap
+			InvalidateOverlap(buf)
+			if copyData:
+				buf.GetData()[:] = psi.GetData()
+		else:
+			buf = psi.Copy()
+			self.AllocationCount += 1
+			GetMemoryLedger().Register("BufferPool", "Wavefunction buffer", buf.GetData().nbytes, owner=buf)
+			self.PooledBytes += buf.GetData().nbytes
+			self.PeakPooledBytes = max(self.PeakPooledBytes, self.PooledBytes)
+
+		self.CheckoutCount += 1
+		self._CheckedOut.add(id(buf))
+		self.CheckedOutBytes += buf.GetData().nbytes
+		self.PeakCheckedOutBytes = max(self.PeakCheckedOutBytes, self.CheckedOutBytes)
+		return buf
+
+	def Return(self, buf):
+		"""
+		Return a buffer obtained from Checkout() to the pool. The buffer
+		must not be used after it is returned.
+		"""
+		if not id(buf) in self._CheckedOut:
+			raise Exception("Buffer was not checked out from this pool, or returned twice")
+		self._CheckedOut.remove(id(buf))
+		self.CheckedOutBytes -= buf.GetData().nbytes
+		self._FreeBuffers.setdefault(self._GetKey(buf), []).append(buf)
+
+	@contextmanager
+	def Buffer(self, psi, copyData=False):
+		"""
+		Context manager checking out a buffer, and returning it on exit
+		"""
+		buf = self.Checkout(psi, copyData)
+		try:
+			yield buf
+		finally:
+			self.Return(buf)
+
+	def Clear(self):
+		"""
+		Release all free buffers
+		"""
+		for freeList in self._FreeBuffers.itervalues():
+			self.PooledBytes -= sum([buf.GetData().nbytes for buf in freeList])
+		self._FreeBuffers.clear()
+
+	def FormatReport(self):
+		MB = 1024.**2
+		reuseCount = self.CheckoutCount - self.AllocationCount
+		lines = ["Wavefunction buffer pool: %i checkouts, %i reused, %i allocated" % \
+			(self.CheckoutCount, reuseCount, self.AllocationCount)]
+		lines.append("  Checked out: %.1f MB (high-water %.1f MB)" % \
+			(self.CheckedOutBytes / MB, self.PeakCheckedOutBytes / MB))
+		lines.append("  Held by pool: %.1f MB (high-water %.1f MB)" % \
+			(self.PooledBytes / MB, self.PeakPooledBytes / MB))
+		return "\n".join(lines)
+
+	def LogReport(self):
+		self.Logger.info(self.FormatReport())
+
+
+_DefaultBufferPool = WavefunctionBufferPool()
+
+@RegisterAll
+def GetDefaultBufferPool():
+	"""
+	Returns the process wide wavefunction buffer pool
+	"""
+	return _DefaultBufferPool
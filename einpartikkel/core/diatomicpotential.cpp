@@ -32,6 +32,8 @@ public:
 	virtual void UpdatePotentialData(typename blitz::Array<cplx,Rank> data,
 	   typename Wavefunction<Rank>::Ptr psi, cplx timeStep, double curTime)
 	{
+		INSTRUMENT_SCOPE("DiatomicCoulombPotential::UpdatePotentialData");
+		INSTRUMENT_BYTES("DiatomicCoulombPotential::UpdatePotentialData", data.size() * sizeof(cplx));
 		
 		typedef CombinedRepresentation<Rank> CmbRepr;
 		typedef SphericalHarmonicBasisRepresentation SphHarmRepr;
@@ -0,0 +1,347 @@
+"""
+fedvr
+=====
+
+Finite element discrete variable representation (FEDVR) of the radial
+coordinate.
+
+The radial interval is divided into elements, and each element carries the
+Lagrange interpolating polynomials on its Gauss-Lobatto nodes. Functions on
+neighbouring elements sharing a boundary node are joined into one bridge
+function, so the basis is continuous. With Gauss-Lobatto quadrature
+
+	<chi_i|chi_j> = delta_ij
+	<chi_i|V|chi_j> = V(r_i) delta_ij
+
+so the overlap is the identity and local potentials are diagonal. Only
+derivative operators couple basis functions, and only within an element,
+giving banded matrices of bandwidth order - 1.
+
+The end nodes r = xmin and r = xmax are removed (psi = 0 at the boundaries),
+unless keepFirstNode is given for coordinates with a natural boundary
+condition at xmin (see prolatespheroidal.py).
+
+Scope
+-----
+This is a standalone radial basis, used by the prolate spheroidal
+eigensolver (prolatespheroidal.py) and for radial eigenstates of local
+potentials. It is NOT a pyprop representation, and cannot be selected in
+[RadialRepresentation]: the problem setup, the propagators, the
+eigenstate tasks (eigenvalues.py) and the analysis (analysis/) all still
+use BSplineRepresentation and its non-diagonal overlap. Using FEDVR there
+requires
+
+  - a FEDVR representation in pyprop (grid, overlap, MultiplyOverlap, and
+    the tensor potential projection onto the basis)
+  - FEDVR versions of the evaluators coupling radial basis functions,
+    KineticEnergyPotential and the d/dr terms of the velocity gauge laser
+    couplings, whose matrices are GetKineticMatrix() and
+    GetDerivativeMatrix() rather than pointwise values. Only the purely
+    local terms (centrifugal, Coulomb, length gauge couplings) reduce to
+    values on the grid.
+
+Example
+-------
+>>> basis = FEDVRRadialBasis(GetElementBoundaries(0, 100, 50), 8)
+>>> E, V = basis.GetRadialEigenstates(0, lambda r: -1. / r, count=3)
+
+"""
+from numpy import array, zeros, ones, arange, cos, pi, sqrt, exp, \
+	linspace, abs, double, concatenate, asarray, diag, dot, conj, prod, \
+	searchsorted, clip, atleast_1d
+import scipy.linalg
+from ..utils import RegisterAll
+
+
+@RegisterAll
+def GetGaussLobattoQuadrature(nodeCount):
+	"""
+	nodes, weights, derivative = GetGaussLobattoQuadrature(nodeCount)
+
+	Gauss-Lobatto-Legendre nodes (ascending) and weights on [-1, 1], and
+	the derivative matrix derivative[k, j] = f_j'(x_k) of the Lagrange
+	polynomials f_j on the nodes.
+	"""
+	if nodeCount < 2:
+		raise Exception("Gauss-Lobatto quadrature needs at least 2 nodes")
+	N = nodeCount - 1
+
+	#Newton iteration for the roots of (1 - x^2) P_N'(x), starting from the
+	#Chebyshev-Gauss-Lobatto nodes
+	x = -cos(pi * arange(N + 1) / N)
+	P = zeros((N + 1, N + 1), dtype=double)
+	for iteration in range(100):
+		P[:, 0] = 1
+		P[:, 1] = x
+		for k in range(2, N + 1):
+			P[:, k] = ((2 * k - 1) * x * P[:, k - 1] - (k - 1) * P[:, k - 2]) / k
+		dx = (x * P[:, N] - P[:, N - 1]) / ((N + 1) * P[:, N])
+		x = x - dx
+		if max(abs(dx)) < 1e-15:
+			break
+
+	P[:, 0] = 1
+	P[:, 1] = x
+	for k in range(2, N + 1):
+		P[:, k] = ((2 * k - 1) * x * P[:, k - 1] - (k - 1) * P[:, k - 2]) / k
+	PN = P[:, N]
+	weights = 2. / (N * (N + 1) * PN**2)
+
+	derivative = zeros((N + 1, N + 1), dtype=double)
+	for k in range(N + 1):
+		for j in range(N + 1):
+			if k != j:
+				derivative[k, j] = PN[k] / PN[j] / (x[k] - x[j])
+	derivative[0, 0] = -N * (N + 1) / 4.
+	derivative[N, N] = N * (N + 1) / 4.
+
+	return x, weights, derivative
+
+
+@RegisterAll
+def GetGaussLegendreQuadrature(nodeCount):
+	"""
+	nodes, weights = GetGaussLegendreQuadrature(nodeCount)
+
+	Gauss-Legendre nodes (ascending) and weights on [-1, 1], from the
+	eigenvalues of the Jacobi matrix (Golub-Welsch)
+	"""
+	k = arange(1, nodeCount, dtype=double)
+	offDiagonal = k / sqrt(4 * k**2 - 1)
+	nodes, vectors = scipy.linalg.eigh(diag(offDiagonal, 1) + diag(offDiagonal, -1))
+	weights = 2 * vectors[0, :]**2
+	return nodes, weights
+
+
+@RegisterAll
+def GetLagrangeDerivativeMatrix(nodes):
+	"""
+	derivative[k, j] = f_j'(x_k) for the Lagrange polynomials f_j on
+	arbitrary distinct nodes x
+	"""
+	n = len(nodes)
+	diff = nodes[:, None] - nodes[None, :] + diag(ones(n))
+	baryWeights = 1. / prod(diff, axis=1)
+	derivative = (baryWeights[None, :] / baryWeights[:, None]) / diff
+	derivative[arange(n), arange(n)] = 0
+	derivative[arange(n), arange(n)] = -derivative.sum(axis=1)
+	return derivative
+
+
+@RegisterAll
+def GetLagrangeValues(nodes, x):
+	"""
+	values[i, j] = f_j(x_i) for the Lagrange polynomials f_j on nodes
+	"""
+	x = atleast_1d(x)
+	values = ones((len(x), len(nodes)), dtype=double)
+	for j in range(len(nodes)):
+		for k in range(len(nodes)):
+			if k != j:
+				values[:, j] *= (x - nodes[k]) / (nodes[j] - nodes[k])
+	return values
+
+
+@RegisterAll
+def GetElementBoundaries(xmin, xmax, elementCount, xpartition=None, gamma=None, \
+		bpstype="linear"):
+	"""
+	Element boundaries for a FEDVR basis, with the same breakpoint types as
+	the B-spline representation:
+
+	linear:            elementCount equally sized elements
+	exponentiallinear: elements grow exponentially (rate gamma) up to
+	                   xpartition, and are equally sized after it
+	"""
+	if bpstype == "linear":
+		return linspace(xmin, xmax, elementCount + 1)
+
+	elif bpstype == "exponentiallinear":
+		#Split the elements between the two regions by length, with at
+		#least one element on each side
+		innerCount = max(1, min(elementCount - 1, \
+			int(round(elementCount * (xpartition - xmin) / (xmax - xmin)))))
+		outerCount = elementCount - innerCount
+		t = arange(innerCount + 1) / float(innerCount)
+		inner = xmin + (xpartition - xmin) * (exp(gamma * t) - 1) / (exp(gamma) - 1)
+		outer = linspace(xpartition, xmax, outerCount + 1)
+		return concatenate([inner, outer[1:]])
+
+	else:
+		raise Exception("Unknown bpstype %s" % bpstype)
+
+
+@RegisterAll
+class FEDVRRadialBasis(object):
+	"""
+	FEDVR radial basis on the given element boundaries, with order
+	Gauss-Lobatto nodes in each element.
+
+	Basis functions are indexed by the interior nodes (and the first node
+	if keepFirstNode), Grid and Weights are the node positions and (summed)
+	quadrature weights.
+	"""
+
+	def __init__(self, elementBoundaries, order, keepFirstNode=False):
+		self.ElementBoundaries = array(elementBoundaries, dtype=double)
+		self.Order = order
+		self.ElementCount = len(self.ElementBoundaries) - 1
+		if self.ElementCount < 1:
+			raise Exception("FEDVR basis needs at least one element")
+		if order < 3:
+			raise Exception("FEDVR basis needs order >= 3")
+
+		self.LobattoNodes, self.LobattoWeights, self.LobattoDerivative = \
+			GetGaussLobattoQuadrature(order)
+
+		#Global nodes and weights, including the end points. Neighbouring
+		#elements share their boundary node
+		nodeCount = self.ElementCount * (order - 1) + 1
+		grid = zeros(nodeCount, dtype=double)
+		weights = zeros(nodeCount, dtype=double)
+		for e in range(self.ElementCount):
+			a, b = self.ElementBoundaries[e:e+2]
+			start = e * (order - 1)
+			grid[start:start+order] = a + (self.LobattoNodes + 1) * (b - a) / 2.
+			weights[start:start+order] += self.LobattoWeights * (b - a) / 2.
+
+		#Remove boundary nodes
+		self.FirstNode = 0 if keepFirstNode else 1
+		self.FullGrid = grid
+		self.FullWeights = weights
+		self.Grid = grid[self.FirstNode:-1]
+		self.Weights = weights[self.FirstNode:-1]
+		self.Size = len(self.Grid)
+		self.Bandwidth = order - 1
+
+	def GetElementNodes(self, element):
+		"""Global (full grid) node indices of element"""
+		start = element * (self.Order - 1)
+		return arange(start, start + self.Order)
+
+	def _AssembleElementMatrices(self, elementMatrix):
+		"""
+		Assemble a full grid matrix from the (order x order) matrices
+		elementMatrix(element), normalise by the weights and remove the
+		boundary nodes
+		"""
+		nodeCount = len(self.FullGrid)
+		matrix = zeros((nodeCount, nodeCount), dtype=double)
+		for e in range(self.ElementCount):
+			idx = self.GetElementNodes(e)
+			matrix[idx[0]:idx[-1]+1, idx[0]:idx[-1]+1] += elementMatrix(e)
+		norm = 1. / sqrt(self.FullWeights)
+		matrix *= norm[:, None] * norm[None, :]
+		return matrix[self.FirstNode:-1, self.FirstNode:-1]
+
+	def GetOverlapMatrix(self):
+		"""The overlap matrix is the identity"""
+		return diag(ones(self.Size, dtype=double))
+
+	def IsOverlapDiagonal(self):
+		return True
+
+	def GetStiffnessMatrix(self, weight=None):
+		"""
+		Matrix of <chi_i'|g|chi_j'> for the weight function g(r) (default 1)
+		"""
+		w = self.LobattoWeights
+		D = self.LobattoDerivative
+		def elementMatrix(e):
+			a, b = self.ElementBoundaries[e:e+2]
+			g = w
+			if weight != None:
+				g = w * weight(a + (self.LobattoNodes + 1) * (b - a) / 2.)
+			return (2. / (b - a)) * dot(D.transpose() * g[None, :], D)
+		return self._AssembleElementMatrices(elementMatrix)
+
+	def GetKineticMatrix(self, mass=1.0):
+		"""
+		Matrix of -1/(2 mass) d^2/dr^2, as 1/(2 mass) <chi_i'|chi_j'>
+		"""
+		return self.GetStiffnessMatrix() / (2. * mass)
+
+	def GetDerivativeMatrix(self):
+		"""
+		Matrix of d/dr, <chi_i|chi_j'>
+		"""
+		w = self.LobattoWeights
+		D = self.LobattoDerivative
+		def elementMatrix(e):
+			return w[:, None] * D
+		return self._AssembleElementMatrices(elementMatrix)
+
+	def GetPotentialDiagonal(self, potential):
+		"""Diagonal of a local potential V(r), evaluated at the nodes"""
+		return asarray(potential(self.Grid), dtype=double)
+
+	def GetCentrifugalDiagonal(self, l, mass=1.0):
+		"""Diagonal of l(l+1) / (2 mass r^2)"""
+		return l * (l + 1.) / (2. * mass * self.Grid**2)
+
+	def GetRadialHamiltonian(self, l, potential, mass=1.0):
+		"""
+		Radial Hamiltonian for angular momentum l and local potential V(r),
+		as a dense matrix
+		"""
+		H = self.GetKineticMatrix(mass)
+		idx = arange(self.Size)
+		H[idx, idx] += self.GetCentrifugalDiagonal(l, mass) + self.GetPotentialDiagonal(potential)
+		return H
+
+	def GetBandedMatrix(self, matrix):
+		"""
+		Upper banded storage (as used by scipy.linalg.eig_banded and
+		solveh_banded) of a symmetric matrix in this basis
+		"""
+		bw = self.Bandwidth
+		banded = zeros((bw + 1, self.Size), dtype=matrix.dtype)
+		for k in range(bw + 1):
+			banded[bw - k, k:] = matrix.diagonal(k)
+		return banded
+
+	def GetRadialEigenstates(self, l, potential, mass=1.0, count=None):
+		"""
+		E, V = GetRadialEigenstates(l, potential, mass, count)
+
+		The count lowest eigenpairs (all if count is None) of the radial
+		Hamiltonian. The overlap is the identity, so this is a standard
+		banded eigenproblem. The columns of V are the expansion coefficients.
+		"""
+		banded = self.GetBandedMatrix(self.GetRadialHamiltonian(l, potential, mass))
+		if count == None:
+			return scipy.linalg.eig_banded(banded, lower=False)
+		return scipy.linalg.eig_banded(banded, lower=False, select="i", \
+			select_range=(0, min(count, self.Size) - 1))
+
+	def ExpandFunction(self, func):
+		"""Expansion coefficients of the function func(r)"""
+		return sqrt(self.Weights) * func(self.Grid)
+
+	def GetBasisValues(self, x):
+		"""
+		values[i, j] = chi_j(x_i), for evaluating expansions at arbitrary
+		points x in [xmin, xmax]
+		"""
+		x = atleast_1d(x)
+		element = clip(searchsorted(self.ElementBoundaries, x) - 1, 0, self.ElementCount - 1)
+		values = zeros((len(x), len(self.FullGrid)), dtype=double)
+		for e in range(self.ElementCount):
+			idx = (element == e).nonzero()[0]
+			if len(idx) == 0:
+				continue
+			a, b = self.ElementBoundaries[e:e+2]
+			t = 2 * (x[idx] - a) / (b - a) - 1
+			nodes = self.GetElementNodes(e)
+			values[idx, nodes[0]:nodes[-1]+1] = GetLagrangeValues(self.LobattoNodes, t)
+		values /= sqrt(self.FullWeights)[None, :]
+		return values[:, self.FirstNode:-1]
+
+	def EvaluateAtNodes(self, coefficients):
+		"""Values at the nodes of the function with the given coefficients"""
+		return coefficients / sqrt(self.Weights)
+
+	def InnerProduct(self, left, right):
+		"""<left|right>, with the identity overlap"""
+		return dot(conj(left), right)
+
@@ -0,0 +1,383 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+/*
+ * Low overhead instrumentation of native hot paths.
+ *
+ *   INSTRUMENT_SCOPE("name")          time the enclosing scope, count calls
+ *   INSTRUMENT_BYTES("name", bytes)   add to the bytes touched by "name"
+ *
+ * Each instrumented site gets an integer id the first time it is reached,
+ * and counters are aggregated per thread without locking.
+ * GetInstrumentationReport() sums the threads, and returns one line
+ * per name: "name\tcalls\tseconds\tbytes".
+ *
+ * The macros expand to nothing unless USE_INSTRUMENTATION is defined
+ * (USE_INSTRUMENTATION := 1 in Makefile.dynamic).
+ *
+ * With USE_PERF_COUNTERS also defined, each scope additionally reads the
+ * hardware counters of the calling thread (cycles, instructions and last
+ * level cache misses) through perf_event_open, and the report lines get
+ * three more columns: "\tcycles\tinstructions\tcachemisses". If the
+ * counters cannot be opened (no PMU access, e.g. in containers or with
+ * perf_event_paranoid > 2) they are reported as zero.
+ */
+
+#include <string>
+
+#ifdef USE_INSTRUMENTATION
+
+#include <vector>
+#include <map>
+#include <sstream>
+#include <pthread.h>
+#include <time.h>
+
+#ifdef USE_PERF_COUNTERS
+#include <cstring>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+namespace Instrumentation
+{
+
+enum PerfCounterIndex
+{
+	PerfCycles = 0,
+	PerfInstructions,
+	PerfCacheMisses,
+	PerfCounterCount
+};
+
+struct Counter
+{
+	long Calls;
+	long Nanoseconds;
+	long Bytes;
+	long Perf[PerfCounterCount];
+
+	Counter() : Calls(0), Nanoseconds(0), Bytes(0) 
+	{
+		for (int i=0; i<PerfCounterCount; i++) Perf[i] = 0;
+	}
+};
+
+#ifdef USE_PERF_COUNTERS
+
+/*
+ * Hardware counters of one thread, opened as one perf event group so that
+ * all counters are read at once
+ */
+class ThreadPerfCounters
+{
+public:
+	ThreadPerfCounters() : GroupFd(-1)
+	{
+		static const unsigned long configs[PerfCounterCount] = {
+			PERF_COUNT_HW_CPU_CYCLES,
+			PERF_COUNT_HW_INSTRUCTIONS,
+			PERF_COUNT_HW_CACHE_MISSES
+		};
+
+		for (int i=0; i<PerfCounterCount; i++)
+		{
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = configs[i];
+			attr.read_format = PERF_FORMAT_GROUP;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+
+			//This thread, any cpu
+			int fd = syscall(__NR_perf_event_open, &attr, 0, -1, GroupFd, 0);
+			if (fd < 0)
+			{
+				Close();
+				return;
+			}
+			Fds.push_back(fd);
+			if (i == 0) GroupFd = fd;
+		}
+	}
+
+	~ThreadPerfCounters()
+	{
+		Close();
+	}
+
+	bool IsAvailable()
+	{
+		return GroupFd >= 0;
+	}
+
+	/*
+	 * Read the counters into values, returns false if not available
+	 */
+	bool Read(long *values)
+	{
+		if (GroupFd < 0) return false;
+
+		struct { unsigned long long Count; unsigned long long Values[PerfCounterCount]; } buffer;
+		if (read(GroupFd, &buffer, sizeof(buffer)) != (ssize_t)sizeof(buffer)) return false;
+		for (int i=0; i<PerfCounterCount; i++)
+		{
+			values[i] = (long)buffer.Values[i];
+		}
+		return true;
+	}
+
+private:
+	int GroupFd;
+	std::vector<int> Fds;
+
+	void Close()
+	{
+		for (size_t i=0; i<Fds.size(); i++) close(Fds[i]);
+		Fds.clear();
+		GroupFd = -1;
+	}
+};
+
+inline ThreadPerfCounters& GetThreadPerfCounters()
+{
+	static __thread ThreadPerfCounters *counters = 0;
+	if (counters == 0)
+	{
+		counters = new ThreadPerfCounters();
+	}
+	return *counters;
+}
+
+#endif
+
+typedef std::vector<Counter> ThreadCounters;
+
+/*
+ * Global registry of site names and of the per-thread counters
+ */
+class Registry
+{
+public:
+	std::vector<std::string> SiteNames;
+	std::vector<ThreadCounters*> Threads;
+	pthread_mutex_t Mutex;
+
+	Registry()
+	{
+		pthread_mutex_init(&Mutex, 0);
+	}
+
+	static Registry& Instance()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	int RegisterSite(const char *name)
+	{
+		pthread_mutex_lock(&Mutex);
+		int id = SiteNames.size();
+		SiteNames.push_back(name);
+		pthread_mutex_unlock(&Mutex);
+		return id;
+	}
+
+	ThreadCounters* RegisterThread()
+	{
+		ThreadCounters *counters = new ThreadCounters();
+		pthread_mutex_lock(&Mutex);
+		Threads.push_back(counters);
+		pthread_mutex_unlock(&Mutex);
+		return counters;
+	}
+};
+
+inline Counter& GetCounter(int siteId)
+{
+	static __thread ThreadCounters *counters = 0;
+	if (counters == 0)
+	{
+		counters = Registry::Instance().RegisterThread();
+	}
+	if ((int)counters->size() <= siteId)
+	{
+		//Only the owning thread resizes, the report reads under the mutex
+		pthread_mutex_lock(&Registry::Instance().Mutex);
+		counters->resize(siteId + 1);
+		pthread_mutex_unlock(&Registry::Instance().Mutex);
+	}
+	return (*counters)[siteId];
+}
+
+inline long GetNanoseconds()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+class ScopedTimer
+{
+public:
+	ScopedTimer(int siteId) : SiteId(siteId) 
+	{
+#ifdef USE_PERF_COUNTERS
+		HasPerf = GetThreadPerfCounters().Read(PerfStart);
+#endif
+		Start = GetNanoseconds();
+	}
+
+	~ScopedTimer()
+	{
+		long end = GetNanoseconds();
+		Counter &counter = GetCounter(SiteId);
+		counter.Calls++;
+		counter.Nanoseconds += end - Start;
+#ifdef USE_PERF_COUNTERS
+		long perfEnd[PerfCounterCount];
+		if (HasPerf && GetThreadPerfCounters().Read(perfEnd))
+		{
+			for (int i=0; i<PerfCounterCount; i++)
+			{
+				counter.Perf[i] += perfEnd[i] - PerfStart[i];
+			}
+		}
+#endif
+	}
+
+private:
+	int SiteId;
+	long Start;
+#ifdef USE_PERF_COUNTERS
+	bool HasPerf;
+	long PerfStart[PerfCounterCount];
+#endif
+};
+
+inline void AddBytes(int siteId, long bytes)
+{
+	GetCounter(siteId).Bytes += bytes;
+}
+
+} //Namespace Instrumentation
+
+#define INSTRUMENT_CONCAT_(a, b) a##b
+#define INSTRUMENT_CONCAT(a, b) INSTRUMENT_CONCAT_(a, b)
+
+#define INSTRUMENT_SCOPE(name) \
+	static const int INSTRUMENT_CONCAT(instrumentSite, __LINE__) = Instrumentation::Registry::Instance().RegisterSite(name); \
+	Instrumentation::ScopedTimer INSTRUMENT_CONCAT(instrumentTimer, __LINE__)(INSTRUMENT_CONCAT(instrumentSite, __LINE__))
+
+#define INSTRUMENT_BYTES(name, bytes) \
+	do { \
+		static const int instrumentBytesSite = Instrumentation::Registry::Instance().RegisterSite(name); \
+		Instrumentation::AddBytes(instrumentBytesSite, (long)(bytes)); \
+	} while (0)
+
+/*
+ * Sum counters over threads and sites with the same name
+ */
+inline std::string GetInstrumentationReport()
+{
+	using namespace Instrumentation;
+	Registry &registry = Registry::Instance();
+
+	std::map<std::string, Counter> totals;
+	pthread_mutex_lock(&registry.Mutex);
+	for (size_t t=0; t<registry.Threads.size(); t++)
+	{
+		ThreadCounters &counters = *registry.Threads[t];
+		for (size_t site=0; site<counters.size(); site++)
+		{
+			Counter &total = totals[registry.SiteNames[site]];
+			total.Calls += counters[site].Calls;
+			total.Nanoseconds += counters[site].Nanoseconds;
+			total.Bytes += counters[site].Bytes;
+			for (int i=0; i<PerfCounterCount; i++)
+			{
+				total.Perf[i] += counters[site].Perf[i];
+			}
+		}
+	}
+	pthread_mutex_unlock(&registry.Mutex);
+
+	std::ostringstream report;
+	for (std::map<std::string, Counter>::iterator i=totals.begin(); i!=totals.end(); i++)
+	{
+		report << i->first << "\t" << i->second.Calls << "\t"
+		       << i->second.Nanoseconds * 1e-9 << "\t" << i->second.Bytes;
+#ifdef USE_PERF_COUNTERS
+		for (int j=0; j<PerfCounterCount; j++)
+		{
+			report << "\t" << i->second.Perf[j];
+		}
+#endif
+		report << "\n";
+	}
+	return report.str();
+}
+
+inline void ResetInstrumentation()
+{
+	using namespace Instrumentation;
+	Registry &registry = Registry::Instance();
+	pthread_mutex_lock(&registry.Mutex);
+	for (size_t t=0; t<registry.Threads.size(); t++)
+	{
+		ThreadCounters &counters = *registry.Threads[t];
+		for (size_t site=0; site<counters.size(); site++)
+		{
+			counters[site] = Counter();
+		}
+	}
+	pthread_mutex_unlock(&registry.Mutex);
+}
+
+inline bool IsInstrumentationEnabled()
+{
+	return true;
+}
+
+/*
+ * True if hardware counters are compiled in and can be read by this thread
+ */
+inline bool IsPerfCountersAvailable()
+{
+#ifdef USE_PERF_COUNTERS
+	return Instrumentation::GetThreadPerfCounters().IsAvailable();
+#else
+	return false;
+#endif
+}
+
+#else
+
+#define INSTRUMENT_SCOPE(name)
+#define INSTRUMENT_BYTES(name, bytes)
+
+inline std::string GetInstrumentationReport()
+{
+	return std::string();
+}
+
+inline void ResetInstrumentation()
+{
+}
+
+inline bool IsInstrumentationEnabled()
+{
+	return false;
+}
+
+inline bool IsPerfCountersAvailable()
+{
+	return false;
+}
+
+#endif
+
+#endif
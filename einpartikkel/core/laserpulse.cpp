@@ -0,0 +1,267 @@
+#include <core/common.h>
+#include "spline.h"
+#include "instrumentation.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/*
+ * Native laser pulses, the time dependence of the laser potentials.
+ *
+ * A pulse is a sum of components (e.g. a multi-colour field). An analytic
+ * component has the vector potential
+ *
+ *     A(t) = (E0 / w) f(tau) sin(w tau + chirp (tau - T/2)^2 + phase)
+ *
+ * with tau = t - delay, duration T and envelope f(tau), zero outside
+ * [0, T]:
+ *
+ *     sin2       sin^2(pi tau / T)
+ *     gaussian   exp(-2 ln2 (tau - T/2)^2 / fwhm^2), fwhm of the intensity,
+ *                truncated to [0, T]
+ *     trapezoid  linear ramps of length ramp_duration at both ends
+ *
+ * The field is E(t) = -dA/dt, evaluated analytically. A sampled component
+ * is read from a text file with lines "t value" (lines starting with '#'
+ * are ignored), holding either the field or the vector potential, and is
+ * interpolated with a monotone cubic spline; the other quantity is given
+ * by the exact derivative or integral of the spline. Outside the sampled
+ * window [t_0, t_n-1] (shifted by delay) the field is zero and the vector
+ * potential keeps its value at the nearest end of the window, so a last
+ * sample that is not exactly zero does not leave a static field on.
+ *
+ * Evaluate() returns the field (length gauge) or the vector potential
+ * (velocity gauge), with the same conventions as the python laser
+ * functions in examples/simple_propagation/example.py.
+ */
+class LaserPulse
+{
+public:
+	LaserPulse() : UseField(true) {}
+
+	/*
+	 * Add an analytic component. shapeParameter is the fwhm for gaussian
+	 * envelopes and the ramp duration for trapezoids, and ignored for sin2
+	 */
+	void AddComponent(const std::string &envelope, double amplitude, double frequency, double phase, double duration, double delay, double chirp, double shapeParameter)
+	{
+		Component component;
+		if (envelope == "sin2") component.Envelope = EnvelopeSin2;
+		else if (envelope == "gaussian") component.Envelope = EnvelopeGaussian;
+		else if (envelope == "trapezoid") component.Envelope = EnvelopeTrapezoid;
+		else throw std::runtime_error("Unknown pulse envelope " + envelope);
+
+		if (frequency <= 0) throw std::runtime_error("Pulse frequency must be positive");
+		if (duration <= 0) throw std::runtime_error("Pulse duration must be positive");
+		if (component.Envelope != EnvelopeSin2 && shapeParameter <= 0)
+		{
+			throw std::runtime_error("Pulse envelope " + envelope + " needs a positive shape parameter");
+		}
+		if (component.Envelope == EnvelopeTrapezoid && 2 * shapeParameter > duration)
+		{
+			throw std::runtime_error("Trapezoid ramps are longer than the pulse");
+		}
+
+		component.Amplitude = amplitude;
+		component.Frequency = frequency;
+		component.Phase = phase;
+		component.Duration = duration;
+		component.Delay = delay;
+		component.Chirp = chirp;
+		component.ShapeParameter = shapeParameter;
+		Components.push_back(component);
+	}
+
+	/*
+	 * Add a sampled component from filename. isField selects whether the
+	 * file holds E(t) or A(t). The values are multiplied by amplitude and
+	 * shifted by delay
+	 */
+	void AddSampledComponent(const std::string &filename, bool isField, double amplitude, double delay)
+	{
+		std::ifstream file(filename.c_str());
+		if (!file) throw std::runtime_error("Could not open sampled pulse " + filename);
+
+		std::vector<double> times;
+		std::vector<double> values;
+		std::string line;
+		while (std::getline(file, line))
+		{
+			size_t start = line.find_first_not_of(" \t\r");
+			if (start == std::string::npos || line[start] == '#') continue;
+			std::istringstream fields(line);
+			double t, value;
+			if (!(fields >> t >> value)) throw std::runtime_error("Invalid line in sampled pulse " + filename + ": " + line);
+			times.push_back(t);
+			values.push_back(value);
+		}
+
+		SampledComponent component;
+		component.Spline.Setup(times, values);
+		component.IsField = isField;
+		component.Amplitude = amplitude;
+		component.Delay = delay;
+		SampledComponents.push_back(component);
+	}
+
+	/*
+	 * "length" makes Evaluate() return the field, "velocity" the vector
+	 * potential
+	 */
+	void SetGauge(const std::string &gauge)
+	{
+		if (gauge == "length") UseField = true;
+		else if (gauge == "velocity") UseField = false;
+		else throw std::runtime_error("Unknown gauge " + gauge);
+	}
+
+	int GetComponentCount() const
+	{
+		return Components.size() + SampledComponents.size();
+	}
+
+	double GetVectorPotential(double t) const
+	{
+		double value = 0;
+		for (size_t i=0; i<Components.size(); i++)
+		{
+			double potential, field;
+			EvaluateComponent(Components[i], t, potential, field);
+			value += potential;
+		}
+		for (size_t i=0; i<SampledComponents.size(); i++)
+		{
+			const SampledComponent &component = SampledComponents[i];
+			double tau = std::min(std::max(t - component.Delay, component.Spline.GetMinX()), component.Spline.GetMaxX());
+			if (component.IsField) value -= component.Amplitude * component.Spline.Integrate(tau);
+			else value += component.Amplitude * component.Spline.Evaluate(tau);
+		}
+		return value;
+	}
+
+	double GetField(double t) const
+	{
+		double value = 0;
+		for (size_t i=0; i<Components.size(); i++)
+		{
+			double potential, field;
+			EvaluateComponent(Components[i], t, potential, field);
+			value += field;
+		}
+		for (size_t i=0; i<SampledComponents.size(); i++)
+		{
+			const SampledComponent &component = SampledComponents[i];
+			double tau = t - component.Delay;
+			if (tau < component.Spline.GetMinX() || tau > component.Spline.GetMaxX()) continue;
+			if (component.IsField) value += component.Amplitude * component.Spline.Evaluate(tau);
+			else value -= component.Amplitude * component.Spline.EvaluateDerivative(tau);
+		}
+		return value;
+	}
+
+	double Evaluate(double t) const
+	{
+		return UseField ? GetField(t) : GetVectorPotential(t);
+	}
+
+	/*
+	 * Evaluate at all times in t (e.g. the quadrature nodes of a time step)
+	 */
+	void EvaluateArray(blitz::Array<double, 1> t, blitz::Array<double, 1> values) const
+	{
+		INSTRUMENT_SCOPE("LaserPulse::EvaluateArray");
+		if (values.size() != t.size()) throw std::runtime_error("Invalid size of output array");
+		for (int i=0; i<t.extent(0); i++)
+		{
+			values(i) = Evaluate(t(i));
+		}
+	}
+
+private:
+	enum EnvelopeType { EnvelopeSin2, EnvelopeGaussian, EnvelopeTrapezoid };
+
+	struct Component
+	{
+		EnvelopeType Envelope;
+		double Amplitude;
+		double Frequency;
+		double Phase;
+		double Duration;
+		double Delay;
+		double Chirp;
+		double ShapeParameter;
+	};
+
+	struct SampledComponent
+	{
+		MonotoneCubicSpline Spline;
+		bool IsField;
+		double Amplitude;
+		double Delay;
+	};
+
+	bool UseField;
+	std::vector<Component> Components;
+	std::vector<SampledComponent> SampledComponents;
+
+	/*
+	 * Envelope f and its derivative at tau, inside [0, T]
+	 */
+	static void EvaluateEnvelope(const Component &component, double tau, double &envelope, double &derivative)
+	{
+		double T = component.Duration;
+		switch (component.Envelope)
+		{
+		case EnvelopeSin2:
+		{
+			double s = std::sin(M_PI * tau / T);
+			envelope = s * s;
+			derivative = (M_PI / T) * std::sin(2 * M_PI * tau / T);
+			break;
+		}
+		case EnvelopeGaussian:
+		{
+			double a = 2 * std::log(2.0) / (component.ShapeParameter * component.ShapeParameter);
+			double x = tau - T / 2;
+			envelope = std::exp(-a * x * x);
+			derivative = -2 * a * x * envelope;
+			break;
+		}
+		case EnvelopeTrapezoid:
+		{
+			double ramp = component.ShapeParameter;
+			if (tau < ramp) { envelope = tau / ramp; derivative = 1 / ramp; }
+			else if (tau > T - ramp) { envelope = (T - tau) / ramp; derivative = -1 / ramp; }
+			else { envelope = 1; derivative = 0; }
+			break;
+		}
+		}
+	}
+
+	static void EvaluateComponent(const Component &component, double t, double &potential, double &field)
+	{
+		double tau = t - component.Delay;
+		if (tau < 0 || tau >= component.Duration)
+		{
+			potential = 0;
+			field = 0;
+			return;
+		}
+
+		double envelope, envelopeDerivative;
+		EvaluateEnvelope(component, tau, envelope, envelopeDerivative);
+
+		double w = component.Frequency;
+		double x = tau - component.Duration / 2;
+		double carrierPhase = w * tau + component.Chirp * x * x + component.Phase;
+		double carrierFrequency = w + 2 * component.Chirp * x;
+		double scale = component.Amplitude / w;
+
+		potential = scale * envelope * std::sin(carrierPhase);
+		field = -scale * (envelopeDerivative * std::sin(carrierPhase) + envelope * carrierFrequency * std::cos(carrierPhase));
+	}
+};
+
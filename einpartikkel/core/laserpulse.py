@@ -0,0 +1,179 @@
+"""
+laserpulse
+==========
+
+Native time functions for the laser potentials.
+
+NativeLaserFunction can be used as time_function in any laser potential
+section, replacing the python laser functions. The pulse is built from
+these keys of the section (see laserpulse.cpp):
+
+	pulse_shape    "sin2" (default), "gaussian", "trapezoid" or "sampled"
+	gauge          "length" (field) or "velocity" (vector potential),
+	               default from the potential classname
+	amplitude      field amplitude E0
+	frequency      carrier frequency
+	phase          carrier phase (default 0)
+	pulse_duration duration T
+	delay          start time (default 0)
+	chirp          linear chirp rate (default 0)
+	fwhm           intensity fwhm of gaussian envelopes
+	ramp_duration  ramp length of trapezoids
+	filename       "t value" file of sampled pulses, zero field outside
+	               the sampled times
+	sampled_quantity "field" (default) or "vector_potential"
+
+Multi-colour pulses are given by lists in amplitude, frequency, phase,
+etc, with scalar values shared by all components. Example:
+
+	[LaserPotentialLengthZ]
+	...
+	time_function = NativeLaserFunction
+	pulse_shape = "sin2"
+	frequency = [0.057, 0.114]
+	amplitude = [0.0534, 0.0169]
+	phase = [0.0, 0.5*pi]
+
+Propagate calls ApplyNativeLaserFunctions() before the problem is set up,
+which replaces NativeLaserFunction in every section by the LaserPulse of
+the section. The pulse is itself callable as time_function(conf, t), so
+the time function pyprop calls at every time step runs in C++ without a
+python frame. Sections are rebuilt from their current values each time it
+is applied.
+
+"""
+from numpy import asarray, double, zeros
+from pyprop.pyproplogging import GetFunctionLogger
+from ..utils import RegisterAll, RegisterProjectNamespace
+from above import LaserPulse
+
+#Config keys defining a pulse
+PulseKeys = ["pulse_shape", "gauge", "classname", "amplitude", "frequency", "phase", \
+	"pulse_duration", "delay", "chirp", "fwhm", "ramp_duration", "filename", \
+	"sampled_quantity"]
+
+#Pulses created by NativeLaserFunction, by the pulse values of the section
+LaserPulseCache = {}
+
+
+def GetComponentValues(conf, key, count, default=None):
+	value = getattr(conf, key, default)
+	if value == None:
+		raise Exception("Laser pulse needs '%s'" % key)
+	if isinstance(value, (list, tuple)):
+		if len(value) != count:
+			raise Exception("Laser pulse '%s' has %i values, expected %i" % (key, len(value), count))
+		return list(value)
+	return [value] * count
+
+
+def GetComponentCount(conf):
+	count = 1
+	for key in ["pulse_shape", "amplitude", "frequency", "phase", "pulse_duration", \
+			"delay", "chirp", "fwhm", "ramp_duration", "filename"]:
+		value = getattr(conf, key, None)
+		if isinstance(value, (list, tuple)):
+			if count != 1 and len(value) != count:
+				raise Exception("Inconsistent number of laser pulse components in '%s'" % key)
+			count = len(value)
+	return count
+
+
+@RegisterAll
+def CreateLaserPulse(conf):
+	"""
+	Create a native LaserPulse from a config section
+	"""
+	pulse = LaserPulse()
+	count = GetComponentCount(conf)
+	shapes = GetComponentValues(conf, "pulse_shape", count, "sin2")
+	delays = GetComponentValues(conf, "delay", count, 0.0)
+	amplitudes = GetComponentValues(conf, "amplitude", count)
+
+	for i, shape in enumerate(shapes):
+		if shape == "sampled":
+			filename = GetComponentValues(conf, "filename", count)[i]
+			quantity = GetComponentValues(conf, "sampled_quantity", count, "field")[i]
+			pulse.AddSampledComponent(filename, quantity == "field", amplitudes[i], delays[i])
+			continue
+
+		shapeParameter = 0.0
+		if shape == "gaussian":
+			shapeParameter = GetComponentValues(conf, "fwhm", count)[i]
+		elif shape == "trapezoid":
+			shapeParameter = GetComponentValues(conf, "ramp_duration", count)[i]
+		pulse.AddComponent(shape, amplitudes[i], \
+			GetComponentValues(conf, "frequency", count)[i], \
+			GetComponentValues(conf, "phase", count, 0.0)[i], \
+			GetComponentValues(conf, "pulse_duration", count)[i], \
+			delays[i], \
+			GetComponentValues(conf, "chirp", count, 0.0)[i], \
+			shapeParameter)
+
+	gauge = getattr(conf, "gauge", None)
+	if gauge == None:
+		gauge = "length" if "Length" in getattr(conf, "classname", "") else "velocity"
+	pulse.SetGauge(gauge)
+	return pulse
+
+
+def GetPulseKey(conf):
+	return tuple([repr(getattr(conf, key, None)) for key in PulseKeys])
+
+
+@RegisterAll
+def GetLaserPulse(conf):
+	"""
+	The native LaserPulse of a config section. Pulses are shared by
+	sections with the same pulse values, and a section whose values have
+	changed gets a new pulse.
+	"""
+	key = GetPulseKey(conf)
+	if not key in LaserPulseCache:
+		LaserPulseCache[key] = CreateLaserPulse(conf)
+	return LaserPulseCache[key]
+
+
+@RegisterAll
+@RegisterProjectNamespace
+def NativeLaserFunction(conf, t):
+	"""
+	Time function evaluating the native pulse of conf at time t. Replaced
+	by the pulse itself in sections set up by ApplyNativeLaserFunctions()
+	"""
+	return GetLaserPulse(conf).Evaluate(t)
+
+
+@RegisterAll
+def ApplyNativeLaserFunctions(conf):
+	"""
+	Replace the time_function NativeLaserFunction of every section of conf
+	by the LaserPulse built from the section, which pyprop then calls
+	directly. The config file representation (conf.cfgObj) is not changed,
+	so saved configs still refer to NativeLaserFunction.
+
+	Returns the names of the sections changed.
+	"""
+	logger = GetFunctionLogger()
+	sections = []
+	for name in conf.cfgObj.sections():
+		section = conf.GetSection(name)
+		timeFunction = getattr(section, "time_function", None)
+		if timeFunction is NativeLaserFunction or isinstance(timeFunction, LaserPulse):
+			section.time_function = CreateLaserPulse(section)
+			sections.append(name)
+	if len(sections) > 0:
+		logger.info("Native laser pulses in %s" % ", ".join(sections))
+	return sections
+
+
+@RegisterAll
+def EvaluateLaserFunction(conf, times):
+	"""
+	Evaluate the native pulse of conf at all times (e.g. the quadrature
+	nodes of a time step) in one call
+	"""
+	times = asarray(times, dtype=double)
+	values = zeros(times.shape, dtype=double)
+	GetLaserPulse(conf).EvaluateArray(times, values)
+	return values
@@ -0,0 +1,181 @@
+"""
+layout
+======
+
+Memory layout of the wavefunction and the tensor potentials.
+
+The wavefunction is stored either as [angular, radial] ("angular_major",
+the default) or as [radial, angular] ("radial_major"), given by the order
+of representation0/representation1 in [Representation], with matching
+angular_rank/radial_rank and rank indexed geometry/differentiation keys
+in the potential sections.
+
+	angular_major  the radial vector of each (l, m) is contiguous, which
+	               suits the banded radial operations (overlap,
+	               preconditioner, initial states)
+	radial_major   all angular coefficients at one radial index are
+	               contiguous, which suits potentials coupling many
+	               angular pairs, e.g. velocity gauge runs at high lmax
+
+The layout is selected in the config file,
+
+	[Representation]
+	layout = "radial_major"
+
+and applied by ApplyWavefunctionLayout before the problem is created
+(Propagate does this). The spherical evaluators write their data in
+memory order for either layout (SeparablePotentialData in
+sphericalbase.h). Python code working on [angular, radial] arrays uses
+GetAngularMajorData, which is a transposed view of radial-major data, not
+a copy.
+
+"""
+import pyprop
+from ..utils import RegisterAll
+
+WavefunctionLayouts = ["angular_major", "radial_major"]
+
+
+@RegisterAll
+def GetLayoutRanks(layout):
+	"""
+	angularRank, radialRank = GetLayoutRanks(layout)
+	"""
+	if layout == "angular_major":
+		return 0, 1
+	elif layout == "radial_major":
+		return 1, 0
+	raise Exception("Unknown wavefunction layout '%s', should be one of %s" % \
+		(layout, WavefunctionLayouts))
+
+
+def IsAngularSection(conf, sectionName):
+	section = conf.GetSection(sectionName)
+	return "SphericalHarmonic" in str(getattr(section, "type", ""))
+
+
+#Keys of the potential sections indexed by rank, swapped with the ranks
+RankIndexedKeys = ["geometry", "differentiation"]
+
+
+def SwapRankIndexedKeys(conf, section):
+	sectionObj = conf.GetSection(section)
+	for key in RankIndexedKeys:
+		names = ["%s0" % key, "%s1" % key]
+		values = [getattr(sectionObj, name, None) for name in names]
+		for name, value in zip(names, reversed(values)):
+			if value != None:
+				conf.SetValue(section, name, value)
+			elif conf.cfgObj.has_option(section, name):
+				conf.cfgObj.remove_option(section, name)
+				delattr(sectionObj, name)
+
+
+@RegisterAll
+def ApplyWavefunctionLayout(conf, layout=None):
+	"""
+	Set the representation order of conf for layout (default
+	[Representation] layout; the config is left unchanged if neither is
+	given). When the order changes, the rank indexed keys
+	(geometry0/geometry1, differentiation0/differentiation1) of every
+	section are swapped as well, and angular_rank/radial_rank are set for
+	the new order.
+	"""
+	if layout == None:
+		layout = getattr(conf.Representation, "layout", None)
+	if layout == None:
+		return
+	angularRank, radialRank = GetLayoutRanks(layout)
+
+	representations = [conf.Representation.representation0, conf.Representation.representation1]
+	angularSections = [name for name in representations if IsAngularSection(conf, name)]
+	if len(angularSections) != 1:
+		raise Exception("Could not find the angular representation among %s" % representations)
+	angularSection = angularSections[0]
+	radialSection = [name for name in representations if name != angularSection][0]
+	if representations.index(angularSection) == angularRank:
+		return
+
+	conf.SetValue("Representation", "representation%i" % angularRank, angularSection)
+	conf.SetValue("Representation", "representation%i" % radialRank, radialSection)
+	for section in conf.cfgObj.sections():
+		if section == "Representation":
+			continue
+		SwapRankIndexedKeys(conf, section)
+		if conf.cfgObj.has_option(section, "angular_rank"):
+			conf.SetValue(section, "angular_rank", angularRank)
+		if conf.cfgObj.has_option(section, "radial_rank"):
+			conf.SetValue(section, "radial_rank", radialRank)
+
+
+@RegisterAll
+def GetAngularRank(psi):
+	"""
+	Rank of the spherical harmonic representation of psi
+	"""
+	repr = psi.GetRepresentation()
+	for rank in range(psi.GetRank()):
+		if hasattr(repr.GetRepresentation(rank), "Range"):
+			return rank
+	raise Exception("Wavefunction has no angular representation")
+
+
+@RegisterAll
+def GetRadialRank(psi):
+	return 1 - GetAngularRank(psi)
+
+
+@RegisterAll
+def GetAngularRepresentation(psi):
+	return psi.GetRepresentation().GetRepresentation(GetAngularRank(psi))
+
+
+@RegisterAll
+def GetRadialRepresentation(psi):
+	return psi.GetRepresentation().GetRepresentation(GetRadialRank(psi))
+
+
+@RegisterAll
+def GetAngularMajorView(data, angularRank):
+	"""
+	data as [angular, radial], a view sharing memory with data
+	"""
+	if angularRank == 0:
+		return data
+	return data.transpose()
+
+
+@RegisterAll
+def GetAngularMajorData(psi):
+	"""
+	The data of psi as [angular, radial], a view for radial-major psi
+	"""
+	return GetAngularMajorView(psi.GetData(), GetAngularRank(psi))
+
+
+@RegisterAll
+def GetAngularMajorPotentialData(potential, angularRank):
+	"""
+	PotentialData of a tensor potential as [angularPair, radialPair]
+	"""
+	return GetAngularMajorView(potential.PotentialData, angularRank)
+
+
+@RegisterAll
+def GetAngularBasisPairs(potential, angularRank):
+	return potential.BasisPairs[angularRank]
+
+
+@RegisterAll
+def GetRadialBasisPairs(potential, angularRank):
+	return potential.BasisPairs[1 - angularRank]
+
+
+@RegisterAll
+def RequireAngularMajor(psi, name):
+	"""
+	Raise for radial-major psi, for code (e.g. the native tasks) that only
+	supports the angular-major layout
+	"""
+	if GetAngularRank(psi) != 0:
+		raise Exception("%s supports only the angular_major layout" % name)
@@ -0,0 +1,299 @@
+#ifndef MEMORYPLACEMENT_H
+#define MEMORYPLACEMENT_H
+
+/*
+ * NUMA placement and huge page backing of existing (already allocated and
+ * touched) arrays, such as the wavefunction and tensor potential data.
+ *
+ *   PlaceArrayMemory(data, policy, hugePages)
+ *
+ *     policy PlacementFirstTouch moves the pages of each block of rows
+ *     (the first, slowest index) to the NUMA node of the OpenMP thread
+ *     owning that block under schedule(static), i.e. the placement first
+ *     touch by the worker threads would have given. This requires the
+ *     module to be built with OpenMP (USE_OPENMP=1 in Makefile.dynamic),
+ *     and throws otherwise. It only helps if the threads of the pyprop
+ *     matrix-vector products split the first index the same way (static
+ *     schedule, same thread count and pinning), otherwise the threads read
+ *     remote pages as before. PlacementInterleave interleaves the pages over
+ *     all nodes the process may use. PlacementKeep leaves the pages where
+ *     they are.
+ *
+ *     hugePages advises transparent huge pages for the array
+ *     (MADV_HUGEPAGE), and collapses the already present pages into huge
+ *     pages where the kernel supports it (MADV_COLLAPSE, Linux 6.1).
+ *
+ *     Returns the number of system calls that failed (0 on success). The
+ *     placement is best effort, e.g. mbind is often not permitted in
+ *     containers.
+ *
+ *   IsFirstTouchPlacementAvailable()
+ *
+ *     true if PlacementFirstTouch is supported (Linux, built with OpenMP).
+ *
+ *   GetArrayNodeCounts(data)
+ *
+ *     Number of pages of data on each node, with one extra last element
+ *     counting pages not resident in memory.
+ *
+ * The system calls are made directly, so libnuma is not needed. On other
+ * platforms than Linux the functions do nothing.
+ */
+
+#include <core/common.h>
+#include <stdexcept>
+#include <algorithm>
+
+#ifdef __linux__
+#include <cstdio>
+#include <cerrno>
+#include <vector>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#endif
+
+enum MemoryPlacementPolicy
+{
+	PlacementKeep = 0,
+	PlacementFirstTouch = 1,
+	PlacementInterleave = 2
+};
+
+#ifdef __linux__
+
+namespace MemoryPlacement
+{
+
+//Mempolicy constants from linux/mempolicy.h (not installed everywhere)
+const int PolicyPreferred = 1;
+const int PolicyInterleave = 3;
+const int FlagMove = 2;
+const int FlagMemsAllowed = 4;
+const int AdviseHugePage = 14;
+const int AdviseCollapse = 25;
+const int HugePageSize = 2 * 1024 * 1024;
+
+//Node masks of up to 1024 nodes
+const int MaskWords = 16;
+const int MaskBits = MaskWords * 8 * sizeof(unsigned long);
+
+inline long GetPageSize()
+{
+	return sysconf(_SC_PAGESIZE);
+}
+
+inline int GetNodeCount()
+{
+	int count = 0;
+	char path[64];
+	while (count < MaskBits)
+	{
+		std::sprintf(path, "/sys/devices/system/node/node%i", count);
+		if (access(path, F_OK) != 0) break;
+		count++;
+	}
+	return count > 0 ? count : 1;
+}
+
+inline bool GetAllowedNodes(unsigned long *mask)
+{
+	int mode = 0;
+	return syscall(SYS_get_mempolicy, &mode, mask, MaskBits + 1, 0, FlagMemsAllowed) == 0;
+}
+
+inline int GetCurrentNode()
+{
+	unsigned cpu = 0, node = 0;
+	if (syscall(SYS_getcpu, &cpu, &node, 0) != 0) return -1;
+	return node;
+}
+
+/*
+ * Apply mode/mask to the pages starting in [start, end), moving pages
+ * already present
+ */
+inline bool BindRange(unsigned long start, unsigned long end, int mode, unsigned long *mask)
+{
+	long pageSize = GetPageSize();
+	start = start & ~(pageSize - 1);
+	end = (end + pageSize - 1) & ~(pageSize - 1);
+	if (end <= start) return true;
+	return syscall(SYS_mbind, start, end - start, mode, mask, MaskBits + 1, FlagMove) == 0;
+}
+
+/*
+ * Rows [begin, end) owned by thread of threadCount under schedule(static)
+ */
+inline void GetStaticBlock(int rowCount, int thread, int threadCount, int &begin, int &end)
+{
+	int blockSize = (rowCount + threadCount - 1) / threadCount;
+	begin = std::min(rowCount, thread * blockSize);
+	end = std::min(rowCount, begin + blockSize);
+}
+
+} //Namespace MemoryPlacement
+
+template<class T, int Rank>
+int PlaceArrayMemory(blitz::Array<T, Rank> data, int policy, bool hugePages)
+{
+	using namespace MemoryPlacement;
+	if (!data.isStorageContiguous())
+		throw std::runtime_error("Memory placement requires contiguous data");
+	if (data.size() == 0) return 0;
+
+	unsigned long start = (unsigned long)data.data();
+	unsigned long end = start + data.size() * sizeof(T);
+	long pageSize = GetPageSize();
+	int failed = 0;
+
+	if (policy == PlacementInterleave)
+	{
+		unsigned long mask[MaskWords] = {0};
+		if (!GetAllowedNodes(mask) || !BindRange(start, end, PolicyInterleave, mask)) failed++;
+	}
+	else if (policy == PlacementFirstTouch)
+	{
+#ifndef _OPENMP
+		throw std::runtime_error("first_touch memory placement requires the OpenMP build (USE_OPENMP=1)");
+#endif
+		//Each thread binds the pages beginning in its block of rows, the
+		//first page of the array goes to the first thread
+		int rowCount = data.extent(0);
+		unsigned long rowBytes = (data.size() / rowCount) * sizeof(T);
+
+		#pragma omp parallel reduction(+:failed)
+		{
+			int thread = 0;
+			int threadCount = 1;
+#ifdef _OPENMP
+			thread = omp_get_thread_num();
+			threadCount = omp_get_num_threads();
+#endif
+			int begin, end;
+			GetStaticBlock(rowCount, thread, threadCount, begin, end);
+			int node = GetCurrentNode();
+			if (begin < end && node >= 0)
+			{
+				unsigned long blockStart = start + begin * rowBytes;
+				unsigned long blockEnd = start + end * rowBytes;
+				blockStart = (begin == 0) ? start : (blockStart + pageSize - 1) & ~(pageSize - 1);
+				blockEnd = (end == rowCount) ? blockEnd : (blockEnd + pageSize - 1) & ~(pageSize - 1);
+
+				unsigned long mask[MaskWords] = {0};
+				mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+				if (blockStart < blockEnd && !BindRange(blockStart, blockEnd, PolicyPreferred, mask)) failed++;
+			}
+		}
+	}
+	else if (policy != PlacementKeep)
+	{
+		throw std::runtime_error("Unknown memory placement policy");
+	}
+
+	if (hugePages)
+	{
+		//Only whole huge pages inside the array
+		unsigned long hugeStart = (start + HugePageSize - 1) & ~((unsigned long)HugePageSize - 1);
+		unsigned long hugeEnd = end & ~((unsigned long)HugePageSize - 1);
+		if (hugeStart < hugeEnd)
+		{
+			if (madvise((void*)hugeStart, hugeEnd - hugeStart, AdviseHugePage) != 0) failed++;
+			//Not supported by older kernels, the advice above still applies to new pages
+			else madvise((void*)hugeStart, hugeEnd - hugeStart, AdviseCollapse);
+		}
+	}
+
+	return failed;
+}
+
+template<class T, int Rank>
+blitz::Array<int, 1> GetArrayNodeCounts(blitz::Array<T, Rank> data)
+{
+	using namespace MemoryPlacement;
+	int nodeCount = GetNodeCount();
+	blitz::Array<int, 1> counts(nodeCount + 1);
+	counts = 0;
+	if (data.size() == 0) return counts;
+
+	long pageSize = GetPageSize();
+	unsigned long start = (unsigned long)data.data() & ~(pageSize - 1);
+	unsigned long end = (unsigned long)data.data() + data.size() * sizeof(T);
+	std::vector<void*> pages;
+	for (unsigned long page=start; page<end; page+=pageSize)
+	{
+		pages.push_back((void*)page);
+	}
+
+	//move_pages without target nodes returns the current node of each page
+	std::vector<int> status(pages.size(), -ENOENT);
+	if (syscall(SYS_move_pages, 0, pages.size(), &pages[0], 0, &status[0], 0) != 0)
+	{
+		counts(nodeCount) = pages.size();
+		return counts;
+	}
+	for (size_t i=0; i<status.size(); i++)
+	{
+		if (status[i] >= 0 && status[i] < nodeCount) counts(status[i])++;
+		else counts(nodeCount)++;
+	}
+	return counts;
+}
+
+inline int GetNumaNodeCount()
+{
+	return MemoryPlacement::GetNodeCount();
+}
+
+inline bool IsMemoryPlacementAvailable()
+{
+	return true;
+}
+
+inline bool IsFirstTouchPlacementAvailable()
+{
+#ifdef _OPENMP
+	return true;
+#else
+	return false;
+#endif
+}
+
+#else
+
+template<class T, int Rank>
+int PlaceArrayMemory(blitz::Array<T, Rank> data, int policy, bool hugePages)
+{
+	return 0;
+}
+
+template<class T, int Rank>
+blitz::Array<int, 1> GetArrayNodeCounts(blitz::Array<T, Rank> data)
+{
+	blitz::Array<int, 1> counts(2);
+	counts = 0;
+	counts(0) = (data.size() * sizeof(T) + 4095) / 4096;
+	return counts;
+}
+
+inline int GetNumaNodeCount()
+{
+	return 1;
+}
+
+inline bool IsMemoryPlacementAvailable()
+{
+	return false;
+}
+
+inline bool IsFirstTouchPlacementAvailable()
+{
+	return false;
+}
+
+#endif
+
+#endif
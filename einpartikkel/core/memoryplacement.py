@@ -0,0 +1,188 @@
+"""
+memoryplacement
+===============
+
+NUMA placement and huge page backing of the wavefunction and tensor
+potential data (see memoryplacement.h).
+
+The arrays are allocated and first touched by the setup thread, so on
+multi-socket nodes all their pages end up on one node. After setup the
+pages can be moved:
+
+	first_touch  the pages of each block of rows (the first index) go to
+	             the node of the OpenMP thread owning the block under
+	             schedule(static), as if the workers had touched them.
+	             Needs the core module built with USE_OPENMP=1, and only
+	             helps if the pyprop matrix-vector threads split the first
+	             index the same way (static schedule, same thread count)
+	interleave   the pages are spread over all nodes
+	keep         the pages are not moved
+
+and arrays larger than huge_page_min_size can be backed by transparent
+huge pages. The placement is configured in the config file,
+
+	[MemoryPlacement]
+	policy = "interleave"
+	huge_pages = True
+	huge_page_min_size = 4*1024**2
+
+and applied by Propagate after setup, which also reports the pages per
+node and the huge page usage of the placed arrays.
+
+Krylov vectors and preconditioner factors allocated inside pyprop are not
+reachable from here, and keep the placement of the thread allocating them.
+
+"""
+import pyprop
+from pyprop.pyproplogging import GetClassLogger
+from ..utils import RegisterAll
+from above import PlaceArrayMemory, GetArrayNodeCounts, GetNumaNodeCount, \
+	IsMemoryPlacementAvailable, IsFirstTouchPlacementAvailable
+
+PlacementPolicies = {"keep": 0, "first_touch": 1, "interleave": 2}
+
+
+def GetArrayAddressRange(array):
+	start = array.__array_interface__["data"][0]
+	return start, start + array.nbytes
+
+
+@RegisterAll
+def GetHugePageBytes(array):
+	"""
+	Estimated bytes of array backed by transparent huge pages, from the
+	AnonHugePages of the mappings holding it (/proc/self/smaps), in
+	proportion to the part of each mapping covered by the array
+	"""
+	start, end = GetArrayAddressRange(array)
+	hugeBytes = 0.0
+	try:
+		smaps = open("/proc/self/smaps")
+	except IOError:
+		return 0
+	overlap = 0
+	mappingSize = 1
+	for line in smaps:
+		fields = line.split()
+		if len(fields) > 0 and "-" in fields[0] and not fields[0].endswith(":"):
+			low, high = [int(x, 16) for x in fields[0].split("-")]
+			overlap = max(0, min(high, end) - max(low, start))
+			mappingSize = high - low
+		elif len(fields) > 0 and fields[0] == "AnonHugePages:" and overlap > 0:
+			hugeBytes += int(fields[1]) * 1024. * overlap / mappingSize
+	smaps.close()
+	return int(hugeBytes)
+
+
+@RegisterAll
+class MemoryPlacement(object):
+	"""
+	Places arrays on NUMA nodes and huge pages, and reports the placement.
+
+	Parametres
+	----------
+	policy:          (string) "keep", "first_touch" or "interleave"
+	hugePages:       (bool) back the arrays with transparent huge pages
+	hugePageMinSize: (int) smallest array (bytes) given huge pages
+	"""
+
+	def __init__(self, policy="keep", hugePages=False, hugePageMinSize=4*1024**2):
+		self.Logger = GetClassLogger(self)
+		self.SetPolicy(policy)
+		self.HugePages = hugePages
+		self.HugePageMinSize = hugePageMinSize
+		self.Arrays = []
+
+	def SetPolicy(self, policy):
+		if not policy in PlacementPolicies:
+			raise Exception("Unknown memory placement policy '%s', should be one of %s" % \
+				(policy, PlacementPolicies.keys()))
+		self.Policy = policy
+
+	def ApplyConfigSection(self, conf):
+		self.SetPolicy(getattr(conf, "policy", self.Policy))
+		self.HugePages = getattr(conf, "huge_pages", self.HugePages)
+		self.HugePageMinSize = getattr(conf, "huge_page_min_size", self.HugePageMinSize)
+
+	def Place(self, name, array):
+		"""
+		Place the pages of array (complex, 2D, contiguous), and keep it for
+		the report
+		"""
+		hugePages = self.HugePages and array.nbytes >= self.HugePageMinSize
+		failed = PlaceArrayMemory(array, PlacementPolicies[self.Policy], hugePages)
+		if failed > 0:
+			self.Logger.warning("Placement of %s (%s, huge pages %s) failed in %i system calls" % \
+				(name, self.Policy, hugePages, failed))
+		self.Arrays.append((name, array))
+
+	def PlaceProblem(self, prop):
+		"""
+		Place the wavefunction and the potential data of all tensor
+		potentials of prop
+		"""
+		if not IsMemoryPlacementAvailable():
+			self.Logger.warning("Memory placement is not available on this platform")
+			return
+		if self.Policy == "first_touch" and not IsFirstTouchPlacementAvailable():
+			raise Exception("Memory placement policy 'first_touch' needs the core module built with OpenMP (USE_OPENMP=1), use 'interleave' otherwise")
+		self.Place("Wavefunction", prop.psi.GetData())
+		for pot in prop.Propagator.BasePropagator.PotentialList:
+			self.Place(getattr(pot, "Name", "TensorPotential"), pot.PotentialData)
+
+	def GetStatistics(self):
+		"""
+		Returns (name, nbytes, pagesPerNode, nonResidentPages, hugePageBytes)
+		for every placed array
+		"""
+		statistics = []
+		for name, array in self.Arrays:
+			counts = GetArrayNodeCounts(array)
+			statistics.append((name, array.nbytes, list(counts[:-1]), counts[-1], GetHugePageBytes(array)))
+		return statistics
+
+	def FormatReport(self):
+		MB = 1024.**2
+		nodeCount = GetNumaNodeCount()
+		lines = ["Memory placement: policy %s, huge pages %s, %i NUMA nodes" % \
+			(self.Policy, self.HugePages, nodeCount)]
+		lines.append("  %-30s %10s %10s %-24s %10s" % ("Array", "Size (MB)", "Huge (MB)", "Pages per node", "Absent"))
+		for name, nbytes, nodePages, absentPages, hugeBytes in self.GetStatistics():
+			lines.append("  %-30s %10.1f %10.1f %-24s %10i" % (name, nbytes / MB, hugeBytes / MB, \
+				" ".join(["%i" % n for n in nodePages]), absentPages))
+		return "\n".join(lines)
+
+	def LogReport(self):
+		self.Logger.info(self.FormatReport())
+
+	def SaveReport(self, h5file, groupName="MemoryPlacement"):
+		"""
+		Store the placement statistics in the open HDF5 file h5file
+		(pytables), replacing an existing group of the same name.
+		"""
+		if groupName in h5file.root:
+			h5file.removeNode(h5file.root, groupName, recursive=True)
+		group = h5file.createGroup("/", groupName)
+
+		statistics = self.GetStatistics()
+		if len(statistics) > 0:
+			h5file.createArray(group, "Names", [s[0] for s in statistics])
+			h5file.createArray(group, "Bytes", [s[1] for s in statistics])
+			h5file.createArray(group, "PagesPerNode", [s[2] for s in statistics])
+			h5file.createArray(group, "NonResidentPages", [s[3] for s in statistics])
+			h5file.createArray(group, "HugePageBytes", [s[4] for s in statistics])
+		h5file.setNodeAttr(group, "Policy", self.Policy)
+		h5file.setNodeAttr(group, "HugePages", self.HugePages)
+
+
+@RegisterAll
+def ApplyMemoryPlacement(prop, conf):
+	"""
+	Place the arrays of prop as given by the config section conf
+	([MemoryPlacement]), returning the MemoryPlacement for the report
+	"""
+	placement = MemoryPlacement()
+	placement.ApplyConfigSection(conf)
+	placement.PlaceProblem(prop)
+	placement.LogReport()
+	return placement
@@ -0,0 +1,558 @@
+#include "sphericalbase.h"
+
+#include <gsl/gsl_sf_bessel.h>
+#include <gsl/gsl_sf_legendre.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+ * Plane wave expansion tables shared by all non-dipole potentials:
+ *
+ *   exp(i k.r) = 4 pi sum_LM i^L j_L(k r) Y*_LM(k_hat) Y_LM(r_hat)
+ *
+ * The radial profiles j_L(k r_i) are cached per (k, radial grid), and the
+ * Gaunt coefficients <l'm'|Y_LM|lm> per (l', m', L, M, l, m), so that the
+ * propagator and preconditioner copies of a potential, and the cos and sin
+ * parts, share the work.
+ */
+class PlaneWaveExpansionTable
+{
+public:
+	typedef std::vector< std::vector<double> > ProfileList;
+
+	/*
+	 * j_L(k r) for L = 0..maxL at the points in r, as [L][ri]
+	 */
+	static const ProfileList& GetRadialProfiles(double k, const blitz::Array<double, 1> &r, int maxL)
+	{
+		ProfileKey key(k, std::vector<double>(r.begin(), r.end()));
+		std::map<ProfileKey, ProfileList> &cache = GetProfileCache();
+		std::map<ProfileKey, ProfileList>::iterator cached = cache.find(key);
+		if (cached != cache.end() && (int)cached->second.size() > maxL) return cached->second;
+
+		INSTRUMENT_SCOPE("PlaneWaveExpansionTable::GetRadialProfiles");
+		ProfileList &profiles = cache[key];
+		profiles.assign(maxL + 1, std::vector<double>(r.size()));
+		std::vector<double> values(maxL + 1);
+		for (int ri=0; ri<(int)r.size(); ri++)
+		{
+			gsl_sf_bessel_jl_array(maxL, k * key.second[ri], &values[0]);
+			for (int L=0; L<=maxL; L++)
+			{
+				profiles[L][ri] = values[L];
+			}
+		}
+		return profiles;
+	}
+
+	/*
+	 * Gaunt coefficient <l'm'|Y_LM|lm> = int Y*_l'm' Y_LM Y_lm
+	 */
+	static double GetGauntCoefficient(int lp, int mp, int L, int M, int l, int m)
+	{
+		if (mp != m + M) return 0;
+		if (L < std::abs(l - lp) || L > l + lp || (l + lp + L) % 2 == 1) return 0;
+
+		std::vector<int> key(6);
+		key[0] = lp; key[1] = mp; key[2] = L; key[3] = M; key[4] = l; key[5] = m;
+		std::map<std::vector<int>, double> &cache = GetGauntCache();
+		std::map<std::vector<int>, double>::iterator cached = cache.find(key);
+		if (cached != cache.end()) return cached->second;
+
+		ClebschGordan cg;
+		double coeff = std::sqrt((2.*l + 1.) * (2.*L + 1.) / (4 * M_PI * (2.*lp + 1.)));
+		coeff *= cg(l, L, 0, 0, lp, 0);
+		coeff *= cg(l, L, m, M, lp, mp);
+		cache[key] = coeff;
+		return coeff;
+	}
+
+	/*
+	 * Complex conjugate of the spherical harmonic Y_LM(theta, phi)
+	 */
+	static cplx GetConjugateSphericalHarmonic(int L, int M, double theta, double phi)
+	{
+		double value = gsl_sf_legendre_sphPlm(L, std::abs(M), std::cos(theta));
+		if (M < 0 && (M % 2 != 0)) value = -value;
+		return value * std::exp(cplx(0, -M * phi));
+	}
+
+private:
+	typedef std::pair<double, std::vector<double> > ProfileKey;
+
+	static std::map<ProfileKey, ProfileList>& GetProfileCache()
+	{
+		static std::map<ProfileKey, ProfileList> cache;
+		return cache;
+	}
+
+	static std::map<std::vector<int>, double>& GetGauntCache()
+	{
+		static std::map<std::vector<int>, double> cache;
+		return cache;
+	}
+};
+
+
+/*
+ * Non-dipole spatial factor of a plane wave with wave vector k, in the
+ * direction (theta_k, phi_k):
+ *
+ *   part = "exp"  exp(i k.r)
+ *          "cos"  cos(k.r), the even multipoles
+ *          "sin"  sin(k.r), the odd multipoles
+ *
+ * exp(i k.r) alone is not Hermitian, and must be paired with its adjoint
+ * term; Hamiltonians should use the cos and sin parts.
+ *
+ * The time dependence is given by time_function as for the dipole
+ * potentials. E.g. the velocity gauge A^2 term of a plane wave is
+ * A0^2/2 [1 + cos(2wt) cos(2k.r) + sin(2wt) sin(2k.r)], which is the sum
+ * of two of these potentials (wave_number = 2k) and a constant.
+ *
+ * Multipoles L are truncated where max_r |j_L(k r)| < tolerance, and at
+ * max_multipole if given. Only angular pairs with |l - l'| <= L_max and
+ * m' - m = M are set, so the angular geometry can be any superset of that
+ * block structure. The geometries are defined by the pyprop
+ * representations, which have no selection rule geometry for this
+ * structure, so in practice it is "Dense". The potential data then holds
+ * all (lmax+1)^4 angular pairs times the radial band, e.g. with
+ * "banded-packed" B-splines
+ *
+ *     16 bytes * (lmax+1)^4 * xsize * (2 order - 1)
+ *
+ * per potential: 5 MB at lmax = 5, xsize = 20, order = 7, but 8 GB at
+ * lmax = 20, xsize = 200. Setting max_multipole (or a larger tolerance)
+ * makes the evaluation cheaper, not the storage.
+ */
+template<int Rank>
+class CustomPotential_NonDipole : public CustomPotentialSphericalBase<Rank>
+{
+public:
+	typedef blitz::Array<int, 2> BasisPairList;
+
+	double WaveNumber;
+	double ThetaK;
+	double PhiK;
+	double Tolerance;
+	int MaxMultipole;
+	std::string Part;
+
+	CustomPotential_NonDipole() : WaveNumber(0), ThetaK(0), PhiK(0), Tolerance(1e-10), MaxMultipole(-1), Part("exp") {}
+	virtual ~CustomPotential_NonDipole() {}
+
+	virtual void ApplyConfigSection(const ConfigSection &config)
+	{
+		CustomPotentialSphericalBase<Rank>::ApplyConfigSection(config);
+		config.Get("wave_number", WaveNumber);
+		if (config.HasValue("theta_k")) config.Get("theta_k", ThetaK);
+		if (config.HasValue("phi_k")) config.Get("phi_k", PhiK);
+		if (config.HasValue("tolerance")) config.Get("tolerance", Tolerance);
+		if (config.HasValue("max_multipole")) config.Get("max_multipole", MaxMultipole);
+		if (config.HasValue("part")) config.Get("part", Part);
+		if (Part != "exp" && Part != "cos" && Part != "sin")
+		{
+			throw std::runtime_error("Invalid non-dipole part " + Part + ", should be exp, cos or sin");
+		}
+	}
+
+	virtual void UpdatePotentialData(typename blitz::Array<cplx, Rank> data, typename Wavefunction<Rank>::Ptr psi, cplx timeStep, double curTime)
+	{
+		INSTRUMENT_SCOPE("CustomPotential_NonDipole::UpdatePotentialData");
+		INSTRUMENT_BYTES("CustomPotential_NonDipole::UpdatePotentialData", data.size() * sizeof(cplx));
+
+		typedef CombinedRepresentation<Rank> CmbRepr;
+		typename CmbRepr::Ptr repr = boost::static_pointer_cast< CmbRepr >(psi->GetRepresentation());
+		SphericalHarmonicBasisRepresentation::Ptr angRepr = boost::static_pointer_cast< SphericalHarmonicBasisRepresentation >(repr->GetRepresentation(this->AngularRank));
+
+		int rCount = data.extent(this->RadialRank);
+		int angCount = data.extent(this->AngularRank);
+
+		blitz::Array<double, 1> localr = psi->GetRepresentation()->GetLocalGrid(this->RadialRank);
+		BasisPairList angBasisPairs = GetBasisPairList(this->AngularRank);
+
+		if (localr.size() != rCount) throw std::runtime_error("Invalid r size");
+		if (angCount != angBasisPairs.extent(0)) throw std::runtime_error("Invalid ang size");
+
+		//Largest multipole coupling the basis, and the tolerance truncation
+		int maxl = 0;
+		for (int angIndex=0; angIndex<angCount; angIndex++)
+		{
+			maxl = std::max(maxl, angRepr->Range.GetLmIndex(angBasisPairs(angIndex, 0)).l);
+			maxl = std::max(maxl, angRepr->Range.GetLmIndex(angBasisPairs(angIndex, 1)).l);
+		}
+		int maxL = 2 * maxl;
+		if (MaxMultipole >= 0) maxL = std::min(maxL, MaxMultipole);
+
+		const PlaneWaveExpansionTable::ProfileList &profiles = PlaneWaveExpansionTable::GetRadialProfiles(WaveNumber, localr, maxL);
+		std::vector<bool> includeL(maxL + 1);
+		int truncatedL = -1;
+		for (int L=0; L<=maxL; L++)
+		{
+			double maxValue = 0;
+			for (int ri=0; ri<rCount; ri++) maxValue = std::max(maxValue, std::abs(profiles[L][ri]));
+			bool isPart = (Part == "exp") || (Part == "cos" && L % 2 == 0) || (Part == "sin" && L % 2 == 1);
+			includeL[L] = isPart && maxValue >= Tolerance;
+			if (includeL[L]) truncatedL = L;
+		}
+
+		data = 0;
+		blitz::TinyVector<int, Rank> index;
+		std::vector<cplx> coeffs(maxL + 1);
+
+		for (int angIndex=0; angIndex<angCount; angIndex++)
+		{
+			index(this->AngularRank) = angIndex;
+
+			LmIndex left = angRepr->Range.GetLmIndex(angBasisPairs(angIndex, 0));
+			LmIndex right = angRepr->Range.GetLmIndex(angBasisPairs(angIndex, 1));
+			if (std::abs(left.l - right.l) > truncatedL) continue;
+			int M = left.m - right.m;
+
+			//4 pi i^L Y*_LM(k_hat) <l'm'|Y_LM|lm>, with i^L split into the
+			//cos (real) and sin (imaginary) parts
+			bool isZero = true;
+			for (int L=0; L<=truncatedL; L++)
+			{
+				coeffs[L] = 0;
+				if (!includeL[L] || std::abs(M) > L) continue;
+				double gaunt = PlaneWaveExpansionTable::GetGauntCoefficient(left.l, left.m, L, M, right.l, right.m);
+				if (gaunt == 0) continue;
+
+				cplx phase = (L % 4 == 0) ? 1. : (L % 4 == 1) ? cplx(0, 1) : (L % 4 == 2) ? -1. : cplx(0, -1);
+				if (Part == "sin") phase /= cplx(0, 1);
+				coeffs[L] = 4 * M_PI * phase * gaunt * PlaneWaveExpansionTable::GetConjugateSphericalHarmonic(L, M, ThetaK, PhiK);
+				isZero = false;
+			}
+			if (isZero) continue;
+
+			for (int ri=0; ri<rCount; ri++)
+			{
+				index(this->RadialRank) = ri;
+				cplx value = 0;
+				for (int L=0; L<=truncatedL; L++)
+				{
+					if (coeffs[L] != 0.) value += coeffs[L] * profiles[L][ri];
+				}
+				data(index) = value;
+			}
+		}
+	}
+};
+
+
+/*
+ * Angular matrix elements of the first order non-dipole velocity gauge
+ * coupling (k_hat.r)(eps.grad), for a wave travelling along k_hat with
+ * polarization eps (k_hat perpendicular to eps). With
+ *
+ *   (k_hat.r)(eps.grad) = (k_hat.r_hat)(eps.r_hat) r d/dr
+ *                       + (k_hat.r_hat)(eps.grad_Omega)
+ *
+ * and the reduced radial functions u = r R, the matrix elements are
+ *
+ *   <u' Y_l'm'| ... |u Y_lm> = a int u' r u_r dr + (b - a) int u' u dr
+ *
+ *   a = <l'm'| (k_hat.r_hat)(eps.r_hat) |lm>
+ *   b = <l'm'| (k_hat.r_hat)(eps.theta_hat d/dtheta + eps.phi_hat/sin(theta) d/dphi) |lm>
+ *
+ * The integrands are polynomials on the sphere of degree <= l + l' + 2,
+ * and are integrated exactly by Gauss-Legendre quadrature in cos(theta)
+ * and the trapezoidal rule in phi. The operator is parity even, and
+ * couples only |l - l'| = 0, 2 and |m - m'| <= 2.
+ *
+ * Tables are cached per (maxl, k_hat, eps), so that the two parts of the
+ * coupling and the propagator and preconditioner copies share them.
+ */
+class NonDipoleVelocityTable
+{
+public:
+	/*
+	 * The cached table for maxl and the directions of k_hat and eps
+	 */
+	static const NonDipoleVelocityTable& Get(int maxl, double thetaK, double phiK, double thetaE, double phiE)
+	{
+		std::vector<double> key(5);
+		key[0] = maxl; key[1] = thetaK; key[2] = phiK; key[3] = thetaE; key[4] = phiE;
+		std::map<std::vector<double>, NonDipoleVelocityTable> &cache = GetCache();
+		std::map<std::vector<double>, NonDipoleVelocityTable>::iterator cached = cache.find(key);
+		if (cached != cache.end()) return cached->second;
+
+		INSTRUMENT_SCOPE("NonDipoleVelocityTable::Get");
+		NonDipoleVelocityTable table(maxl, thetaK, phiK, thetaE, phiE);
+		return cache.insert(std::make_pair(key, table)).first->second;
+	}
+
+	NonDipoleVelocityTable(int maxl, double thetaK, double phiK, double thetaE, double phiE)
+		: MaxL(maxl)
+	{
+		SetDirection(thetaK, phiK, K);
+		SetDirection(thetaE, phiE, Eps);
+		if (std::abs(K[0]*Eps[0] + K[1]*Eps[1] + K[2]*Eps[2]) > 1e-10)
+		{
+			throw std::runtime_error("Non-dipole velocity coupling requires polarization perpendicular to the propagation direction");
+		}
+
+		GetGaussLegendreNodes(maxl + 2, Nodes, Weights);
+
+		//Theta parts Theta_lm(x) of Y_lm = Theta_lm(x) exp(i m phi) and
+		//their theta derivatives at the nodes, indexed by l^2 + l + m
+		int lmCount = (maxl + 1) * (maxl + 1);
+		Theta.assign(lmCount, std::vector<double>(Nodes.size()));
+		DTheta.assign(lmCount, std::vector<double>(Nodes.size()));
+		for (int l=0; l<=maxl; l++)
+		{
+			for (int m=-l; m<=l; m++)
+			{
+				for (int i=0; i<(int)Nodes.size(); i++)
+				{
+					Theta[l*l + l + m][i] = GetTheta(l, m, Nodes[i]);
+				}
+			}
+			for (int m=-l; m<=l; m++)
+			{
+				for (int i=0; i<(int)Nodes.size(); i++)
+				{
+					double x = Nodes[i];
+					double sinTheta = std::sqrt(1 - x*x);
+					double upper = (m < l) ? Theta[l*l + l + m + 1][i] : 0;
+					DTheta[l*l + l + m][i] = m * x / sinTheta * Theta[l*l + l + m][i] 
+						+ std::sqrt((l - m) * (l + m + 1.)) * upper;
+				}
+			}
+		}
+	}
+
+	/*
+	 * The coefficients a and b above for bra (lp, mp) and ket (l, m)
+	 */
+	void GetCoupling(int lp, int mp, int l, int m, cplx &a, cplx &b) const
+	{
+		a = 0;
+		b = 0;
+		if (lp > MaxL || l > MaxL) throw std::runtime_error("Non-dipole velocity coupling table too small");
+		if ((l + lp) % 2 == 1 || std::abs(l - lp) > 2 || std::abs(m - mp) > 2) return;
+
+		const std::vector<double> &left = Theta[lp*lp + lp + mp];
+		const std::vector<double> &right = Theta[l*l + l + m];
+		const std::vector<double> &dright = DTheta[l*l + l + m];
+		for (int j=0; j<PhiCount; j++)
+		{
+			double phi = 2 * M_PI * j / PhiCount;
+			cplx phase = std::exp(cplx(0, (m - mp) * phi)) * (2 * M_PI / PhiCount);
+			double cosPhi = std::cos(phi);
+			double sinPhi = std::sin(phi);
+			for (int i=0; i<(int)Nodes.size(); i++)
+			{
+				double x = Nodes[i];
+				double sinTheta = std::sqrt(1 - x*x);
+				double rhat[3] = {sinTheta*cosPhi, sinTheta*sinPhi, x};
+				double thetahat[3] = {x*cosPhi, x*sinPhi, -sinTheta};
+				double phihat[3] = {-sinPhi, cosPhi, 0};
+
+				double kr = Dot(K, rhat);
+				cplx weight = Weights[i] * phase * left[i];
+				a += weight * kr * Dot(Eps, rhat) * right[i];
+				b += weight * kr * (Dot(Eps, thetahat) * dright[i] 
+					+ Dot(Eps, phihat) * cplx(0, m) / sinTheta * right[i]);
+			}
+		}
+	}
+
+private:
+	static const int PhiCount = 8;
+
+	int MaxL;
+	double K[3];
+	double Eps[3];
+	std::vector<double> Nodes;
+	std::vector<double> Weights;
+	std::vector< std::vector<double> > Theta;
+	std::vector< std::vector<double> > DTheta;
+
+	static std::map<std::vector<double>, NonDipoleVelocityTable>& GetCache()
+	{
+		static std::map<std::vector<double>, NonDipoleVelocityTable> cache;
+		return cache;
+	}
+
+	static void SetDirection(double theta, double phi, double *v)
+	{
+		v[0] = std::sin(theta) * std::cos(phi);
+		v[1] = std::sin(theta) * std::sin(phi);
+		v[2] = std::cos(theta);
+	}
+
+	static double Dot(const double *u, const double *v)
+	{
+		return u[0]*v[0] + u[1]*v[1] + u[2]*v[2];
+	}
+
+	/*
+	 * Theta part of Y_lm, with Y_l,-m = (-1)^m Y*_lm
+	 */
+	static double GetTheta(int l, int m, double x)
+	{
+		double value = gsl_sf_legendre_sphPlm(l, std::abs(m), x);
+		if (m < 0 && (m % 2 != 0)) value = -value;
+		return value;
+	}
+
+	/*
+	 * Gauss-Legendre nodes and weights on [-1, 1] by Newton iteration
+	 */
+	static void GetGaussLegendreNodes(int n, std::vector<double> &nodes, std::vector<double> &weights)
+	{
+		nodes.resize(n);
+		weights.resize(n);
+		for (int i=0; i<n; i++)
+		{
+			double x = std::cos(M_PI * (i + 0.75) / (n + 0.5));
+			double dp = 1;
+			for (int iteration=0; iteration<100; iteration++)
+			{
+				double p0 = 1, p1 = x;
+				for (int k=2; k<=n; k++)
+				{
+					double p2 = ((2*k - 1) * x * p1 - (k - 1) * p0) / k;
+					p0 = p1;
+					p1 = p2;
+				}
+				dp = n * (x * p1 - p0) / (x*x - 1);
+				double dx = p1 / dp;
+				x -= dx;
+				if (std::abs(dx) < 1e-15) break;
+			}
+			nodes[i] = x;
+			weights[i] = 2 / ((1 - x*x) * dp * dp);
+		}
+	}
+};
+
+
+/*
+ * First order non-dipole correction to the velocity gauge coupling of a
+ * plane wave along k_hat (theta_k, phi_k) with polarization eps (theta_e,
+ * phi_e). To first order in 1/c
+ *
+ *   A(t - k_hat.r/c) eps = A(t) eps + (k_hat.r) E(t)/c eps
+ *
+ * so the correction to charge A.p is charge E(t)/c (k_hat.r)(eps.p). The
+ * potential gives charge (k_hat.r)(eps.p), and time_function must give
+ * E(t)/c. As for the dipole velocity gauge, the coupling is split in two
+ * potentials, used together:
+ *
+ *   CustomPotential_NonDipoleVelocity             (b - a), no differentiation
+ *   CustomPotential_NonDipoleVelocityDerivativeR  a r, with differentiation1 = 1
+ *
+ * (see NonDipoleVelocityTable). The matching first order correction of the
+ * A^2 term, charge^2 A(t) E(t)/c (k_hat.r), is a local potential of the
+ * form of a length gauge dipole coupling along k_hat.
+ *
+ * The couplings are nonzero for |l - l'| <= 2 and |m - m'| <= 2 only. The
+ * tensor potential geometries are defined by the pyprop representations,
+ * which have no selection rule geometry for this block structure, so the
+ * angular geometry must be "Dense"; the pairs outside it are set to zero.
+ * The storage is that of CustomPotential_NonDipole, (lmax+1)^4 angular
+ * pairs per radial band, although only about 25 (lmax+1)^2 are nonzero.
+ */
+template<int Rank>
+class CustomPotential_NonDipoleVelocityBase : public CustomPotentialSphericalBase<Rank>
+{
+public:
+	typedef blitz::Array<int, 2> BasisPairList;
+
+	double ThetaK;
+	double PhiK;
+	double ThetaE;
+	double PhiE;
+	cplx Charge;
+	SeparablePotentialData Separable;
+
+	CustomPotential_NonDipoleVelocityBase(bool derivativePart) : ThetaK(0.5 * M_PI), PhiK(0), ThetaE(0), PhiE(0), Charge(-1.0), DerivativePart(derivativePart) {}
+	virtual ~CustomPotential_NonDipoleVelocityBase() {}
+
+	virtual void ApplyConfigSection(const ConfigSection &config)
+	{
+		CustomPotentialSphericalBase<Rank>::ApplyConfigSection(config);
+		if (config.HasValue("theta_k")) config.Get("theta_k", ThetaK);
+		if (config.HasValue("phi_k")) config.Get("phi_k", PhiK);
+		if (config.HasValue("theta_e")) config.Get("theta_e", ThetaE);
+		if (config.HasValue("phi_e")) config.Get("phi_e", PhiE);
+		//charge with sign
+		config.Get("charge", Charge);
+	}
+
+	virtual void UpdatePotentialData(typename blitz::Array<cplx, Rank> data, typename Wavefunction<Rank>::Ptr psi, cplx timeStep, double curTime)
+	{
+		INSTRUMENT_SCOPE("CustomPotential_NonDipoleVelocity::UpdatePotentialData");
+		INSTRUMENT_BYTES("CustomPotential_NonDipoleVelocity::UpdatePotentialData", data.size() * sizeof(cplx));
+
+		typedef CombinedRepresentation<Rank> CmbRepr;
+		typename CmbRepr::Ptr repr = boost::static_pointer_cast< CmbRepr >(psi->GetRepresentation());
+		SphericalHarmonicBasisRepresentation::Ptr angRepr = boost::static_pointer_cast< SphericalHarmonicBasisRepresentation >(repr->GetRepresentation(this->AngularRank));
+
+		int rCount = data.extent(this->RadialRank);
+		int angCount = data.extent(this->AngularRank);
+
+		blitz::Array<double, 1> localr = psi->GetRepresentation()->GetLocalGrid(this->RadialRank);
+		BasisPairList angBasisPairs = this->GetBasisPairList(this->AngularRank);
+
+		if (localr.size() != rCount) throw std::runtime_error("Invalid r size");
+		if (angCount != angBasisPairs.extent(0)) throw std::runtime_error("Invalid ang size");
+
+		int maxl = 0;
+		for (int angIndex=0; angIndex<angCount; angIndex++)
+		{
+			maxl = std::max(maxl, angRepr->Range.GetLmIndex(angBasisPairs(angIndex, 0)).l);
+			maxl = std::max(maxl, angRepr->Range.GetLmIndex(angBasisPairs(angIndex, 1)).l);
+		}
+		const NonDipoleVelocityTable &table = NonDipoleVelocityTable::Get(maxl, ThetaK, PhiK, ThetaE, PhiE);
+
+		Separable.Setup(angCount, rCount);
+		for (int ri=0; ri<rCount; ri++)
+		{
+			Separable.Radial(ri) = DerivativePart ? localr(ri) : 1.0;
+		}
+
+		cplx IM(0, 1.0);
+		for (int angIndex=0; angIndex<angCount; angIndex++)
+		{
+			LmIndex left = angRepr->Range.GetLmIndex(angBasisPairs(angIndex, 0));
+			LmIndex right = angRepr->Range.GetLmIndex(angBasisPairs(angIndex, 1));
+
+			cplx a, b;
+			table.GetCoupling(left.l, left.m, right.l, right.m, a, b);
+			cplx coupling = DerivativePart ? a : b - a;
+
+			//eps.p = -i eps.grad, charge scaling from config
+			Separable.Angular(angIndex) = Charge * (-IM * coupling);
+		}
+
+		Separable.Assign(data, this->AngularRank, this->RadialRank);
+	}
+
+private:
+	bool DerivativePart;
+};
+
+template<int Rank>
+class CustomPotential_NonDipoleVelocity : public CustomPotential_NonDipoleVelocityBase<Rank>
+{
+public:
+	CustomPotential_NonDipoleVelocity() : CustomPotential_NonDipoleVelocityBase<Rank>(false) {}
+	virtual ~CustomPotential_NonDipoleVelocity() {}
+};
+
+/*
+ * Should be used with first order differentiation in r
+ */
+template<int Rank>
+class CustomPotential_NonDipoleVelocityDerivativeR : public CustomPotential_NonDipoleVelocityBase<Rank>
+{
+public:
+	CustomPotential_NonDipoleVelocityDerivativeR() : CustomPotential_NonDipoleVelocityBase<Rank>(true) {}
+	virtual ~CustomPotential_NonDipoleVelocityDerivativeR() {}
+};
@@ -0,0 +1,86 @@
+"""
+overlap
+=======
+
+Lazy application of the overlap matrix S.
+
+Analysis methods and inner products in a non-orthogonal (B-spline) basis need
+S psi. GetOverlapPsi() computes S psi into a companion buffer attached to psi,
+taken from the buffer pool, and reuses it until psi is modified.
+
+Modifications are not detected: code modifying psi in-place must call
+InvalidateOverlap(psi) afterwards. Propagate does this after every time
+step, as do the initial state setters (SetRadialEigenstate,
+SetHydrogenicState, the InitialState tasks) and the bound state removal.
+The cache is also dropped if the data of psi is reallocated or reshaped.
+
+"""
+from numpy import vdot
+import pyprop
+from ..utils import RegisterAll
+from bufferpool import GetDefaultBufferPool
+
+_CacheAttrName = "_OverlapCache"
+
+
+def _GetDataKey(psi):
+	data = psi.GetData()
+	return (data.ctypes.data, data.shape)
+
+
+@RegisterAll
+def GetOverlapPsi(psi):
+	"""
+	overlapPsi = GetOverlapPsi(psi)
+
+	Returns a wavefunction containing S psi. The result is cached on psi
+	until InvalidateOverlap(psi) is called, and must be treated as read-only.
+	"""
+	dataKey = _GetDataKey(psi)
+	cache = getattr(psi, _CacheAttrName, None)
+	if cache is not None:
+		cachedKey, overlapPsi = cache
+		if cachedKey == dataKey:
+			return overlapPsi
+		overlapPsi.GetData()[:] = psi.GetData()
+	else:
+		overlapPsi = GetDefaultBufferPool().Checkout(psi, copyData=True)
+
+	overlapPsi.GetRepresentation().MultiplyOverlap(overlapPsi)
+	setattr(psi, _CacheAttrName, (dataKey, overlapPsi))
+	return overlapPsi
+
+
+@RegisterAll
+def InvalidateOverlap(psi):
+	"""
+	Mark the cached S psi as stale, to be called after modifying psi in
+	place. The buffer is kept for reuse.
+	"""
+	cache = getattr(psi, _CacheAttrName, None)
+	if cache is not None:
+		setattr(psi, _CacheAttrName, (None, cache[1]))
+
+
+@RegisterAll
+def ReleaseOverlap(psi):
+	"""
+	Return the cached S psi buffer of psi to the buffer pool
+	"""
+	cache = getattr(psi, _CacheAttrName, None)
+	if cache is not None:
+		GetDefaultBufferPool().Return(cache[1])
+		setattr(psi, _CacheAttrName, None)
+
+
+@RegisterAll
+def OverlapInnerProduct(bra, ket):
+	"""
+	Returns <bra|S|ket>, reusing the cached S ket. 
+	
+	The cache is only used on a single processor, as the data of distributed
+	wavefunctions must be reduced across processors (done by InnerProduct).
+	"""
+	if not pyprop.IsSingleProc():
+		return bra.InnerProduct(ket)
+	return vdot(bra.GetData(), GetOverlapPsi(ket).GetData())
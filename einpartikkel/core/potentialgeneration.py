@@ -0,0 +1,157 @@
+"""
+potentialgeneration
+===================
+
+Concurrent generation of independent tensor potentials (experimental,
+opt-in).
+
+The potential sections of a preconditioner (kinetic, angular kinetic,
+Coulomb, absorber, ...) do not depend on each other, and generating them
+dominates startup. Here they are distributed over forked worker processes
+(analysis/parallel.py), each generating its share of the sections one at a
+time and adding the scaled PotentialData to its own partial sum in shared
+memory. The partial sums are added in worker order, so the result does not
+depend on scheduling.
+
+Every worker holds one partial sum and one generated potential at a time,
+so the number of workers is limited by the memory budget. Both default to
+conservative values, and can be raised with the environment variables
+
+	EINPARTIKKEL_SETUP_PROCS      number of worker processes (default 1)
+	EINPARTIKKEL_SETUP_MEMORY_MB  memory budget of the workers (default half
+	                              of the available memory)
+
+The workers are forked from the setup process, after the OpenMP and BLAS
+threads of pyprop may have started, which not all runtimes survive (see
+analysis/parallel.py). Potentials are therefore generated serially unless
+EINPARTIKKEL_SETUP_PROCS is set, so by default startup is not shortened.
+
+Only the preconditioner potentials (RadialPreconditioner.Setup) are
+covered. The propagator potentials are generated by pyprop's
+Problem.SetupStep, and remain serial.
+
+"""
+import os
+from pyprop.pyproplogging import GetFunctionLogger
+from ..utils import RegisterAll
+import pyprop
+from ..analysis.parallel import ParallelReduce
+from ..memoryledger import GetMemoryLedger
+
+DefaultSetupProcessCount = 1
+
+#Fraction of the available memory used when no budget is given
+DefaultSetupMemoryFraction = 0.5
+
+
+def GetAvailableMemory():
+	"""
+	Available memory in bytes (MemAvailable in /proc/meminfo), or None if
+	not known
+	"""
+	try:
+		for line in open("/proc/meminfo"):
+			fields = line.split()
+			if fields[0] == "MemAvailable:":
+				return int(fields[1]) * 1024
+	except (IOError, IndexError, ValueError):
+		pass
+	return None
+
+
+@RegisterAll
+def GetSetupProcessCount():
+	"""
+	Number of worker processes for potential generation, set with the
+	environment variable EINPARTIKKEL_SETUP_PROCS (default
+	DefaultSetupProcessCount). Always 1 when running under MPI.
+	"""
+	if not pyprop.IsSingleProc():
+		return 1
+	if "EINPARTIKKEL_SETUP_PROCS" in os.environ:
+		return max(1, int(os.environ["EINPARTIKKEL_SETUP_PROCS"]))
+	return DefaultSetupProcessCount
+
+
+@RegisterAll
+def GetSetupMemoryBudget():
+	"""
+	Memory (in bytes) available to concurrent potential generation, set with
+	the environment variable EINPARTIKKEL_SETUP_MEMORY_MB. The default is
+	DefaultSetupMemoryFraction of the available memory, or 0 (a single
+	worker) if that is not known.
+	"""
+	if "EINPARTIKKEL_SETUP_MEMORY_MB" in os.environ:
+		return float(os.environ["EINPARTIKKEL_SETUP_MEMORY_MB"]) * 1024**2
+	available = GetAvailableMemory()
+	if available == None:
+		return 0
+	return DefaultSetupMemoryFraction * available
+
+
+@RegisterAll
+def GetPotentialProcessCount(sectionCount, potentialBytes, procCount=None, memoryBudget=None):
+	"""
+	Number of worker processes for generating sectionCount potentials of
+	potentialBytes each, at most procCount (default GetSetupProcessCount())
+	and within memoryBudget bytes (default GetSetupMemoryBudget()).
+	"""
+	if procCount == None:
+		procCount = GetSetupProcessCount()
+	if memoryBudget == None:
+		memoryBudget = GetSetupMemoryBudget()
+	procCount = max(1, min(procCount, sectionCount))
+	if potentialBytes > 0:
+		#A partial sum and a generated potential per worker
+		procCount = max(1, min(procCount, int(memoryBudget // (2 * potentialBytes))))
+	return procCount
+
+
+@RegisterAll
+def GenerateSummedPotentialData(basePropagator, sections, referencePotential, \
+		scaling=1.0, procCount=None, memoryBudget=None):
+	"""
+	data = GenerateSummedPotentialData(basePropagator, sections,
+		referencePotential, scaling, procCount, memoryBudget)
+
+	Generate the tensor potentials of the config sections concurrently,
+	and return scaling times the sum of their PotentialData.
+
+	Parametres
+	----------
+	basePropagator : pyprop BasisPropagator generating the potentials
+	sections : list of potential config sections
+	referencePotential : TensorPotential all potentials must consolidate
+	                     with (same layout of PotentialData)
+	scaling : factor applied to all potentials
+	procCount : maximum number of worker processes
+	            (default GetSetupProcessCount())
+	memoryBudget : bytes available to the workers
+	               (default GetSetupMemoryBudget())
+
+	Returns
+	-------
+	data : array with the shape and type of referencePotential.PotentialData
+
+	"""
+	logger = GetFunctionLogger()
+	refData = referencePotential.PotentialData
+	procCount = GetPotentialProcessCount(len(sections), refData.nbytes, \
+		procCount, memoryBudget)
+	logger.info("Generating %i potentials in %i process(es)" % (len(sections), procCount))
+
+	def addPotential(section, data):
+		potential = basePropagator.GeneratePotential(section)
+		if not referencePotential.CanConsolidate(potential):
+			raise Exception("Cannot consolidate potential %s with %s" % \
+				(potential.Name, referencePotential.Name))
+		data += scaling * potential.PotentialData
+		del potential
+
+	key = GetMemoryLedger().Register("PotentialGeneration", "Partial sums", \
+		refData.nbytes * procCount)
+	try:
+		data, = ParallelReduce(addPotential, sections, [(refData.shape, refData.dtype)], procCount)
+	finally:
+		GetMemoryLedger().Release(key)
+	return data
@@ -1,5 +1,11 @@
+from __future__ import with_statement
 import pyprop
 from ..utils import RegisterAll, RegisterProjectNamespace
+from ..instrumentation import InstrumentScope
+from ..memoryledger import GetMemoryLedger, RegisterTensorPotential
+from potentialgeneration import GenerateSummedPotentialData, GetPotentialProcessCount
+from layout import GetAngularRank, GetAngularMajorData, GetAngularMajorView, \
+	GetAngularMajorPotentialData, GetRadialBasisPairs
 
 @RegisterAll
 class RadialPreconditioner:
@@ -44,21 +50,37 @@ class RadialPreconditioner:
 		and add them together, assuming they have the same layout
 		ending up with a potential containing S + scalingH * (P1 + P2 + ...)
 
+		The potentials P1, P2, ... are generated concurrently in forked
+		processes if enabled with EINPARTIKKEL_SETUP_PROCS (experimental,
+		see potentialgeneration.py).
+
 		The radial part of this potential is then converted to compressed col storage
 		and factorized.
 		"""
 
+		ledger = GetMemoryLedger()
+
 		#Setup overlap potential
-		pyprop.PrintMemoryUsage("Before Preconditioner Generate Potential (Overlap)")
 		tensorPotential = prop.BasePropagator.GeneratePotential(self.OverlapSection)
 		tensorPotential.PotentialData *= self.GetOverlapScaling()
+		RegisterTensorPotential(tensorPotential, "RadialPreconditioner", "PreconditionerPotential")
 
 		#Add all potentials to solver
 		scalingH = self.GetHamiltonianScaling()
-		for conf in self.PotentialSections:
-			pyprop.PrintMemoryUsage("Before Preconditioner Generate Potential (%s)" % conf)
+		procCount = GetPotentialProcessCount(len(self.PotentialSections), \
+			tensorPotential.PotentialData.nbytes)
+		if procCount > 1:
+			tensorPotential.PotentialData += GenerateSummedPotentialData(prop.BasePropagator, \
+				self.PotentialSections, tensorPotential, scalingH, procCount)
+			sequentialSections = []
+		else:
+			sequentialSections = self.PotentialSections
+
+		for conf in sequentialSections:
 			#Setup potential in basis
 			potential = prop.BasePropagator.GeneratePotential(conf)
+			key = ledger.Register("PreconditionerPotential", "RadialPreconditioner (%s)" % \
+				potential.Name, potential.PotentialData.nbytes)
 			if not tensorPotential.CanConsolidate(potential):
 				raise Exception("Cannot consolidate potential %s with overlap-potential" % (potential.Name))
 		
@@ -66,12 +88,14 @@ class RadialPreconditioner:
 			potential.PotentialData *= scalingH
 			tensorPotential.PotentialData += potential.PotentialData
 			del potential
-		pyprop.PrintMemoryUsage("After Preconditioner Generate Potentials")
+			ledger.Release(key)
 
 	
 		#Setup solvers
 		tensorPotential.SetupStep(0.0)
-		self.SetupRadialSolvers(tensorPotential)
+		with InstrumentScope("RadialPreconditioner.SetupRadialSolvers"):
+			self.SetupRadialSolvers(tensorPotential)
+		ledger.LogReport()
 
 	def SetupRadialSolvers(self, tensorPotential):
 		raise NotImplementedException("Please Override")
@@ -95,33 +119,54 @@ class RadialPreconditionerIfpack(RadialPreconditioner):
 		self.Cutoff = conf.cutoff
 
 	def SetupRadialSolvers(self, tensorPotential):
-		pyprop.PrintMemoryUsage("Before Ifpack Setup")
-
 		#Setup the ILU preconditioner for each radial rank
+		self.AngularRank = GetAngularRank(self.psi)
+		data = GetAngularMajorData(self.psi)
+		potentialData = GetAngularMajorPotentialData(tensorPotential, self.AngularRank)
+		self.RadialBuffer = data[0, :].copy()
+
 		radialSolvers = []
-		matrixCount = tensorPotential.PotentialData.shape[0]
-		assert(tensorPotential.PotentialData.shape[0] == self.psi.GetData().shape[0])
+		matrixCount = potentialData.shape[0]
+		assert(potentialData.shape[0] == data.shape[0])
 		for i in range(matrixCount):
-			vector = self.psi.GetData()[i,:]
-			matrix = tensorPotential.PotentialData[i, :]
+			vector = data[i, :]
+			matrix = potentialData[i, :]
+			if self.AngularRank != 0:
+				vector = self.RadialBuffer
+				matrix = matrix.copy()
 
 			solver = pyprop.CreateInstanceRank("core.IfpackRadialPreconditioner", 1)
-			basisPairs = tensorPotential.BasisPairs[1:]
+			basisPairs = [GetRadialBasisPairs(tensorPotential, self.AngularRank)]
 			solver.Setup(vector, matrix, basisPairs, self.Cutoff)
 			radialSolvers.append(solver)
 
+			#The ILU factors are held by Ifpack, their size is estimated
+			#by the size of the radial block
+			GetMemoryLedger().Register("PreconditionerBlock", "Ifpack block %i" % i, \
+				matrix.nbytes, owner=solver)
+
 		self.RadialSolvers = radialSolvers
-		pyprop.PrintMemoryUsage("After Ifpack Setup")
 
 	def Solve(self, psi):
-		data = psi.GetData()
+		data = GetAngularMajorView(psi.GetData(), self.AngularRank)
 		
 		angularCount = data.shape[0]
 		if angularCount != len(self.RadialSolvers):
 			raise Exception("Invalid Angular Count")
 
-		for angularIndex, solve in enumerate(self.RadialSolvers):
-			solve.Solve(data[angularIndex, :])
+		with InstrumentScope("RadialPreconditionerIfpack.Solve", data.nbytes):
+			if self.AngularRank == 0:
+				for angularIndex, solve in enumerate(self.RadialSolvers):
+					solve.Solve(data[angularIndex, :])
+				return
+
+			#Radial vectors are strided in radial-major data, solve in a
+			#contiguous buffer
+			buffer = self.RadialBuffer
+			for angularIndex, solve in enumerate(self.RadialSolvers):
+				buffer[:] = data[angularIndex, :]
+				solve.Solve(buffer)
+				data[angularIndex, :] = buffer
 		
 
 
@@ -0,0 +1,218 @@
+"""
+prolatespheroidal
+=================
+
+One-electron diatomic molecules (H2+ type targets) in prolate spheroidal
+coordinates,
+
+	xi  = (r1 + r2) / R,   1 <= xi < inf
+	eta = (r1 - r2) / R,  -1 <= eta <= 1
+
+and the azimuthal angle phi around the internuclear axis. Nucleus 1
+(charge Z1) sits at z = -R/2 (xi = 1, eta = -1), nucleus 2 (charge Z2) at
+z = R/2.
+
+With the volume element (R/2)^3 (xi^2 - eta^2) dxi deta dphi, the
+two-centre Coulomb potential becomes the polynomial
+
+	-(R^2/4) [(Z1 + Z2) xi + (Z2 - Z1) eta]
+
+so the nuclear singularities are handled exactly, and a compact product
+basis converges where the single centre expansion of
+DiatomicCoulombPotential needs a very large lmax.
+
+For a given m, xi is discretised with FEDVR (fedvr.py), and eta with a
+Gauss-Legendre DVR. All potentials, the overlap and the dipole coupling
+z = (R/2) xi eta are diagonal, and the kinetic energy is the sum of a
+banded xi part and a dense (small) eta part. Index order is
+[xi, eta], eta fastest.
+
+Example
+-------
+>>> basis = ProlateSpheroidalBasis(2.0, GetElementBoundaries(1, 20, 20), 8, 16, m=0)
+>>> E, V = basis.GetEigenstates(count=2, shift=-1.2)
+>>> lmax, rGrid = 20, linspace(0.1, 15, 100)
+>>> radial = basis.GetSphericalHarmonicExpansion(V[:, 0], rGrid, lmax)
+
+"""
+from numpy import array, zeros, ones, arange, sqrt, pi, double, asarray, \
+	argsort, dot, kron, diag
+import scipy.sparse
+import scipy.sparse.linalg
+import scipy.linalg
+import scipy.special
+from ..utils import RegisterAll
+from fedvr import FEDVRRadialBasis, GetGaussLegendreQuadrature, \
+	GetLagrangeDerivativeMatrix, GetLagrangeValues, GetElementBoundaries
+
+
+@RegisterAll
+class ProlateSpheroidalBasis(object):
+	"""
+	Product DVR basis in (xi, eta) for azimuthal quantum number m
+
+	Parametres
+	----------
+	internuclearDistance: (float) R
+	xiBoundaries:         (array) FEDVR element boundaries in xi,
+	                      starting at 1
+	xiOrder:              (int) Gauss-Lobatto nodes per xi element
+	etaCount:             (int) Gauss-Legendre nodes in eta
+	m:                    (int) azimuthal quantum number
+	charges:              (tuple) nuclear charges (Z1, Z2)
+	"""
+
+	def __init__(self, internuclearDistance, xiBoundaries, xiOrder, etaCount, \
+			m=0, charges=(1.0, 1.0)):
+		if abs(xiBoundaries[0] - 1) > 1e-12:
+			raise Exception("xi must start at 1")
+		self.R = internuclearDistance
+		self.M = m
+		self.Charges = charges
+
+		#psi is finite on the axis for m = 0, and vanishes as
+		#(xi^2 - 1)^{|m|/2} otherwise
+		self.XiBasis = FEDVRRadialBasis(xiBoundaries, xiOrder, keepFirstNode=(m == 0))
+		self.Xi = self.XiBasis.Grid
+		self.Eta, self.EtaWeights = GetGaussLegendreQuadrature(etaCount)
+		self.EtaDerivative = GetLagrangeDerivativeMatrix(self.Eta)
+
+		self.XiCount = len(self.Xi)
+		self.EtaCount = etaCount
+		self.Size = self.XiCount * self.EtaCount
+
+		#[xi, eta] grids, flattened with eta fastest
+		self.XiGrid = kron(self.Xi, ones(etaCount))
+		self.EtaGrid = kron(ones(self.XiCount), self.Eta)
+
+	def GetOverlapDiagonal(self):
+		"""Diagonal overlap, the volume element (R/2)^3 (xi^2 - eta^2)"""
+		return (self.R / 2.)**3 * (self.XiGrid**2 - self.EtaGrid**2)
+
+	def GetKineticMatrix(self, mass=1.0):
+		"""
+		Kinetic energy (sparse), from the weak form
+
+		  R/(4 mass) [ <d_xi|(xi^2-1)|d_xi> + <d_eta|(1-eta^2)|d_eta>
+		             + m^2 (1/(xi^2-1) + 1/(1-eta^2)) ]
+		"""
+		xiStiffness = self.XiBasis.GetStiffnessMatrix(lambda xi: xi**2 - 1)
+
+		w = self.EtaWeights
+		D = self.EtaDerivative
+		etaStiffness = dot(D.transpose() * (w * (1 - self.Eta**2))[None, :], D)
+		etaStiffness /= sqrt(w)[:, None] * sqrt(w)[None, :]
+
+		identityXi = scipy.sparse.identity(self.XiCount)
+		identityEta = scipy.sparse.identity(self.EtaCount)
+		T = scipy.sparse.kron(scipy.sparse.csr_matrix(xiStiffness), identityEta) \
+			+ scipy.sparse.kron(identityXi, scipy.sparse.csr_matrix(etaStiffness))
+		if self.M != 0:
+			centrifugal = self.M**2 * (1. / (self.XiGrid**2 - 1) + 1. / (1 - self.EtaGrid**2))
+			T = T + scipy.sparse.spdiags(centrifugal, 0, self.Size, self.Size)
+		return (self.R / (4. * mass)) * T.tocsr()
+
+	def GetCoulombDiagonal(self):
+		"""Two-centre Coulomb potential times the volume element"""
+		Z1, Z2 = self.Charges
+		return -(self.R**2 / 4.) * ((Z1 + Z2) * self.XiGrid + (Z2 - Z1) * self.EtaGrid)
+
+	def GetDipoleDiagonal(self):
+		"""
+		z = (R/2) xi eta times the volume element, the coupling to a field
+		along the internuclear axis (length gauge, conserves m)
+		"""
+		return (self.R / 2.) * self.XiGrid * self.EtaGrid * self.GetOverlapDiagonal()
+
+	def GetHamiltonian(self, mass=1.0, fieldStrength=0.0):
+		"""
+		H (sparse), the kinetic energy, the Coulomb potential and optionally
+		a static field along the axis, times the volume element.
+		The electronic energy excludes the nuclear repulsion Z1 Z2 / R.
+		"""
+		diagonal = self.GetCoulombDiagonal()
+		if fieldStrength != 0:
+			diagonal = diagonal + fieldStrength * self.GetDipoleDiagonal()
+		return self.GetKineticMatrix(mass) + scipy.sparse.spdiags(diagonal, 0, self.Size, self.Size)
+
+	def GetEigenstates(self, count=1, shift=None, mass=1.0):
+		"""
+		E, V = GetEigenstates(count, shift, mass)
+
+		The count eigenpairs of H closest to shift (lowest if shift is
+		None). The generalised problem H c = E S c with diagonal S is
+		solved as the standard problem S^-1/2 H S^-1/2. The columns of V are
+		normalised as sum(S |c|^2) = 1.
+		"""
+		sInvSqrt = 1. / sqrt(self.GetOverlapDiagonal())
+		scaling = scipy.sparse.spdiags(sInvSqrt, 0, self.Size, self.Size)
+		H = (scaling * self.GetHamiltonian(mass) * scaling).tocsc()
+
+		if shift == None or count >= self.Size - 1:
+			E, V = scipy.linalg.eigh(H.toarray())
+			idx = argsort(abs(E - shift))[:count] if shift != None else arange(count)
+		else:
+			E, V = scipy.sparse.linalg.eigsh(H, k=count, sigma=shift, which="LM")
+			idx = argsort(E)
+		E = E[idx]
+		V = V[:, idx] * sInvSqrt[:, None]
+		return E, V
+
+	def GetValues(self, coefficients, xi, eta):
+		"""
+		Values of the expansion coefficients at the points (xi, eta)
+		(without the phi dependence exp(i m phi) / sqrt(2 pi))
+		"""
+		xiValues = self.XiBasis.GetBasisValues(asarray(xi))
+		etaValues = GetLagrangeValues(self.Eta, asarray(eta)) / sqrt(self.EtaWeights)[None, :]
+		c = coefficients.reshape(self.XiCount, self.EtaCount)
+		return (dot(xiValues, c) * etaValues).sum(axis=1)
+
+	def GetSphericalHarmonicExpansion(self, coefficients, rGrid, lmax, thetaCount=None):
+		"""
+		radial = GetSphericalHarmonicExpansion(coefficients, rGrid, lmax, thetaCount)
+
+		Expand a state in spherical harmonics Y_lm about the midpoint of the
+		nuclei, for comparison with (and analysis as) the spherical B-spline
+		representation.
+
+		Returns
+		-------
+		radial: (array) [l - |m|, r], the reduced radial functions
+		        r * <Y_lm|psi>(r) for l = |m|, ..., lmax
+		"""
+		m = abs(self.M)
+		if thetaCount == None:
+			thetaCount = 2 * lmax + 2
+		cosTheta, thetaWeights = GetGaussLegendreQuadrature(thetaCount)
+		rGrid = asarray(rGrid, dtype=double)
+
+		#(xi, eta) of all (r, theta) points
+		r = kron(rGrid, ones(thetaCount))
+		c = kron(ones(len(rGrid)), cosTheta)
+		r1 = sqrt(r**2 + self.R**2 / 4. + r * self.R * c)
+		r2 = sqrt(r**2 + self.R**2 / 4. - r * self.R * c)
+		xi = (r1 + r2) / self.R
+		eta = (r1 - r2) / self.R
+		values = self.GetValues(coefficients, xi, eta).reshape(len(rGrid), thetaCount)
+
+		#<Y_lm|psi> = sqrt(2 pi) N_lm int P_l^m(cos theta) u dcos theta
+		lList = arange(m, lmax + 1)
+		radial = zeros((len(lList), len(rGrid)), dtype=values.dtype)
+		for i, l in enumerate(lList):
+			norm = sqrt((2 * l + 1) / (4 * pi) * scipy.special.gamma(l - m + 1) / scipy.special.gamma(l + m + 1))
+			legendre = norm * scipy.special.lpmv(m, l, cosTheta)
+			radial[i, :] = sqrt(2 * pi) * dot(values, thetaWeights * legendre) * rGrid
+		return radial
+
+
+@RegisterAll
+def CreateProlateSpheroidalBasis(conf):
+	"""
+	Create a ProlateSpheroidalBasis from a config section with
+	internuclear_distance, xi_max, xi_element_count, xi_order, eta_count,
+	and optionally m and charges
+	"""
+	boundaries = GetElementBoundaries(1.0, conf.xi_max, conf.xi_element_count)
+	return ProlateSpheroidalBasis(conf.internuclear_distance, boundaries, conf.xi_order, \
+		conf.eta_count, getattr(conf, "m", 0), getattr(conf, "charges", (1.0, 1.0)))
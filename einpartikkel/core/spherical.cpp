@@ -9,6 +9,7 @@ class CustomPotential_AngularKineticEnergy_Spherical : public CustomPotentialSph
 public:
 	typedef blitz::Array<int, 2> BasisPairList;
 	double Mass;
+	SeparablePotentialData Separable;
 
 public:
 	CustomPotential_AngularKineticEnergy_Spherical() {}
@@ -22,6 +23,9 @@ public:
 
 	virtual void UpdatePotentialData(typename blitz::Array<cplx, Rank> data, typename Wavefunction<Rank>::Ptr psi, cplx timeStep, double curTime)
 	{
+		INSTRUMENT_SCOPE("CustomPotential_AngularKineticEnergy_Spherical::UpdatePotentialData");
+		INSTRUMENT_BYTES("CustomPotential_AngularKineticEnergy_Spherical::UpdatePotentialData", data.size() * sizeof(cplx));
+
 		typedef CombinedRepresentation<Rank> CmbRepr;
 		typename CmbRepr::Ptr repr = boost::static_pointer_cast< CmbRepr >(psi->GetRepresentation());
 		SphericalHarmonicBasisRepresentation::Ptr angRepr = boost::static_pointer_cast< SphericalHarmonicBasisRepresentation >(repr->GetRepresentation(this->AngularRank));
@@ -35,13 +39,15 @@ public:
 		if (data.extent(this->RadialRank) != rCount) throw std::runtime_error("Invalid r size");
 		if (data.extent(this->AngularRank) != angBasisPairs.extent(0)) throw std::runtime_error("Invalid ang size");
 
-		data = 0;
-		blitz::TinyVector<int, Rank> index;
+		Separable.Setup(angCount, rCount);
+		for (int ri=0; ri<rCount; ri++)
+		{
+			double r = localr(ri);
+			Separable.Radial(ri) = 1.0 / (2.0 * Mass * r * r);
+		}
 	
 		for (int angIndex=0; angIndex<angCount; angIndex++)
 		{
-			index(this->AngularRank) = angIndex;
-
 			int leftIndex = angBasisPairs(angIndex, 0);
 			int rightIndex = angBasisPairs(angIndex, 1);
 	
@@ -56,14 +62,10 @@ public:
 				continue;
 			}
 			centrifugalTerm = left.l * (left.l + 1);
-
-			for (int ri=0; ri<rCount; ri++)
-			{
-				index(this->RadialRank) = ri;
-				double r = localr(ri);
-				data(index) = centrifugalTerm / (2.0 * Mass * r * r);
-			}
+			Separable.Angular(angIndex) = centrifugalTerm;
 		}
+
+		Separable.Assign(data, this->AngularRank, this->RadialRank);
 	}
 };
 
@@ -81,6 +83,7 @@ public:
 	virtual ~SphericalKineticEnergyEvaluator() {}
 
 	double Mass;
+	SeparablePotentialData Separable;
 
 	virtual void ApplyConfigSection(const ConfigSection &config)
 	{
@@ -90,6 +93,9 @@ public:
 
 	virtual void UpdatePotentialData(typename blitz::Array<cplx, Rank> data, typename Wavefunction<Rank>::Ptr psi, cplx timeStep, double curTime)
 	{
+		INSTRUMENT_SCOPE("SphericalKineticEnergyEvaluator::UpdatePotentialData");
+		INSTRUMENT_BYTES("SphericalKineticEnergyEvaluator::UpdatePotentialData", data.size() * sizeof(cplx));
+
 		using namespace SphericalBasis;
 
 		typedef CombinedRepresentation<Rank> CmbRepr;
@@ -110,32 +116,28 @@ public:
 		if (data.extent(this->RadialRank) != rCount) throw std::runtime_error("Invalid r size");
 		if (data.extent(this->AngularRank) != angBasisPairs.extent(0)) throw std::runtime_error("Invalid ang size");
 
-		blitz::TinyVector<int, Rank> index;
-		data = 0;
-	
+		Separable.Setup(angCount, rCount);
 		for (int ri=0; ri<rCount; ri++)
 		{
-			index(this->RadialRank) = ri;
 			double r = localr(ri);
+			Separable.Radial(ri) = 1. / (2. * Mass * r * r);
+		}
 	
-			for (int angIndex=0; angIndex<angCount; angIndex++)
-			{
-				index(this->AngularRank) = angIndex;
-
-				int leftIndex = angBasisPairs(angIndex, 0);
-				int rightIndex = angBasisPairs(angIndex, 1);
+		for (int angIndex=0; angIndex<angCount; angIndex++)
+		{
+			int leftIndex = angBasisPairs(angIndex, 0);
+			int rightIndex = angBasisPairs(angIndex, 1);
 	
-				LmIndex left = angRepr->Range.GetLmIndex(leftIndex);
-				LmIndex right = angRepr->Range.GetLmIndex(rightIndex);
+			LmIndex left = angRepr->Range.GetLmIndex(leftIndex);
+			LmIndex right = angRepr->Range.GetLmIndex(rightIndex);
 	
-				if (left.l != right.l) continue;
-				if (left.m != right.m) continue;
+			if (left.l != right.l) continue;
+			if (left.m != right.m) continue;
 
-				double V = left.l * (left.l + 1.) / (2. * Mass * r * r);
-	
-				data(index) = V;
-			}
+			Separable.Angular(angIndex) = left.l * (left.l + 1.);
 		}
+
+		Separable.Assign(data, this->AngularRank, this->RadialRank);
 	}
 };
 
@@ -6,8 +6,77 @@
 #include <core/representation/combinedrepresentation.h>
 #include <core/representation/sphericalbasis/sphericalharmonicbasisrepresentation.h>
 
+#include "instrumentation.h"
+
 using namespace SphericalBasis;
 
+/*
+ * Potential data of the separable form
+ *
+ *   data(angIndex, ri) = Angular(angIndex) * Radial(ri)
+ *
+ * shared by the spherical evaluators. Assign() writes data in memory order
+ * for either wavefunction layout, with the loop over the last rank
+ * innermost: radial innermost for angular-major data (angular_rank = 0),
+ * angular innermost for radial-major data (radial_rank = 0). The buffers
+ * are kept between calls, so repeated updates do not allocate.
+ */
+class SeparablePotentialData
+{
+public:
+	blitz::Array<cplx, 1> Angular;
+	blitz::Array<double, 1> Radial;
+
+	/*
+	 * Size the buffers and set them to zero
+	 */
+	void Setup(int angCount, int rCount)
+	{
+		if (Angular.extent(0) != angCount) Angular.resize(angCount);
+		if (Radial.extent(0) != rCount) Radial.resize(rCount);
+		Angular = 0;
+		Radial = 0;
+	}
+
+	template<int Rank>
+	void Assign(blitz::Array<cplx, Rank> data, int angularRank, int radialRank) const
+	{
+		int angCount = Angular.extent(0);
+		int rCount = Radial.extent(0);
+		if (data.extent(angularRank) != angCount) throw std::runtime_error("Invalid ang size");
+		if (data.extent(radialRank) != rCount) throw std::runtime_error("Invalid r size");
+
+		blitz::TinyVector<int, Rank> index;
+		index = 0;
+		if (angularRank < radialRank)
+		{
+			for (int angIndex=0; angIndex<angCount; angIndex++)
+			{
+				index(angularRank) = angIndex;
+				cplx angular = Angular(angIndex);
+				for (int ri=0; ri<rCount; ri++)
+				{
+					index(radialRank) = ri;
+					data(index) = angular * Radial(ri);
+				}
+			}
+		}
+		else
+		{
+			for (int ri=0; ri<rCount; ri++)
+			{
+				index(radialRank) = ri;
+				double radial = Radial(ri);
+				for (int angIndex=0; angIndex<angCount; angIndex++)
+				{
+					index(angularRank) = angIndex;
+					data(index) = Angular(angIndex) * radial;
+				}
+			}
+		}
+	}
+};
+
 template<int Rank>
 class CustomPotentialSphericalBase
 {
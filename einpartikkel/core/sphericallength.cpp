@@ -14,6 +14,7 @@ public:
 	virtual ~CustomPotential_LaserLength_Z() {}
 
 	cplx Charge;
+	SeparablePotentialData Separable;
 
 	virtual void ApplyConfigSection(const ConfigSection &config)
 	{
@@ -24,6 +25,9 @@ public:
 
 	virtual void UpdatePotentialData(typename blitz::Array<cplx, Rank> data, typename Wavefunction<Rank>::Ptr psi, cplx timeStep, double curTime)
 	{
+		INSTRUMENT_SCOPE("CustomPotential_LaserLength_Z::UpdatePotentialData");
+		INSTRUMENT_BYTES("CustomPotential_LaserLength_Z::UpdatePotentialData", data.size() * sizeof(cplx));
+
 
 		typedef CombinedRepresentation<Rank> CmbRepr;
 		typedef SphericalHarmonicBasisRepresentation SphHarmRepr;
@@ -43,12 +47,14 @@ public:
 		if (data.extent(this->RadialRank) != rCount) throw std::runtime_error("Invalid r size");
 		if (data.extent(this->AngularRank) != angBasisPairs.extent(0)) throw std::runtime_error("Invalid ang size");
 
-		blitz::TinyVector<int, Rank> index;
-		data = 0;
+		Separable.Setup(angCount, rCount);
+		for (int ri=0; ri<rCount; ri++)
+		{
+			Separable.Radial(ri) = localr(ri);
+		}
 	
 		for (int angIndex=0; angIndex<angCount; angIndex++)
 		{
-			index(this->AngularRank) = angIndex;
 
 			int leftIndex = angBasisPairs(angIndex, 0);
 			int rightIndex = angBasisPairs(angIndex, 1);
@@ -71,18 +77,12 @@ public:
 			double I = cg(lp,1,0,0,l,0) * cg(lp,1,mp,0,l,m);
 			I *= Coefficient(lp, l);
 
-			//Radial matrix element 
-			for (int ri=0; ri<rCount; ri++)
-			{
-				double r = localr(ri);
-				index(this->RadialRank) = ri;
-
-				data(index) += I * r;
-			}
+			Separable.Angular(angIndex) = I;
 		}
 
 		//Charge scaling from config
-		data *= (-1.) * Charge;
+		Separable.Angular *= (-1.) * Charge;
+		Separable.Assign(data, this->AngularRank, this->RadialRank);
 	}
 
 	static double Coefficient(int a, int b)
@@ -106,6 +106,7 @@ public:
 	virtual ~CustomPotential_LaserLength_X() {}
 
 	cplx Charge;
+	SeparablePotentialData Separable;
 
 	virtual void ApplyConfigSection(const ConfigSection &config)
 	{
@@ -116,6 +117,9 @@ public:
 
 	virtual void UpdatePotentialData(typename blitz::Array<cplx, Rank> data, typename Wavefunction<Rank>::Ptr psi, cplx timeStep, double curTime)
 	{
+		INSTRUMENT_SCOPE("CustomPotential_LaserLength_X::UpdatePotentialData");
+		INSTRUMENT_BYTES("CustomPotential_LaserLength_X::UpdatePotentialData", data.size() * sizeof(cplx));
+
 
 		typedef CombinedRepresentation<Rank> CmbRepr;
 		typedef SphericalHarmonicBasisRepresentation SphHarmRepr;
@@ -135,12 +139,14 @@ public:
 		if (data.extent(this->RadialRank) != rCount) throw std::runtime_error("Invalid r size");
 		if (data.extent(this->AngularRank) != angBasisPairs.extent(0)) throw std::runtime_error("Invalid ang size");
 
-		blitz::TinyVector<int, Rank> index;
-		data = 0;
+		Separable.Setup(angCount, rCount);
+		for (int ri=0; ri<rCount; ri++)
+		{
+			Separable.Radial(ri) = localr(ri);
+		}
 	
 		for (int angIndex=0; angIndex<angCount; angIndex++)
 		{
-			index(this->AngularRank) = angIndex;
 
 			int leftIndex = angBasisPairs(angIndex, 0);
 			int rightIndex = angBasisPairs(angIndex, 1);
@@ -163,18 +169,12 @@ public:
 			double I = cg(lp,1,0,0,l,0) * (cg(lp,1,mp,-1,l,m) - cg(lp,1,mp,1,l,m));
 			I *= Coefficient(lp, l);
 
-			//Radial matrix element 
-			for (int ri=0; ri<rCount; ri++)
-			{
-				double r = localr(ri);
-				index(this->RadialRank) = ri;
-
-				data(index) += I * r;
-			}
+			Separable.Angular(angIndex) = I;
 		}
 
 		//Charge scaling form config
-		data *= (-1.) * Charge;
+		Separable.Angular *= (-1.) * Charge;
+		Separable.Assign(data, this->AngularRank, this->RadialRank);
 	}
 
 	static double Coefficient(int a, int b)
@@ -198,6 +198,7 @@ public:
 	virtual ~CustomPotential_LaserLength_Y() {}
 
 	cplx Charge;
+	SeparablePotentialData Separable;
 
 	virtual void ApplyConfigSection(const ConfigSection &config)
 	{
@@ -208,6 +209,9 @@ public:
 
 	virtual void UpdatePotentialData(typename blitz::Array<cplx, Rank> data, typename Wavefunction<Rank>::Ptr psi, cplx timeStep, double curTime)
 	{
+		INSTRUMENT_SCOPE("CustomPotential_LaserLength_Y::UpdatePotentialData");
+		INSTRUMENT_BYTES("CustomPotential_LaserLength_Y::UpdatePotentialData", data.size() * sizeof(cplx));
+
 
 		typedef CombinedRepresentation<Rank> CmbRepr;
 		typedef SphericalHarmonicBasisRepresentation SphHarmRepr;
@@ -227,14 +231,16 @@ public:
 		if (data.extent(this->RadialRank) != rCount) throw std::runtime_error("Invalid r size");
 		if (data.extent(this->AngularRank) != angBasisPairs.extent(0)) throw std::runtime_error("Invalid ang size");
 
-		blitz::TinyVector<int, Rank> index;
-		data = 0;
+		Separable.Setup(angCount, rCount);
+		for (int ri=0; ri<rCount; ri++)
+		{
+			Separable.Radial(ri) = localr(ri);
+		}
 		cplx IM(0,1.0);
 
 	
 		for (int angIndex=0; angIndex<angCount; angIndex++)
 		{
-			index(this->AngularRank) = angIndex;
 
 			int leftIndex = angBasisPairs(angIndex, 0);
 			int rightIndex = angBasisPairs(angIndex, 1);
@@ -258,20 +264,12 @@ public:
 			double I = cg(lp,1,0,0,l,0) * (cg(lp,1,mp,-1,l,m) + cg(lp,1,mp,1,l,m));
 			I *= Coefficient(lp, l);
 
-			//Radial matrix element 
-			for (int ri=0; ri<rCount; ri++)
-			{
-				double r = localr(ri);
-				index(this->RadialRank) = ri;
-
-				data(index) += I * r;
-			}
+			Separable.Angular(angIndex) = I;
 		}
 	
-		data *= IM;
-		
 		//Charge scaling from config
-		data *= (-1.) * Charge;
+		Separable.Angular *= (-1.) * IM * Charge;
+		Separable.Assign(data, this->AngularRank, this->RadialRank);
 	}
 
 	static double Coefficient(int a, int b)
@@ -23,6 +23,7 @@ public:
 	virtual ~CustomPotential_LaserVelocity() {}
 
 	cplx Charge;
+	SeparablePotentialData Separable;
 
 	void ApplyConfigSection(const ConfigSection &config)
 	{
@@ -51,6 +52,9 @@ public:
 
 	virtual void UpdatePotentialData(typename blitz::Array<cplx, Rank> data, typename Wavefunction<Rank>::Ptr psi, cplx timeStep, double curTime)
 	{
+		INSTRUMENT_SCOPE("CustomPotential_LaserVelocity::UpdatePotentialData");
+		INSTRUMENT_BYTES("CustomPotential_LaserVelocity::UpdatePotentialData", data.size() * sizeof(cplx));
+
 		typedef CombinedRepresentation<Rank> CmbRepr;
 		typedef SphericalHarmonicBasisRepresentation SphHarmRepr;
 
@@ -68,13 +72,14 @@ public:
 		if (data.extent(this->AngularRank) != angBasisPairs.extent(0)) throw std::runtime_error("Invalid ang size");
 
 		cplx IM(0,1.0);
-		blitz::TinyVector<int, Rank> index;
-		data = 0;
+		Separable.Setup(angCount, rCount);
+		for (int ri=0; ri<rCount; ri++)
+		{
+			Separable.Radial(ri) = 1.0 / localr(ri);
+		}
 
 		for (int angIndex=0; angIndex<angCount; angIndex++)
 		{
-			index(AngularRank) = angIndex;
-
 			int leftIndex = angBasisPairs(angIndex, 0);
 			int rightIndex = angBasisPairs(angIndex, 1);
 	
@@ -101,17 +106,11 @@ public:
 			double coupling = -(C + D) - (E + F);
 
 
-			for (int ri=0; ri<rCount; ri++)
-			{
-				index(RadialRank) = ri;
-				double r = localr(ri);
-				
-				data(index) = - IM * coupling/r;
-
-				//Charge scaling from config
-				data(index) *= (-1.0) * Charge;
-			}
+			//Charge scaling from config
+			Separable.Angular(angIndex) = (-1.0) * Charge * (- IM * coupling);
 		}
+
+		Separable.Assign(data, AngularRank, RadialRank);
 	}
 };
 
@@ -139,6 +138,7 @@ public:
 	virtual ~CustomPotential_LaserVelocityDerivativeR() {}
 
 	cplx Charge;
+	SeparablePotentialData Separable;
 
 	void ApplyConfigSection(const ConfigSection &config)
 	{
@@ -167,6 +167,9 @@ public:
 
 	virtual void UpdatePotentialData(typename blitz::Array<cplx, Rank> data, typename Wavefunction<Rank>::Ptr psi, cplx timeStep, double curTime)
 	{
+		INSTRUMENT_SCOPE("CustomPotential_LaserVelocityDerivativeR::UpdatePotentialData");
+		INSTRUMENT_BYTES("CustomPotential_LaserVelocityDerivativeR::UpdatePotentialData", data.size() * sizeof(cplx));
+
 		typedef CombinedRepresentation<Rank> CmbRepr;
 		typedef SphericalHarmonicBasisRepresentation SphHarmRepr;
 
@@ -184,13 +187,14 @@ public:
 		if (data.extent(this->AngularRank) != angBasisPairs.extent(0)) throw std::runtime_error("Invalid ang size");
 
 		cplx IM(0,1.0);
-		blitz::TinyVector<int, Rank> index;
-		data = 0;
+		Separable.Setup(angCount, rCount);
+		for (int ri=0; ri<rCount; ri++)
+		{
+			Separable.Radial(ri) = 1.0;
+		}
 
 		for (int angIndex=0; angIndex<angCount; angIndex++)
 		{
-			index(AngularRank) = angIndex;
-
 			int leftIndex = angBasisPairs(angIndex, 0);
 			int rightIndex = angBasisPairs(angIndex, 1);
 	
@@ -215,15 +219,11 @@ public:
 			double coupling = (E + F);
 
 
-			for (int ri=0; ri<rCount; ri++)
-			{
-				index(RadialRank) = ri;
-				data(index) = - IM* coupling;
-
-				//Charge scaling from config
-				data(index) *= (-1.0) * Charge;
-			}
+			//Charge scaling from config
+			Separable.Angular(angIndex) = (-1.0) * Charge * (- IM * coupling);
 		}
+
+		Separable.Assign(data, AngularRank, RadialRank);
 	}
 };
 
@@ -30,6 +30,7 @@ public:
 	virtual ~CustomPotential_LaserVelocity_X() {}
 
 	cplx Charge;
+	SeparablePotentialData Separable;
 
 	void ApplyConfigSection(const ConfigSection &config)
 	{
@@ -59,6 +60,9 @@ public:
 
 	virtual void UpdatePotentialData(typename blitz::Array<cplx, Rank> data, typename Wavefunction<Rank>::Ptr psi, cplx timeStep, double curTime)
 	{
+		INSTRUMENT_SCOPE("CustomPotential_LaserVelocity_X::UpdatePotentialData");
+		INSTRUMENT_BYTES("CustomPotential_LaserVelocity_X::UpdatePotentialData", data.size() * sizeof(cplx));
+
 		typedef CombinedRepresentation<Rank> CmbRepr;
 		typedef SphericalHarmonicBasisRepresentation SphHarmRepr;
 
@@ -76,8 +80,11 @@ public:
 		if (data.extent(this->AngularRank) != angBasisPairs.extent(0)) throw std::runtime_error("Invalid ang size");
 
 		cplx IM(0,1.0);
-		blitz::TinyVector<int, Rank> index;
-		data = 0;
+		Separable.Setup(angCount, rCount);
+		for (int ri=0; ri<rCount; ri++)
+		{
+			Separable.Radial(ri) = 1.0 / localr(ri);
+		}
 
 		#ifdef USE_ARPREC
 		//Arbitrary precision library.
@@ -114,8 +121,6 @@ public:
 
 		for (int angIndex=0; angIndex<angCount; angIndex++)
 		{
-			index(AngularRank) = angIndex;
-
 			int leftIndex = angBasisPairs(angIndex, 0);
 			int rightIndex = angBasisPairs(angIndex, 1);
 	
@@ -141,17 +146,11 @@ public:
 			double coupling = velocityHelperXY::sphericalvelocityBodyXY(lp,mp,l,m,true);
 			#endif
 
-			for (int ri=0; ri<rCount; ri++)
-			{
-				index(RadialRank) = ri;
-				double r = localr(ri);
-				
-				data(index) = - IM * coupling/r;
-
-				//Charge scaling from config
-				data(index) *= (-1.0) * Charge;
-			}
+			//Charge scaling from config
+			Separable.Angular(angIndex) = (-1.0) * Charge * (- IM * coupling);
 		}
+
+		Separable.Assign(data, AngularRank, RadialRank);
 	}
 };
 
@@ -181,6 +180,7 @@ public:
 	virtual ~CustomPotential_LaserVelocityDerivativeR_X() {}
 
 	cplx Charge;
+	SeparablePotentialData Separable;
 
 	void ApplyConfigSection(const ConfigSection &config)
 	{
@@ -209,6 +209,9 @@ public:
 
 	virtual void UpdatePotentialData(typename blitz::Array<cplx, Rank> data, typename Wavefunction<Rank>::Ptr psi, cplx timeStep, double curTime)
 	{
+		INSTRUMENT_SCOPE("CustomPotential_LaserVelocityDerivativeR_X::UpdatePotentialData");
+		INSTRUMENT_BYTES("CustomPotential_LaserVelocityDerivativeR_X::UpdatePotentialData", data.size() * sizeof(cplx));
+
 		typedef CombinedRepresentation<Rank> CmbRepr;
 		typedef SphericalHarmonicBasisRepresentation SphHarmRepr;
 
@@ -226,15 +229,16 @@ public:
 		if (data.extent(this->AngularRank) != angBasisPairs.extent(0)) throw std::runtime_error("Invalid ang size");
 
 		cplx IM(0,1.0);
-		blitz::TinyVector<int, Rank> index;
-		data = 0;
+		Separable.Setup(angCount, rCount);
+		for (int ri=0; ri<rCount; ri++)
+		{
+			Separable.Radial(ri) = 1.0;
+		}
 
 		SphericalBasis::ClebschGordan cg;
 
 		for (int angIndex=0; angIndex<angCount; angIndex++)
 		{
-			index(AngularRank) = angIndex;
-
 			int leftIndex = angBasisPairs(angIndex, 0);
 			int rightIndex = angBasisPairs(angIndex, 1);
 	
@@ -265,15 +269,11 @@ public:
 			coupling = velocityHelperXY::I1integralX(l,m,lp,mp);
 
 
-			for (int ri=0; ri<rCount; ri++)
-			{
-				index(RadialRank) = ri;
-				data(index) = - IM * coupling;
-
-				//Charge scaling from config
-				data(index) *= (-1.0) * Charge;
-			}
+			//Charge scaling from config
+			Separable.Angular(angIndex) = (-1.0) * Charge * (- IM * coupling);
 		}
+
+		Separable.Assign(data, AngularRank, RadialRank);
 	}
 };
 
@@ -30,6 +30,7 @@ public:
 	virtual ~CustomPotential_LaserVelocity_Y() {}
 
 	cplx Charge;
+	SeparablePotentialData Separable;
 
 	void ApplyConfigSection(const ConfigSection &config)
 	{
@@ -58,6 +59,9 @@ public:
 
 	virtual void UpdatePotentialData(typename blitz::Array<cplx, Rank> data, typename Wavefunction<Rank>::Ptr psi, cplx timeStep, double curTime)
 	{
+		INSTRUMENT_SCOPE("CustomPotential_LaserVelocity_Y::UpdatePotentialData");
+		INSTRUMENT_BYTES("CustomPotential_LaserVelocity_Y::UpdatePotentialData", data.size() * sizeof(cplx));
+
 		typedef CombinedRepresentation<Rank> CmbRepr;
 		typedef SphericalHarmonicBasisRepresentation SphHarmRepr;
 
@@ -75,8 +79,11 @@ public:
 		if (data.extent(this->AngularRank) != angBasisPairs.extent(0)) throw std::runtime_error("Invalid ang size");
 
 		cplx IM(0,1.0);
-		blitz::TinyVector<int, Rank> index;
-		data = 0;
+		Separable.Setup(angCount, rCount);
+		for (int ri=0; ri<rCount; ri++)
+		{
+			Separable.Radial(ri) = 1.0 / localr(ri);
+		}
 
 		#ifdef USE_ARPREC
 		//Arbitrary precision library.
@@ -115,8 +122,6 @@ public:
 
 		for (int angIndex=0; angIndex<angCount; angIndex++)
 		{
-			index(AngularRank) = angIndex;
-
 			int leftIndex = angBasisPairs(angIndex, 0);
 			int rightIndex = angBasisPairs(angIndex, 1);
 	
@@ -142,18 +147,11 @@ public:
 			double coupling =  velocityHelperXY::sphericalvelocityBodyXY(lp,mp,l,m,false);
 			#endif
 
-			for (int ri=0; ri<rCount; ri++)
-			{
-				index(RadialRank) = ri;
-				double r = localr(ri);
-			
-				//Remember -i * i = 1
-				data(index) = coupling/r;
-
-				//Charge scaling from config
-				data(index) *= (-1.0) * Charge;
-			}
+			//Remember -i * i = 1, charge scaling from config
+			Separable.Angular(angIndex) = (-1.0) * Charge * coupling;
 		}
+
+		Separable.Assign(data, AngularRank, RadialRank);
 	}
 };
 
@@ -183,6 +181,7 @@ public:
 	virtual ~CustomPotential_LaserVelocityDerivativeR_Y() {}
 
 	cplx Charge;
+	SeparablePotentialData Separable;
 
 	void ApplyConfigSection(const ConfigSection &config)
 	{
@@ -211,6 +210,9 @@ public:
 
 	virtual void UpdatePotentialData(typename blitz::Array<cplx, Rank> data, typename Wavefunction<Rank>::Ptr psi, cplx timeStep, double curTime)
 	{
+		INSTRUMENT_SCOPE("CustomPotential_LaserVelocityDerivativeR_Y::UpdatePotentialData");
+		INSTRUMENT_BYTES("CustomPotential_LaserVelocityDerivativeR_Y::UpdatePotentialData", data.size() * sizeof(cplx));
+
 		typedef CombinedRepresentation<Rank> CmbRepr;
 		typedef SphericalHarmonicBasisRepresentation SphHarmRepr;
 
@@ -228,15 +230,16 @@ public:
 		if (data.extent(this->AngularRank) != angBasisPairs.extent(0)) throw std::runtime_error("Invalid ang size");
 
 		cplx IM(0,1.0);
-		blitz::TinyVector<int, Rank> index;
-		data = 0;
+		Separable.Setup(angCount, rCount);
+		for (int ri=0; ri<rCount; ri++)
+		{
+			Separable.Radial(ri) = 1.0;
+		}
 
 		SphericalBasis::ClebschGordan cg;
 
 		for (int angIndex=0; angIndex<angCount; angIndex++)
 		{
-			index(AngularRank) = angIndex;
-
 			int leftIndex = angBasisPairs(angIndex, 0);
 			int rightIndex = angBasisPairs(angIndex, 1);
 	
@@ -269,16 +272,11 @@ public:
 
 			
 
-			for (int ri=0; ri<rCount; ri++)
-			{
-				index(RadialRank) = ri;
-				//Remember -i * i = 1
-				data(index) = coupling;
-
-				//Charge scaling from config
-				data(index) *= (-1.0) * Charge;
-			}
+			//Remember -i * i = 1, charge scaling from config
+			Separable.Angular(angIndex) = (-1.0) * Charge * coupling;
 		}
+
+		Separable.Assign(data, AngularRank, RadialRank);
 	}
 };
 
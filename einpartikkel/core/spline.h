@@ -0,0 +1,171 @@
+#ifndef SPLINE_H
+#define SPLINE_H
+
+#include <vector>
+#include <cmath>
+#include <stdexcept>
+#include <algorithm>
+
+/*
+ * Monotone piecewise cubic Hermite interpolation (Fritsch-Carlson).
+ *
+ * The derivatives at the knots are limited so that the interpolant is
+ * monotone wherever the data is, which avoids the overshoots of a natural
+ * cubic spline near steep model potentials.
+ *
+ * Outside [x_0, x_n-1] the end values are returned (the derivative is zero
+ * and the integral continues linearly).
+ */
+class MonotoneCubicSpline
+{
+public:
+	MonotoneCubicSpline() {}
+
+	MonotoneCubicSpline(const std::vector<double> &x, const std::vector<double> &y)
+	{
+		Setup(x, y);
+	}
+
+	void Setup(const std::vector<double> &x, const std::vector<double> &y)
+	{
+		int n = x.size();
+		if (n < 2) throw std::runtime_error("Spline needs at least two knots");
+		if ((int)y.size() != n) throw std::runtime_error("Spline x and y must have the same size");
+		for (int i=1; i<n; i++)
+		{
+			if (!(x[i] > x[i-1])) throw std::runtime_error("Spline knots must be strictly increasing");
+		}
+		X = x;
+		Y = y;
+
+		//Secant slopes
+		std::vector<double> delta(n-1);
+		for (int i=0; i<n-1; i++)
+		{
+			delta[i] = (y[i+1] - y[i]) / (x[i+1] - x[i]);
+		}
+
+		//Initial derivatives, then Fritsch-Carlson limiting
+		Slope.resize(n);
+		Slope[0] = delta[0];
+		Slope[n-1] = delta[n-2];
+		for (int i=1; i<n-1; i++)
+		{
+			Slope[i] = (delta[i-1] * delta[i] <= 0) ? 0 : (delta[i-1] + delta[i]) / 2;
+		}
+		for (int i=0; i<n-1; i++)
+		{
+			if (delta[i] == 0)
+			{
+				Slope[i] = 0;
+				Slope[i+1] = 0;
+				continue;
+			}
+			double alpha = Slope[i] / delta[i];
+			double beta = Slope[i+1] / delta[i];
+			double norm = alpha*alpha + beta*beta;
+			if (norm > 9)
+			{
+				double tau = 3 / std::sqrt(norm);
+				Slope[i] = tau * alpha * delta[i];
+				Slope[i+1] = tau * beta * delta[i];
+			}
+		}
+
+		//Integral from x_0 to each knot
+		Cumulative.resize(n);
+		Cumulative[0] = 0;
+		for (int i=0; i<n-1; i++)
+		{
+			Cumulative[i+1] = Cumulative[i] + IntegrateInterval(i, X[i+1]);
+		}
+	}
+
+	double GetMinX() const { return X.front(); }
+	double GetMaxX() const { return X.back(); }
+
+	double Evaluate(double x) const
+	{
+		if (x <= X.front()) return Y.front();
+		if (x >= X.back()) return Y.back();
+		int i = std::upper_bound(X.begin(), X.end(), x) - X.begin() - 1;
+		return EvaluateInterval(i, x);
+	}
+
+	/*
+	 * Evaluate at the points x (ascending), walking the intervals once
+	 */
+	void Evaluate(const double *x, double *y, int count) const
+	{
+		int i = 0;
+		int n = X.size();
+		for (int k=0; k<count; k++)
+		{
+			if (x[k] <= X.front()) { y[k] = Y.front(); continue; }
+			if (x[k] >= X.back()) { y[k] = Y.back(); continue; }
+			if (k > 0 && x[k] < x[k-1]) i = 0;
+			while (i < n-2 && X[i+1] <= x[k]) i++;
+			y[k] = EvaluateInterval(i, x[k]);
+		}
+	}
+
+	double EvaluateDerivative(double x) const
+	{
+		if (x <= X.front() || x >= X.back()) return 0;
+		int i = std::upper_bound(X.begin(), X.end(), x) - X.begin() - 1;
+		double h = X[i+1] - X[i];
+		double t = (x - X[i]) / h;
+		double t2 = t*t;
+		double dh00 = 6*t2 - 6*t;
+		double dh10 = 3*t2 - 4*t + 1;
+		double dh01 = -6*t2 + 6*t;
+		double dh11 = 3*t2 - 2*t;
+		return (dh00*Y[i] + dh01*Y[i+1]) / h + dh10*Slope[i] + dh11*Slope[i+1];
+	}
+
+	/*
+	 * Integral of the interpolant from x_0 to x
+	 */
+	double Integrate(double x) const
+	{
+		if (x <= X.front()) return (x - X.front()) * Y.front();
+		if (x >= X.back()) return Cumulative.back() + (x - X.back()) * Y.back();
+		int i = std::upper_bound(X.begin(), X.end(), x) - X.begin() - 1;
+		return Cumulative[i] + IntegrateInterval(i, x);
+	}
+
+private:
+	std::vector<double> X;
+	std::vector<double> Y;
+	std::vector<double> Slope;
+	std::vector<double> Cumulative;
+
+	double IntegrateInterval(int i, double x) const
+	{
+		double h = X[i+1] - X[i];
+		double t = (x - X[i]) / h;
+		double t2 = t*t;
+		double t3 = t2*t;
+		double t4 = t3*t;
+		double i00 = t - t3 + t4/2;
+		double i10 = t2/2 - 2*t3/3 + t4/4;
+		double i01 = t3 - t4/2;
+		double i11 = t4/4 - t3/3;
+		return h * (i00*Y[i] + i10*h*Slope[i] + i01*Y[i+1] + i11*h*Slope[i+1]);
+	}
+
+	double EvaluateInterval(int i, double x) const
+	{
+		double h = X[i+1] - X[i];
+		double t = (x - X[i]) / h;
+		double t2 = t*t;
+		double t3 = t2*t;
+		double h00 = 2*t3 - 3*t2 + 1;
+		double h10 = t3 - 2*t2 + t;
+		double h01 = -2*t3 + 3*t2;
+		double h11 = t3 - t2;
+		return h00*Y[i] + h10*h*Slope[i] + h01*Y[i+1] + h11*h*Slope[i+1];
+	}
+};
+
+#endif
@@ -0,0 +1,211 @@
+#include "sphericalbase.h"
+#include "spline.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <map>
+
+/*
+ * Radial potential tabulated in a text file, optionally l-dependent
+ * (e.g. a pseudopotential):
+ *
+ *     # r    V_0(r)   V_1(r)  ...  V_L(r)
+ *     0.01   -12.3    -10.1   ...
+ *
+ * Lines starting with '#' are ignored. Angular momenta l > L use V_L.
+ * Each column is interpolated with a monotone cubic spline. Beyond the last
+ * tabulated r the potential is asymptotic_charge / r if asymptotic_charge
+ * is given (same sign convention as CoulombPotential), and the last
+ * tabulated value otherwise.
+ *
+ * Tables are cached by the hash of the file contents, and the potential
+ * values by (column, radial grid), so potentials sharing a table and a grid
+ * (the propagator, the preconditioner, the eigenstate solver) evaluate the
+ * splines only once.
+ */
+class TabulatedRadialTable
+{
+public:
+	typedef boost::shared_ptr<TabulatedRadialTable> Ptr;
+
+	unsigned long Hash;
+	std::vector<MonotoneCubicSpline> Columns;
+
+	/*
+	 * Load the table in filename, or return the cached table if a file with
+	 * the same contents has been loaded before
+	 */
+	static Ptr Load(const std::string &filename)
+	{
+		std::ifstream file(filename.c_str());
+		if (!file) throw std::runtime_error("Could not open tabulated potential " + filename);
+		std::stringstream contents;
+		contents << file.rdbuf();
+		std::string text = contents.str();
+
+		unsigned long hash = GetHash(text.data(), text.size());
+		std::map<unsigned long, Ptr> &cache = GetCache();
+		if (cache.find(hash) != cache.end()) return cache[hash];
+
+		Ptr table(new TabulatedRadialTable());
+		table->Hash = hash;
+		table->Parse(text, filename);
+		cache[hash] = table;
+		return table;
+	}
+
+	/*
+	 * The values of column at the grid points r
+	 */
+	const std::vector<double>& GetValues(int column, const blitz::Array<double, 1> &r, double asymptoticCharge, bool useAsymptote)
+	{
+		std::vector<double> grid(r.begin(), r.end());
+		unsigned long key = GetHash((const char*)&grid[0], grid.size() * sizeof(double));
+		key = key * 31 + column;
+		if (useAsymptote) key ^= GetHash((const char*)&asymptoticCharge, sizeof(double));
+
+		std::map<unsigned long, std::vector<double> >::iterator cached = Values.find(key);
+		if (cached != Values.end()) return cached->second;
+
+		INSTRUMENT_SCOPE("TabulatedRadialTable::GetValues");
+		const MonotoneCubicSpline &spline = Columns[column];
+		std::vector<double> &values = Values[key];
+		values.resize(grid.size());
+		spline.Evaluate(&grid[0], &values[0], grid.size());
+		if (useAsymptote)
+		{
+			for (size_t i=0; i<grid.size(); i++)
+			{
+				if (grid[i] > spline.GetMaxX()) values[i] = asymptoticCharge / grid[i];
+			}
+		}
+		return values;
+	}
+
+private:
+	std::map<unsigned long, std::vector<double> > Values;
+
+	static std::map<unsigned long, Ptr>& GetCache()
+	{
+		static std::map<unsigned long, Ptr> cache;
+		return cache;
+	}
+
+	//FNV-1a
+	static unsigned long GetHash(const char *data, size_t size)
+	{
+		unsigned long hash = 14695981039346656037ul;
+		for (size_t i=0; i<size; i++)
+		{
+			hash ^= (unsigned char)data[i];
+			hash *= 1099511628211ul;
+		}
+		return hash;
+	}
+
+	void Parse(const std::string &text, const std::string &filename)
+	{
+		std::vector<double> r;
+		std::vector< std::vector<double> > columns;
+
+		std::istringstream lines(text);
+		std::string line;
+		while (std::getline(lines, line))
+		{
+			size_t start = line.find_first_not_of(" \t\r");
+			if (start == std::string::npos || line[start] == '#') continue;
+
+			std::istringstream fields(line);
+			std::vector<double> row;
+			double value;
+			while (fields >> value) row.push_back(value);
+			if (row.size() < 2) throw std::runtime_error("Invalid line in tabulated potential " + filename + ": " + line);
+			if (columns.size() == 0) columns.resize(row.size() - 1);
+			if (row.size() - 1 != columns.size()) throw std::runtime_error("Inconsistent number of columns in tabulated potential " + filename);
+
+			r.push_back(row[0]);
+			for (size_t i=0; i<columns.size(); i++) columns[i].push_back(row[i+1]);
+		}
+		if (r.size() < 2) throw std::runtime_error("Tabulated potential " + filename + " has less than two points");
+
+		Columns.resize(columns.size());
+		for (size_t i=0; i<columns.size(); i++)
+		{
+			Columns[i].Setup(r, columns[i]);
+		}
+	}
+};
+
+
+template<int Rank>
+class CustomPotential_TabulatedRadial : public CustomPotentialSphericalBase<Rank>
+{
+public:
+	typedef blitz::Array<int, 2> BasisPairList;
+
+	std::string FileName;
+	double AsymptoticCharge;
+	bool UseAsymptote;
+
+	CustomPotential_TabulatedRadial() : AsymptoticCharge(0), UseAsymptote(false) {}
+	virtual ~CustomPotential_TabulatedRadial() {}
+
+	virtual void ApplyConfigSection(const ConfigSection &config)
+	{
+		CustomPotentialSphericalBase<Rank>::ApplyConfigSection(config);
+		config.Get("filename", FileName);
+		UseAsymptote = config.HasValue("asymptotic_charge");
+		if (UseAsymptote)
+		{
+			config.Get("asymptotic_charge", AsymptoticCharge);
+		}
+		Table = TabulatedRadialTable::Load(FileName);
+	}
+
+	virtual void UpdatePotentialData(typename blitz::Array<cplx, Rank> data, typename Wavefunction<Rank>::Ptr psi, cplx timeStep, double curTime)
+	{
+		INSTRUMENT_SCOPE("CustomPotential_TabulatedRadial::UpdatePotentialData");
+		INSTRUMENT_BYTES("CustomPotential_TabulatedRadial::UpdatePotentialData", data.size() * sizeof(cplx));
+
+		typedef CombinedRepresentation<Rank> CmbRepr;
+		typename CmbRepr::Ptr repr = boost::static_pointer_cast< CmbRepr >(psi->GetRepresentation());
+		SphericalHarmonicBasisRepresentation::Ptr angRepr = boost::static_pointer_cast< SphericalHarmonicBasisRepresentation >(repr->GetRepresentation(this->AngularRank));
+
+		int rCount = data.extent(this->RadialRank);
+		int angCount = data.extent(this->AngularRank);
+
+		blitz::Array<double, 1> localr = psi->GetRepresentation()->GetLocalGrid(this->RadialRank);
+		BasisPairList angBasisPairs = GetBasisPairList(this->AngularRank);
+
+		if (localr.size() != rCount) throw std::runtime_error("Invalid r size");
+		if (angCount != angBasisPairs.extent(0)) throw std::runtime_error("Invalid ang size");
+
+		data = 0;
+		blitz::TinyVector<int, Rank> index;
+		int columnCount = Table->Columns.size();
+
+		for (int angIndex=0; angIndex<angCount; angIndex++)
+		{
+			index(this->AngularRank) = angIndex;
+
+			LmIndex left = angRepr->Range.GetLmIndex(angBasisPairs(angIndex, 0));
+			LmIndex right = angRepr->Range.GetLmIndex(angBasisPairs(angIndex, 1));
+			if (!((left.l == right.l) && (left.m == right.m)))
+			{
+				continue;
+			}
+
+			int column = std::min(left.l, columnCount - 1);
+			const std::vector<double> &values = Table->GetValues(column, localr, AsymptoticCharge, UseAsymptote);
+			for (int ri=0; ri<rCount; ri++)
+			{
+				index(this->RadialRank) = ri;
+				data(index) = values[ri];
+			}
+		}
+	}
+
+private:
+	TabulatedRadialTable::Ptr Table;
+};
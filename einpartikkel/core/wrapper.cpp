@@ -5,12 +5,17 @@
 
 // Includes ====================================================================
 #include <diatomicpotential.cpp>
+#include <instrumentation.h>
+#include <laserpulse.cpp>
+#include <memoryplacement.h>
+#include <nondipole.cpp>
 #include <potential.cpp>
 #include <spherical.cpp>
 #include <sphericallength.cpp>
 #include <sphericalvelocity.cpp>
 #include <sphericalvelocity_x.cpp>
 #include <sphericalvelocity_y.cpp>
+#include <tabulatedpotential.cpp>
 
 // Using =======================================================================
 using namespace boost::python;
@@ -438,6 +443,183 @@ struct DiatomicCoulombPotential_2_Wrapper: DiatomicCoulombPotential<2>
     PyObject* py_self;
 };
 
+struct CustomPotential_TabulatedRadial_2_Wrapper: CustomPotential_TabulatedRadial<2>
+{
+    CustomPotential_TabulatedRadial_2_Wrapper(PyObject* py_self_, const CustomPotential_TabulatedRadial<2>& p0):
+        CustomPotential_TabulatedRadial<2>(p0), py_self(py_self_) {}
+
+    CustomPotential_TabulatedRadial_2_Wrapper(PyObject* py_self_):
+        CustomPotential_TabulatedRadial<2>(), py_self(py_self_) {}
+
+    void ApplyConfigSection(const ConfigSection& p0) {
+        call_method< void >(py_self, "ApplyConfigSection", p0);
+    }
+
+    void default_ApplyConfigSection(const ConfigSection& p0) {
+        CustomPotential_TabulatedRadial<2>::ApplyConfigSection(p0);
+    }
+
+    void UpdatePotentialData(blitz::Array<std::complex<double>,2> p0, boost::shared_ptr<Wavefunction<2> > p1, std::complex<double> p2, double p3) {
+        call_method< void >(py_self, "UpdatePotentialData", p0, p1, p2, p3);
+    }
+
+    void default_UpdatePotentialData(blitz::Array<std::complex<double>,2> p0, boost::shared_ptr<Wavefunction<2> > p1, std::complex<double> p2, double p3) {
+        CustomPotential_TabulatedRadial<2>::UpdatePotentialData(p0, p1, p2, p3);
+    }
+
+    void SetBasisPairs(int p0, const blitz::Array<int,2>& p1) {
+        call_method< void >(py_self, "SetBasisPairs", p0, p1);
+    }
+
+    void default_SetBasisPairs(int p0, const blitz::Array<int,2>& p1) {
+        CustomPotentialSphericalBase<2>::SetBasisPairs(p0, p1);
+    }
+
+    blitz::Array<int,2> GetBasisPairList(int p0) {
+        return call_method< blitz::Array<int,2> >(py_self, "GetBasisPairList", p0);
+    }
+
+    blitz::Array<int,2> default_GetBasisPairList(int p0) {
+        return CustomPotentialSphericalBase<2>::GetBasisPairList(p0);
+    }
+
+    PyObject* py_self;
+};
+
+struct CustomPotential_NonDipole_2_Wrapper: CustomPotential_NonDipole<2>
+{
+    CustomPotential_NonDipole_2_Wrapper(PyObject* py_self_, const CustomPotential_NonDipole<2>& p0):
+        CustomPotential_NonDipole<2>(p0), py_self(py_self_) {}
+
+    CustomPotential_NonDipole_2_Wrapper(PyObject* py_self_):
+        CustomPotential_NonDipole<2>(), py_self(py_self_) {}
+
+    void ApplyConfigSection(const ConfigSection& p0) {
+        call_method< void >(py_self, "ApplyConfigSection", p0);
+    }
+
+    void default_ApplyConfigSection(const ConfigSection& p0) {
+        CustomPotential_NonDipole<2>::ApplyConfigSection(p0);
+    }
+
+    void UpdatePotentialData(blitz::Array<std::complex<double>,2> p0, boost::shared_ptr<Wavefunction<2> > p1, std::complex<double> p2, double p3) {
+        call_method< void >(py_self, "UpdatePotentialData", p0, p1, p2, p3);
+    }
+
+    void default_UpdatePotentialData(blitz::Array<std::complex<double>,2> p0, boost::shared_ptr<Wavefunction<2> > p1, std::complex<double> p2, double p3) {
+        CustomPotential_NonDipole<2>::UpdatePotentialData(p0, p1, p2, p3);
+    }
+
+    void SetBasisPairs(int p0, const blitz::Array<int,2>& p1) {
+        call_method< void >(py_self, "SetBasisPairs", p0, p1);
+    }
+
+    void default_SetBasisPairs(int p0, const blitz::Array<int,2>& p1) {
+        CustomPotentialSphericalBase<2>::SetBasisPairs(p0, p1);
+    }
+
+    blitz::Array<int,2> GetBasisPairList(int p0) {
+        return call_method< blitz::Array<int,2> >(py_self, "GetBasisPairList", p0);
+    }
+
+    blitz::Array<int,2> default_GetBasisPairList(int p0) {
+        return CustomPotentialSphericalBase<2>::GetBasisPairList(p0);
+    }
+
+    PyObject* py_self;
+};
+
+struct CustomPotential_NonDipoleVelocity_2_Wrapper: CustomPotential_NonDipoleVelocity<2>
+{
+    CustomPotential_NonDipoleVelocity_2_Wrapper(PyObject* py_self_, const CustomPotential_NonDipoleVelocity<2>& p0):
+        CustomPotential_NonDipoleVelocity<2>(p0), py_self(py_self_) {}
+
+    CustomPotential_NonDipoleVelocity_2_Wrapper(PyObject* py_self_):
+        CustomPotential_NonDipoleVelocity<2>(), py_self(py_self_) {}
+
+    void ApplyConfigSection(const ConfigSection& p0) {
+        call_method< void >(py_self, "ApplyConfigSection", p0);
+    }
+
+    void default_ApplyConfigSection(const ConfigSection& p0) {
+        CustomPotential_NonDipoleVelocityBase<2>::ApplyConfigSection(p0);
+    }
+
+    void UpdatePotentialData(blitz::Array<std::complex<double>,2> p0, boost::shared_ptr<Wavefunction<2> > p1, std::complex<double> p2, double p3) {
+        call_method< void >(py_self, "UpdatePotentialData", p0, p1, p2, p3);
+    }
+
+    void default_UpdatePotentialData(blitz::Array<std::complex<double>,2> p0, boost::shared_ptr<Wavefunction<2> > p1, std::complex<double> p2, double p3) {
+        CustomPotential_NonDipoleVelocityBase<2>::UpdatePotentialData(p0, p1, p2, p3);
+    }
+
+    void SetBasisPairs(int p0, const blitz::Array<int,2>& p1) {
+        call_method< void >(py_self, "SetBasisPairs", p0, p1);
+    }
+
+    void default_SetBasisPairs(int p0, const blitz::Array<int,2>& p1) {
+        CustomPotentialSphericalBase<2>::SetBasisPairs(p0, p1);
+    }
+
+    blitz::Array<int,2> GetBasisPairList(int p0) {
+        return call_method< blitz::Array<int,2> >(py_self, "GetBasisPairList", p0);
+    }
+
+    blitz::Array<int,2> default_GetBasisPairList(int p0) {
+        return CustomPotentialSphericalBase<2>::GetBasisPairList(p0);
+    }
+
+    PyObject* py_self;
+};
+
+struct CustomPotential_NonDipoleVelocityDerivativeR_2_Wrapper: CustomPotential_NonDipoleVelocityDerivativeR<2>
+{
+    CustomPotential_NonDipoleVelocityDerivativeR_2_Wrapper(PyObject* py_self_, const CustomPotential_NonDipoleVelocityDerivativeR<2>& p0):
+        CustomPotential_NonDipoleVelocityDerivativeR<2>(p0), py_self(py_self_) {}
+
+    CustomPotential_NonDipoleVelocityDerivativeR_2_Wrapper(PyObject* py_self_):
+        CustomPotential_NonDipoleVelocityDerivativeR<2>(), py_self(py_self_) {}
+
+    void ApplyConfigSection(const ConfigSection& p0) {
+        call_method< void >(py_self, "ApplyConfigSection", p0);
+    }
+
+    void default_ApplyConfigSection(const ConfigSection& p0) {
+        CustomPotential_NonDipoleVelocityBase<2>::ApplyConfigSection(p0);
+    }
+
+    void UpdatePotentialData(blitz::Array<std::complex<double>,2> p0, boost::shared_ptr<Wavefunction<2> > p1, std::complex<double> p2, double p3) {
+        call_method< void >(py_self, "UpdatePotentialData", p0, p1, p2, p3);
+    }
+
+    void default_UpdatePotentialData(blitz::Array<std::complex<double>,2> p0, boost::shared_ptr<Wavefunction<2> > p1, std::complex<double> p2, double p3) {
+        CustomPotential_NonDipoleVelocityBase<2>::UpdatePotentialData(p0, p1, p2, p3);
+    }
+
+    void SetBasisPairs(int p0, const blitz::Array<int,2>& p1) {
+        call_method< void >(py_self, "SetBasisPairs", p0, p1);
+    }
+
+    void default_SetBasisPairs(int p0, const blitz::Array<int,2>& p1) {
+        CustomPotentialSphericalBase<2>::SetBasisPairs(p0, p1);
+    }
+
+    blitz::Array<int,2> GetBasisPairList(int p0) {
+        return call_method< blitz::Array<int,2> >(py_self, "GetBasisPairList", p0);
+    }
+
+    blitz::Array<int,2> default_GetBasisPairList(int p0) {
+        return CustomPotentialSphericalBase<2>::GetBasisPairList(p0);
+    }
+
+    PyObject* py_self;
+};
+
+
+double LaserPulse_TimeFunction(const LaserPulse &pulse, object conf, double t)
+{
+    return pulse.Evaluate(t);
+}
 
 }// namespace 
 
@@ -638,5 +820,78 @@ void Export_wrapper()
         .staticmethod("CondonShortleyPhase")
     ;
 
+    class_< CustomPotential_TabulatedRadial<2>, CustomPotential_TabulatedRadial_2_Wrapper >("CustomPotential_TabulatedRadial_2", init<  >())
+        .def(init< const CustomPotential_TabulatedRadial<2>& >())
+        .def_readwrite("FileName", &CustomPotential_TabulatedRadial<2>::FileName)
+        .def_readwrite("AsymptoticCharge", &CustomPotential_TabulatedRadial<2>::AsymptoticCharge)
+        .def_readwrite("UseAsymptote", &CustomPotential_TabulatedRadial<2>::UseAsymptote)
+        .def("ApplyConfigSection", (void (CustomPotential_TabulatedRadial<2>::*)(const ConfigSection&) )&CustomPotential_TabulatedRadial<2>::ApplyConfigSection, (void (CustomPotential_TabulatedRadial_2_Wrapper::*)(const ConfigSection&))&CustomPotential_TabulatedRadial_2_Wrapper::default_ApplyConfigSection)
+        .def("UpdatePotentialData", (void (CustomPotential_TabulatedRadial<2>::*)(blitz::Array<std::complex<double>,2>, boost::shared_ptr<Wavefunction<2> >, std::complex<double>, double) )&CustomPotential_TabulatedRadial<2>::UpdatePotentialData, (void (CustomPotential_TabulatedRadial_2_Wrapper::*)(blitz::Array<std::complex<double>,2>, boost::shared_ptr<Wavefunction<2> >, std::complex<double>, double))&CustomPotential_TabulatedRadial_2_Wrapper::default_UpdatePotentialData)
+        .def("SetBasisPairs", (void (CustomPotentialSphericalBase<2>::*)(int, const blitz::Array<int,2>&) )&CustomPotentialSphericalBase<2>::SetBasisPairs, (void (CustomPotential_TabulatedRadial_2_Wrapper::*)(int, const blitz::Array<int,2>&))&CustomPotential_TabulatedRadial_2_Wrapper::default_SetBasisPairs)
+        .def("GetBasisPairList", (blitz::Array<int,2> (CustomPotentialSphericalBase<2>::*)(int) )&CustomPotentialSphericalBase<2>::GetBasisPairList, (blitz::Array<int,2> (CustomPotential_TabulatedRadial_2_Wrapper::*)(int))&CustomPotential_TabulatedRadial_2_Wrapper::default_GetBasisPairList)
+    ;
+
+    class_< CustomPotential_NonDipole<2>, CustomPotential_NonDipole_2_Wrapper >("CustomPotential_NonDipole_2", init<  >())
+        .def(init< const CustomPotential_NonDipole<2>& >())
+        .def_readwrite("WaveNumber", &CustomPotential_NonDipole<2>::WaveNumber)
+        .def_readwrite("ThetaK", &CustomPotential_NonDipole<2>::ThetaK)
+        .def_readwrite("PhiK", &CustomPotential_NonDipole<2>::PhiK)
+        .def_readwrite("Tolerance", &CustomPotential_NonDipole<2>::Tolerance)
+        .def_readwrite("MaxMultipole", &CustomPotential_NonDipole<2>::MaxMultipole)
+        .def_readwrite("Part", &CustomPotential_NonDipole<2>::Part)
+        .def("ApplyConfigSection", (void (CustomPotential_NonDipole<2>::*)(const ConfigSection&) )&CustomPotential_NonDipole<2>::ApplyConfigSection, (void (CustomPotential_NonDipole_2_Wrapper::*)(const ConfigSection&))&CustomPotential_NonDipole_2_Wrapper::default_ApplyConfigSection)
+        .def("UpdatePotentialData", (void (CustomPotential_NonDipole<2>::*)(blitz::Array<std::complex<double>,2>, boost::shared_ptr<Wavefunction<2> >, std::complex<double>, double) )&CustomPotential_NonDipole<2>::UpdatePotentialData, (void (CustomPotential_NonDipole_2_Wrapper::*)(blitz::Array<std::complex<double>,2>, boost::shared_ptr<Wavefunction<2> >, std::complex<double>, double))&CustomPotential_NonDipole_2_Wrapper::default_UpdatePotentialData)
+        .def("SetBasisPairs", (void (CustomPotentialSphericalBase<2>::*)(int, const blitz::Array<int,2>&) )&CustomPotentialSphericalBase<2>::SetBasisPairs, (void (CustomPotential_NonDipole_2_Wrapper::*)(int, const blitz::Array<int,2>&))&CustomPotential_NonDipole_2_Wrapper::default_SetBasisPairs)
+        .def("GetBasisPairList", (blitz::Array<int,2> (CustomPotentialSphericalBase<2>::*)(int) )&CustomPotentialSphericalBase<2>::GetBasisPairList, (blitz::Array<int,2> (CustomPotential_NonDipole_2_Wrapper::*)(int))&CustomPotential_NonDipole_2_Wrapper::default_GetBasisPairList)
+    ;
+
+    class_< CustomPotential_NonDipoleVelocity<2>, CustomPotential_NonDipoleVelocity_2_Wrapper >("CustomPotential_NonDipoleVelocity_2", init<  >())
+        .def(init< const CustomPotential_NonDipoleVelocity<2>& >())
+        .def_readwrite("ThetaK", &CustomPotential_NonDipoleVelocityBase<2>::ThetaK)
+        .def_readwrite("PhiK", &CustomPotential_NonDipoleVelocityBase<2>::PhiK)
+        .def_readwrite("ThetaE", &CustomPotential_NonDipoleVelocityBase<2>::ThetaE)
+        .def_readwrite("PhiE", &CustomPotential_NonDipoleVelocityBase<2>::PhiE)
+        .def_readwrite("Charge", &CustomPotential_NonDipoleVelocityBase<2>::Charge)
+        .def("ApplyConfigSection", (void (CustomPotential_NonDipoleVelocityBase<2>::*)(const ConfigSection&) )&CustomPotential_NonDipoleVelocityBase<2>::ApplyConfigSection, (void (CustomPotential_NonDipoleVelocity_2_Wrapper::*)(const ConfigSection&))&CustomPotential_NonDipoleVelocity_2_Wrapper::default_ApplyConfigSection)
+        .def("UpdatePotentialData", (void (CustomPotential_NonDipoleVelocityBase<2>::*)(blitz::Array<std::complex<double>,2>, boost::shared_ptr<Wavefunction<2> >, std::complex<double>, double) )&CustomPotential_NonDipoleVelocityBase<2>::UpdatePotentialData, (void (CustomPotential_NonDipoleVelocity_2_Wrapper::*)(blitz::Array<std::complex<double>,2>, boost::shared_ptr<Wavefunction<2> >, std::complex<double>, double))&CustomPotential_NonDipoleVelocity_2_Wrapper::default_UpdatePotentialData)
+        .def("SetBasisPairs", (void (CustomPotentialSphericalBase<2>::*)(int, const blitz::Array<int,2>&) )&CustomPotentialSphericalBase<2>::SetBasisPairs, (void (CustomPotential_NonDipoleVelocity_2_Wrapper::*)(int, const blitz::Array<int,2>&))&CustomPotential_NonDipoleVelocity_2_Wrapper::default_SetBasisPairs)
+        .def("GetBasisPairList", (blitz::Array<int,2> (CustomPotentialSphericalBase<2>::*)(int) )&CustomPotentialSphericalBase<2>::GetBasisPairList, (blitz::Array<int,2> (CustomPotential_NonDipoleVelocity_2_Wrapper::*)(int))&CustomPotential_NonDipoleVelocity_2_Wrapper::default_GetBasisPairList)
+    ;
+
+    class_< CustomPotential_NonDipoleVelocityDerivativeR<2>, CustomPotential_NonDipoleVelocityDerivativeR_2_Wrapper >("CustomPotential_NonDipoleVelocityDerivativeR_2", init<  >())
+        .def(init< const CustomPotential_NonDipoleVelocityDerivativeR<2>& >())
+        .def_readwrite("ThetaK", &CustomPotential_NonDipoleVelocityBase<2>::ThetaK)
+        .def_readwrite("PhiK", &CustomPotential_NonDipoleVelocityBase<2>::PhiK)
+        .def_readwrite("ThetaE", &CustomPotential_NonDipoleVelocityBase<2>::ThetaE)
+        .def_readwrite("PhiE", &CustomPotential_NonDipoleVelocityBase<2>::PhiE)
+        .def_readwrite("Charge", &CustomPotential_NonDipoleVelocityBase<2>::Charge)
+        .def("ApplyConfigSection", (void (CustomPotential_NonDipoleVelocityBase<2>::*)(const ConfigSection&) )&CustomPotential_NonDipoleVelocityBase<2>::ApplyConfigSection, (void (CustomPotential_NonDipoleVelocityDerivativeR_2_Wrapper::*)(const ConfigSection&))&CustomPotential_NonDipoleVelocityDerivativeR_2_Wrapper::default_ApplyConfigSection)
+        .def("UpdatePotentialData", (void (CustomPotential_NonDipoleVelocityBase<2>::*)(blitz::Array<std::complex<double>,2>, boost::shared_ptr<Wavefunction<2> >, std::complex<double>, double) )&CustomPotential_NonDipoleVelocityBase<2>::UpdatePotentialData, (void (CustomPotential_NonDipoleVelocityDerivativeR_2_Wrapper::*)(blitz::Array<std::complex<double>,2>, boost::shared_ptr<Wavefunction<2> >, std::complex<double>, double))&CustomPotential_NonDipoleVelocityDerivativeR_2_Wrapper::default_UpdatePotentialData)
+        .def("SetBasisPairs", (void (CustomPotentialSphericalBase<2>::*)(int, const blitz::Array<int,2>&) )&CustomPotentialSphericalBase<2>::SetBasisPairs, (void (CustomPotential_NonDipoleVelocityDerivativeR_2_Wrapper::*)(int, const blitz::Array<int,2>&))&CustomPotential_NonDipoleVelocityDerivativeR_2_Wrapper::default_SetBasisPairs)
+        .def("GetBasisPairList", (blitz::Array<int,2> (CustomPotentialSphericalBase<2>::*)(int) )&CustomPotentialSphericalBase<2>::GetBasisPairList, (blitz::Array<int,2> (CustomPotential_NonDipoleVelocityDerivativeR_2_Wrapper::*)(int))&CustomPotential_NonDipoleVelocityDerivativeR_2_Wrapper::default_GetBasisPairList)
+    ;
+
+    class_< LaserPulse >("LaserPulse", init<  >())
+        .def(init< const LaserPulse& >())
+        .def("AddComponent", &LaserPulse::AddComponent)
+        .def("AddSampledComponent", &LaserPulse::AddSampledComponent)
+        .def("SetGauge", &LaserPulse::SetGauge)
+        .def("GetComponentCount", &LaserPulse::GetComponentCount)
+        .def("GetVectorPotential", &LaserPulse::GetVectorPotential)
+        .def("GetField", &LaserPulse::GetField)
+        .def("Evaluate", &LaserPulse::Evaluate)
+        .def("EvaluateArray", &LaserPulse::EvaluateArray)
+        .def("__call__", &LaserPulse_TimeFunction)
+    ;
+
+    def("GetInstrumentationReport", GetInstrumentationReport);
+    def("ResetInstrumentation", ResetInstrumentation);
+    def("IsInstrumentationEnabled", IsInstrumentationEnabled);
+    def("IsPerfCountersAvailable", IsPerfCountersAvailable);
+    def("PlaceArrayMemory", PlaceArrayMemory<std::complex<double>, 2>);
+    def("GetArrayNodeCounts", GetArrayNodeCounts<std::complex<double>, 2>);
+    def("GetNumaNodeCount", GetNumaNodeCount);
+    def("IsMemoryPlacementAvailable", IsMemoryPlacementAvailable);
+    def("IsFirstTouchPlacementAvailable", IsFirstTouchPlacementAvailable);
 }
 
@@ -1 +1 @@
-__all__ = ["eigenvalues", "eigenvalues_iter"]
+__all__ = ["eigenvalues", "eigenvalues_iter", "hydrogenic", "complexscaling", "floquet", "gridtuner"]
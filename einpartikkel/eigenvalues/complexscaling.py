@@ -0,0 +1,195 @@
+"""
+complexscaling
+==============
+
+Resonance positions and widths (Stark resonances in a static field,
+autoionising states) from the complex scaled Hamiltonian, instead of
+propagating in time and fitting the norm decay.
+
+Under uniform complex scaling r -> r exp(i theta), a potential which is
+homogeneous of degree n in r (kinetic and centrifugal energy n = -2,
+Coulomb n = -1, the static field F z, n = 1) is multiplied by
+exp(i n theta). Resonances appear as isolated eigenvalues
+
+	E = E_r - i Gamma / 2
+
+of the complex symmetric generalised problem H(theta) c = E S c, which
+are independent of theta, while the continua are rotated by -2 theta.
+
+The scaling is applied to the matrices of the ordinary potentials, so it
+is exact for dilation analytic potentials (Coulomb, centrifugal, static
+field). Potentials with short range parts that are not homogeneous
+(e.g. SAE model potentials) should be given the degree of their leading
+term, and the result checked for theta stability with TrackResonances.
+
+The coupled (l, radial) system is assembled as a sparse matrix from the
+tensor potentials, using their angular basis pairs, so the l -> l +- 1
+blocks of CustomPotential_LaserLength_Z enter directly. Eigenvalues near
+a target energy are found by shift-invert Arnoldi on a sparse LU
+factorisation of H - target S.
+
+Example
+-------
+>>> potentials = [("RadialKineticEnergy", -2), ("AngularKineticEnergy", -2),
+...	("CoulombPotential", -1), ("LaserPotentialLengthZ", 1, 0.05)]
+>>> E, Gamma = FindResonances(prop, potentials, theta=0.3, targetEnergy=-0.5)
+
+"""
+from numpy import exp, array, argsort, abs, imag, real, \
+	concatenate, complex
+import scipy.sparse
+import scipy.sparse.linalg
+import pyprop
+from pyprop.pyproplogging import GetFunctionLogger
+from ..utils import RegisterAll
+from ..core.layout import GetAngularRank, GetAngularMajorData, GetAngularMajorPotentialData, \
+	GetAngularBasisPairs, GetRadialBasisPairs
+
+
+def GeneratePotential(prop, potential):
+	if isinstance(potential, pyprop.TensorPotential):
+		return potential
+	if isinstance(potential, str):
+		potential = prop.Config.GetSection(potential)
+	potential = prop.Propagator.BasePropagator.GeneratePotential(potential)
+	potential.SetupStep(0.)
+	return potential
+
+
+@RegisterAll
+def SetupCoupledMatrix(prop, potentials):
+	"""
+	Assemble the sum of potentials over the full (angular, radial) space
+	as a sparse matrix, index angularIndex * radialCount + radialIndex.
+
+	potentials is a list of (potential, factor), where potential is a
+	TensorPotential or a config section (or section name). Potentials
+	storing only the upper radial triangle are mirrored (complex
+	symmetric, no conjugation). The index is angular-major for either
+	wavefunction layout.
+	"""
+	angularRank = GetAngularRank(prop.psi)
+	angularCount, radialCount = GetAngularMajorData(prop.psi).shape
+	size = angularCount * radialCount
+
+	rows = []
+	cols = []
+	values = []
+	for potential, factor in potentials:
+		potential = GeneratePotential(prop, potential)
+		angularPairs = GetAngularBasisPairs(potential, angularRank)
+		radialPairs = GetRadialBasisPairs(potential, angularRank)
+		data = factor * GetAngularMajorPotentialData(potential, angularRank)
+
+		#Potentials diagonal in angular indices (e.g. the overlap) may
+		#have fewer angular pairs than the wavefunction
+		if angularPairs.shape[0] == 1 and angularCount > 1:
+			angularPairs = array([(i, i) for i in range(angularCount)])
+			data = data[[0] * angularCount, :]
+
+		row = (angularPairs[:, 0][:, None] * radialCount + radialPairs[:, 0][None, :]).ravel()
+		col = (angularPairs[:, 1][:, None] * radialCount + radialPairs[:, 1][None, :]).ravel()
+		value = data.ravel()
+		rows.append(row)
+		cols.append(col)
+		values.append(value)
+
+		if not (radialPairs[:, 0] > radialPairs[:, 1]).any():
+			strictlyUpper = (radialPairs[:, 0] < radialPairs[:, 1])[None, :].repeat(angularPairs.shape[0], axis=0).ravel()
+			rows.append(col[strictlyUpper])
+			cols.append(row[strictlyUpper])
+			values.append(value[strictlyUpper])
+
+	matrix = scipy.sparse.coo_matrix((concatenate(values), (concatenate(rows), concatenate(cols))), \
+		shape=(size, size), dtype=complex)
+	return matrix.tocsc()
+
+
+@RegisterAll
+def SetupComplexScaledMatrices(prop, potentials, theta):
+	"""
+	H(theta), S as sparse matrices
+
+	Parametres
+	----------
+	prop:       (pyprop.Problem) the problem
+	potentials: (list) tuples (potential, degree) or (potential, degree,
+	            factor), potential being a TensorPotential or config
+	            section (name), and degree the homogeneity degree in r
+	theta:      (float) complex scaling angle
+	"""
+	scaledPotentials = []
+	for item in potentials:
+		potential, degree = item[:2]
+		factor = item[2] if len(item) > 2 else 1.0
+		scaledPotentials.append((potential, factor * exp(1.0j * degree * theta)))
+
+	H = SetupCoupledMatrix(prop, scaledPotentials)
+	S = SetupCoupledMatrix(prop, [(prop.Config.OverlapPotential, 1.0)])
+	return H, S
+
+
+@RegisterAll
+def GetShiftInvertEigenvalues(H, S, targetEnergy, count=6, tolerance=0):
+	"""
+	The count eigenvalues (and vectors) of H c = E S c closest to
+	targetEnergy, by Arnoldi iteration on (H - target S)^-1 S
+	"""
+	logger = GetFunctionLogger()
+	logger.info("Factorizing H - %s S (size %i, %i nonzeros)" % (targetEnergy, H.shape[0], H.nnz))
+	lu = scipy.sparse.linalg.splu((H - targetEnergy * S).tocsc())
+	operator = scipy.sparse.linalg.LinearOperator(H.shape, \
+		matvec=lambda x: lu.solve(S * x), dtype=complex)
+
+	shiftedE, V = scipy.sparse.linalg.eigs(operator, k=count, tol=tolerance)
+	E = targetEnergy + 1.0 / shiftedE
+	idx = argsort(abs(E - targetEnergy))
+	return E[idx], V[:, idx]
+
+
+@RegisterAll
+def FindResonances(prop, potentials, theta, targetEnergy, count=6):
+	"""
+	E, Gamma = FindResonances(prop, potentials, theta, targetEnergy, count)
+
+	Complex scaled eigenvalues closest to targetEnergy, as positions
+	E = Re(E) and widths Gamma = -2 Im(E). See SetupComplexScaledMatrices
+	for the potentials argument.
+	"""
+	if not pyprop.IsSingleProc():
+		raise Exception("Works only on a single processor")
+
+	H, S = SetupComplexScaledMatrices(prop, potentials, theta)
+	E, V = GetShiftInvertEigenvalues(H, S, targetEnergy, count)
+	return real(E), -2 * imag(E)
+
+
+@RegisterAll
+def TrackResonances(prop, potentials, thetaList, targetEnergy, count=6):
+	"""
+	E, Gamma, drift = TrackResonances(prop, potentials, thetaList, targetEnergy, count)
+
+	Follow the eigenvalues found at thetaList[0] through the other scaling
+	angles, matching nearest eigenvalues. True resonances do not move with
+	theta, so the drift (largest change of the complex eigenvalue along the
+	trajectory) separates them from the rotated continuum. The result is
+	sorted by drift, with E and Gamma taken at the last angle.
+	"""
+	if not pyprop.IsSingleProc():
+		raise Exception("Works only on a single processor")
+
+	trajectories = None
+	for theta in thetaList:
+		H, S = SetupComplexScaledMatrices(prop, potentials, theta)
+		E, V = GetShiftInvertEigenvalues(H, S, targetEnergy, count)
+		if trajectories == None:
+			trajectories = [[e] for e in E]
+			continue
+		for trajectory in trajectories:
+			trajectory.append(E[argsort(abs(E - trajectory[-1]))[0]])
+
+	trajectories = array(trajectories)
+	drift = abs(trajectories - trajectories[:, :1]).max(axis=1)
+	idx = argsort(drift)
+	E = trajectories[idx, -1]
+	return real(E), -2 * imag(E), drift[idx]
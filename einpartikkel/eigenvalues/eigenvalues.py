@@ -1,11 +1,16 @@
-from numpy import real, array, double, argsort, zeros, arctan2, exp, \
-	conj, dot, sqrt, imag
+from numpy import real, array, double, argsort, zeros, arctan2, exp, ones, arange, \
+	conj, dot, sqrt, imag, asarray, atleast_1d, copysign, where, maximum, linspace, \
+	isscalar
 import scipy
 import scipy.linalg
 
 import pyprop
 
 from ..utils import RegisterAll
+from ..memoryledger import GetMemoryLedger
+from ..core.overlap import InvalidateOverlap
+from ..core.layout import GetAngularRank, GetAngularRepresentation, GetRadialRepresentation, \
+	GetAngularMajorData, GetAngularMajorPotentialData, GetAngularBasisPairs, GetRadialBasisPairs
 
 @RegisterAll
 def SetupRadialEigenstates(prop, potentialIndices=[0], mList = [0]):
@@ -32,8 +37,8 @@ def SetupRadialEigenstates(prop, potentialIndices=[0], mList = [0]):
 	myTimers["Setup overlap matrix"].Stop()
 
 	#Get phase stuff
-	bspl = prop.psi.GetRepresentation().GetRepresentation(1).GetBSplineObject()
-	angRepr = prop.psi.GetRepresentation().GetRepresentation(0)
+	bspl = GetRadialRepresentation(prop.psi).GetBSplineObject()
+	angRepr = GetAngularRepresentation(prop.psi)
 	phaseGrid = array((0, bspl.GetBreakpointSequence()[1]), dtype=double)
 	phaseBuffer = zeros(2, dtype=complex)
 
@@ -42,7 +47,7 @@ def SetupRadialEigenstates(prop, potentialIndices=[0], mList = [0]):
 	angIdxList = []
 	lmIdxList = []
 
-	lmCount = prop.psi.GetData().shape[0]
+	lmCount = GetAngularMajorData(prop.psi).shape[0]
 
 	for angIdx in range(lmCount):
 		lmIdx = angRepr.Range.GetLmIndex(angIdx)
@@ -65,6 +70,7 @@ def SetupRadialEigenstates(prop, potentialIndices=[0], mList = [0]):
 		sNorm = lambda v: sqrt(abs(sum(conj(v) * dot(S, v))))
 		V = array([v/sNorm(v) for v in [V[:,idx[i]] for i in range(V.shape[1])]]).transpose()
 		eigenVectors.append(V)
+		GetMemoryLedger().RegisterArrays("Eigenpairs", "Radial eigenpairs l=%i" % lmIdx.l, [E, V], owner=V)
 
 		#assure correct phase convention (first oscillation should start out real positive)
 		for i, curE in enumerate(E):
@@ -88,14 +94,15 @@ def SetRadialEigenstate(psi, eigenVectors, angIdxList, quantumNumbers, sourceSca
 
 	"""
 	lmIdx = quantumNumbers.GetLmIndex()
-	angIdx = psi.GetRepresentation().GetRepresentation(0).Range.GetGridIndex(lmIdx)
+	angIdx = GetAngularRepresentation(psi).Range.GetGridIndex(lmIdx)
 	if not angIdx in angIdxList:
 		raise Exception("That eigenstate is not included in 'eigenVectors!")
 	radialIndex = quantumNumbers.GetRadialIndex()
 	eigAngIdx = angIdxList.index(angIdx)
 	vec = eigenVectors[eigAngIdx][:, radialIndex]
 	psi.GetData()[:] *= sourceScaling
-	psi.GetData()[angIdx, :] += destScaling * vec
+	GetAngularMajorData(psi)[angIdx, :] += destScaling * vec
+	InvalidateOverlap(psi)
 
 
 def SetupRadialMatrix(prop, whichPotentials, angularIndex):
@@ -103,7 +110,8 @@ def SetupRadialMatrix(prop, whichPotentials, angularIndex):
 
 	"""
 
-	matrixSize = prop.psi.GetData().shape[1]
+	angularRank = GetAngularRank(prop.psi)
+	matrixSize = GetAngularMajorData(prop.psi).shape[1]
 	matrix = zeros((matrixSize, matrixSize), dtype=double)
 
 	for potNum in whichPotentials:	
@@ -113,19 +121,20 @@ def SetupRadialMatrix(prop, whichPotentials, angularIndex):
 			potential = prop.Propagator.BasePropagator.PotentialList[potNum]
 		print "    Processing potential: %s" % (potential.Name, )
 
-		angularBasisPairs = potential.BasisPairs[0]
+		angularBasisPairs = GetAngularBasisPairs(potential, angularRank)
 		idx = [idx for idx, (i,j) in enumerate(zip(angularBasisPairs[:,0], angularBasisPairs[:,1])) if i==j==angularIndex]
 		if len(idx) != 1:
 			raise "Invalid angular indices %s" % idx
 		idx = idx[0]
 
-		basisPairs = potential.BasisPairs[1]
+		basisPairs = GetRadialBasisPairs(potential, angularRank)
+		potentialData = GetAngularMajorPotentialData(potential, angularRank)
 
 		for i, (x,xp) in enumerate(basisPairs):
 			indexLeft = x
 			indexRight = xp 
 			matrix[indexLeft, indexRight] += \
-				potential.PotentialData[idx,i].real
+				potentialData[idx,i].real
 
 	return matrix
 
@@ -135,3 +144,264 @@ def SetupOverlapMatrix(prop):
 	overlap.SetupStep(0.)
 	matrix = SetupRadialMatrix(prop, [overlap], 0)
 	return matrix
+
+
+@RegisterAll
+def SetupBandedRadialMatrix(prop, whichPotentials, angularIndex):
+	"""Extract the real symmetric radial matrix of the given potentials
+	in upper banded storage, as used by scipy.linalg.eig_banded and 
+	solveh_banded:
+
+		banded[bandwidth + i - j, j] = matrix[i, j],  i <= j
+
+	whichPotentials may contain indices into the propagator potential list
+	or TensorPotentials. Returns banded, bandwidth.
+	"""
+	potentials = []
+	for potNum in whichPotentials:
+		if isinstance(potNum, pyprop.TensorPotential):
+			potentials.append(potNum)
+		else:
+			potentials.append(prop.Propagator.BasePropagator.PotentialList[potNum])
+
+	angularRank = GetAngularRank(prop.psi)
+	bandwidth = max([abs(GetRadialBasisPairs(potential, angularRank)[:,0] - \
+		GetRadialBasisPairs(potential, angularRank)[:,1]).max() for potential in potentials])
+	matrixSize = GetAngularMajorData(prop.psi).shape[1]
+	banded = zeros((bandwidth + 1, matrixSize), dtype=double)
+
+	for potential in potentials:
+		angularBasisPairs = GetAngularBasisPairs(potential, angularRank)
+		idx = [idx for idx, (i,j) in enumerate(zip(angularBasisPairs[:,0], angularBasisPairs[:,1])) if i==j==angularIndex]
+		if len(idx) != 1:
+			raise Exception("Invalid angular indices %s" % idx)
+		idx = idx[0]
+
+		basisPairs = GetRadialBasisPairs(potential, angularRank)
+		upper = (basisPairs[:,0] <= basisPairs[:,1]).nonzero()[0]
+		row = basisPairs[upper, 0]
+		col = basisPairs[upper, 1]
+		potentialData = GetAngularMajorPotentialData(potential, angularRank)
+		banded[bandwidth + row - col, col] += potentialData[idx, upper].real
+
+	return banded, bandwidth
+
+
+@RegisterAll
+def SetupBandedOverlapMatrix(prop):
+	"""Radial overlap matrix in upper banded storage, returns banded, bandwidth
+	"""
+	overlap = prop.Propagator.BasePropagator.GeneratePotential(prop.Config.OverlapPotential)
+	overlap.SetupStep(0.)
+	return SetupBandedRadialMatrix(prop, [overlap], 0)
+
+
+@RegisterAll
+def GetGeneralBandedMatrix(banded):
+	"""Convert upper symmetric banded storage to the general (l, u) banded
+	storage of scipy.linalg.solve_banded, with l = u = bandwidth
+	"""
+	bandwidth = banded.shape[0] - 1
+	size = banded.shape[1]
+	general = zeros((2 * bandwidth + 1, size), dtype=banded.dtype)
+	general[:bandwidth + 1, :] = banded
+	for k in range(1, bandwidth + 1):
+		#Lower diagonal k: general[bandwidth + k, j] = matrix[j + k, j]
+		general[bandwidth + k, :size - k] = banded[bandwidth - k, k:]
+	return general
+
+
+@RegisterAll
+def MultiplyBandedMatrix(banded, vector):
+	"""Multiply a symmetric matrix in upper banded storage by vector
+	"""
+	bandwidth = banded.shape[0] - 1
+	result = banded[bandwidth, :] * vector
+	for k in range(1, bandwidth + 1):
+		diagonal = banded[bandwidth - k, k:]
+		result[:-k] += diagonal * vector[k:]
+		result[k:] += diagonal * vector[:-k]
+	return result
+
+
+#Number of shifts per multisection step of FindBandedEigenpair
+MultisectionShiftCount = 7
+
+
+@RegisterAll
+class EigenpairConvergenceError(Exception):
+	"""Raised by FindBandedEigenpair when the eigenpair does not converge"""
+	pass
+
+
+@RegisterAll
+def GetBandedInertia(H, S, shift):
+	"""Number of eigenvalues of the banded pencil (H, S) below shift.
+
+	By Sylvester's law of inertia, this is the number of negative pivots
+	in the LDL^T factorization of H - shift * S (S positive definite).
+	The factorization is done without pivoting directly in the upper banded
+	storage, O(n bandwidth^2). Pivots smaller than 1e-14 times the largest
+	diagonal element are replaced by that size, keeping their sign.
+
+	shift may also be a sequence of shifts, which are factorized together
+	(the loop over the rows is shared), returning an array of counts.
+	"""
+	bandwidth = H.shape[0] - 1
+	size = H.shape[1]
+	shifts = atleast_1d(asarray(shift, dtype=double))
+	A = H[:, :, None] - shifts[None, None, :] * S[:, :, None]
+
+	#Upper triangle of the trailing (bandwidth x bandwidth) block updated 
+	#by each pivot, as (row, col) offsets relative to the pivot
+	I, J = [array(idx) for idx in zip(*[(i, j) for j in range(1, bandwidth + 1) for i in range(1, j + 1)])]
+	offsets = arange(1, bandwidth + 1)
+	smallPivot = 1e-14 * maximum(abs(A[bandwidth, :, :]).max(axis=0), 1e-300)
+
+	negativeCount = zeros(len(shifts), dtype=int)
+	for k in range(size):
+		pivot = A[bandwidth, k, :]
+		pivot = where(abs(pivot) < smallPivot, copysign(smallPivot, pivot), pivot)
+		negativeCount += pivot < 0
+
+		#row k of the remaining matrix, A[k, k+1:k+bandwidth+1]
+		rowLength = min(bandwidth, size - k - 1)
+		if rowLength == 0:
+			continue
+		row = A[bandwidth - offsets[:rowLength], k + offsets[:rowLength], :]
+		i, j = I, J
+		if rowLength < bandwidth:
+			inside = J <= rowLength
+			i, j = I[inside], J[inside]
+		A[bandwidth + i - j, k + j, :] -= row[i - 1, :] * row[j - 1, :] / pivot[None, :]
+
+	if isscalar(shift):
+		return int(negativeCount[0])
+	return negativeCount
+
+
+@RegisterAll
+def FindBandedEigenpair(H, S, radialIndex, tolerance=1e-10, maxIterations=50, energyGuess=None):
+	"""Find eigenpair number radialIndex (counting from 0, in ascending order)
+	of the banded generalized problem H x = E S x, without diagonalizing.
+
+	Sylvester inertia counts (GetBandedInertia) bracket the eigenvalue, and
+	multisection (MultisectionShiftCount shifts counted together) narrows
+	the bracket until it contains only the requested eigenvalue. Rayleigh
+	quotient iteration then converges to it. A result outside the bracket
+	(a neighbouring state) is rejected, and the iteration restarted from a
+	narrower bracket. Every step is a banded factorization, O(n bandwidth^2).
+
+	Parametres
+	----------
+	H:             (array) Hamiltonian in upper banded storage
+	S:             (array) overlap in upper banded storage
+	radialIndex:   (int) index of the eigenpair, e.g. n - l - 1
+	tolerance:     (float) convergence of the relative residual |Hx - ESx|
+	maxIterations: (int) maximum number of Rayleigh quotient iterations
+	energyGuess:   (float) start of the bracket search (optional)
+
+	Returns E, x, with x normalized as x^T S x = 1. Raises
+	EigenpairConvergenceError if the bracket shrinks to the tolerance
+	without convergence.
+	"""
+	bandwidth = H.shape[0] - 1
+	count = lambda shift: GetBandedInertia(H, S, shift)
+
+	#Bracket: count(lower) <= radialIndex < count(upper)
+	center = 0.0 if energyGuess == None else energyGuess
+	step = 1.0
+	lower = center - step
+	countLower = count(lower)
+	while countLower > radialIndex:
+		step *= 2
+		lower = center - step
+		countLower = count(lower)
+	step = 1.0
+	upper = center + step
+	countUpper = count(upper)
+	while countUpper <= radialIndex:
+		step *= 2
+		upper = center + step
+		countUpper = count(upper)
+
+	#Narrow the bracket to the innermost of the shifts on each side
+	def Multisect(lower, upper, countLower, countUpper):
+		shifts = linspace(lower, upper, MultisectionShiftCount + 2)[1:-1]
+		counts = count(shifts)
+		below = (counts <= radialIndex).nonzero()[0]
+		if len(below) > 0:
+			lower, countLower = shifts[below[-1]], counts[below[-1]]
+		above = (counts > radialIndex).nonzero()[0]
+		if len(above) > 0:
+			upper, countUpper = shifts[above[0]], counts[above[0]]
+		return lower, upper, countLower, countUpper
+
+	#Until the bracket contains only the requested eigenvalue
+	while countLower != radialIndex or countUpper != radialIndex + 1:
+		if upper - lower < tolerance * max(abs(upper), 1.0):
+			break
+		lower, upper, countLower, countUpper = Multisect(lower, upper, countLower, countUpper)
+
+	#Rayleigh quotient iteration from the bracket midpoint. The converged
+	#eigenvalue must lie in the bracket, otherwise iteration found a 
+	#neighbouring state, and is restarted from a narrower bracket
+	Hgeneral = GetGeneralBandedMatrix(H)
+	Sgeneral = GetGeneralBandedMatrix(S)
+	while True:
+		x = ones(H.shape[1], dtype=double)
+		E = 0.5 * (lower + upper)
+		residual = 1.0
+		for iteration in range(maxIterations):
+			x = scipy.linalg.solve_banded((bandwidth, bandwidth), Hgeneral - E * Sgeneral, MultiplyBandedMatrix(S, x))
+			Sx = MultiplyBandedMatrix(S, x)
+			norm = sqrt(dot(x, Sx))
+			x /= norm
+			Sx /= norm
+
+			Hx = MultiplyBandedMatrix(H, x)
+			rayleigh = dot(x, Hx)
+			residual = sqrt(dot(Hx - rayleigh * Sx, Hx - rayleigh * Sx)) / max(abs(rayleigh), 1.0)
+			if lower <= rayleigh <= upper:
+				E = rayleigh
+			if residual < tolerance:
+				break
+
+		if residual < tolerance and lower <= rayleigh <= upper:
+			return rayleigh, x
+		if upper - lower < tolerance * max(abs(upper), 1.0):
+			raise EigenpairConvergenceError("Eigenpair %i did not converge, residual %e" % (radialIndex, residual))
+		for i in range(2):
+			lower, upper, countLower, countUpper = Multisect(lower, upper, countLower, countUpper)
+
+
+@RegisterAll
+def SetupRadialEigenpair(prop, quantumNumbers, potentialIndices=[0], tolerance=1e-10, energyGuess=None):
+	"""Find the single radial eigenpair of the given potentials selected 
+	by quantumNumbers (l, and n through GetRadialIndex()), using 
+	FindBandedEigenpair instead of diagonalizing the full radial matrix.
+
+	Returns E, x, angIdx with x normalized as x^T S x = 1
+	"""
+	if not pyprop.IsSingleProc():
+		raise Exception("Works only on a single processor")
+
+	lmIdx = quantumNumbers.GetLmIndex()
+	angIdx = GetAngularRepresentation(prop.psi).Range.GetGridIndex(lmIdx)
+	H, bandwidthH = SetupBandedRadialMatrix(prop, potentialIndices, angIdx)
+	S, bandwidthS = SetupBandedOverlapMatrix(prop)
+	if bandwidthS != bandwidthH:
+		raise Exception("Hamiltonian and overlap have different bandwidths")
+
+	E, x = FindBandedEigenpair(H, S, quantumNumbers.GetRadialIndex(), tolerance, energyGuess=energyGuess)
+
+	#assure correct phase convention (first oscillation should start out real positive)
+	bspl = GetRadialRepresentation(prop.psi).GetBSplineObject()
+	phaseGrid = array((0, bspl.GetBreakpointSequence()[1]), dtype=double)
+	phaseBuffer = zeros(2, dtype=complex)
+	eigVecBuf = array(x, dtype=complex)
+	bspl.ConstructFunctionFromBSplineExpansion(eigVecBuf, phaseGrid, phaseBuffer)
+	if real(phaseBuffer[1]) < 0:
+		x *= -1
+
+	return E, x, angIdx
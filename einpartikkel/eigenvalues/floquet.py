@@ -0,0 +1,182 @@
+"""
+floquet
+=======
+
+Quasienergies of an atom in a periodic (monochromatic) field, for long
+flat-top pulses where propagating to the quasi-steady state would take
+hundreds of cycles.
+
+With V(t) = F z cos(w t), the Floquet Hamiltonian in the photon number
+basis n = -N..N is block tridiagonal:
+
+	H_F[n, n]     = H0 + n w S
+	H_F[n, n +- 1] = (F / 2) z
+
+each block being the coupled (l, radial) matrix of complexscaling.py.
+Combined with complex scaling (theta > 0), the quasienergies near the
+field free states are complex, E = E_r - i Gamma / 2, giving the light
+shift (E_r - E_0) and the ionisation rate Gamma directly.
+
+Quasienergies near a target are found with shift-invert Arnoldi. The
+shifted system is solved either with a sparse LU factorisation of the
+full matrix ("direct"), or with GMRES preconditioned by the LU
+factorisations of the per (n, l) radial blocks ("gmres"), which only
+needs memory for the banded radial factors.
+
+Example
+-------
+>>> static = [("RadialKineticEnergy", -2), ("AngularKineticEnergy", -2),
+...	("CoulombPotential", -1)]
+>>> couplings = [("LaserPotentialLengthZ", 1, 0.01)]
+>>> E, Gamma = FindQuasienergies(prop, static, couplings, frequency=0.3,
+...	photonCount=4, targetEnergy=-0.5, theta=0.3)
+
+"""
+from numpy import exp, arange, argsort, abs, real, imag, complex, zeros, ones
+import scipy.sparse
+import scipy.sparse.linalg
+import pyprop
+from pyprop.pyproplogging import GetFunctionLogger
+from ..utils import RegisterAll
+from ..core.layout import GetAngularMajorData
+from complexscaling import SetupComplexScaledMatrices, SetupCoupledMatrix
+
+
+@RegisterAll
+def SetupFloquetMatrices(prop, staticPotentials, couplingPotentials, frequency, \
+		photonCount, theta=0.0):
+	"""
+	H_F, S_F as sparse matrices over photon number n = -photonCount..photonCount
+	(slowest index) and (angular, radial)
+
+	Parametres
+	----------
+	prop:               (pyprop.Problem) the problem
+	staticPotentials:   (list) field free potentials, as for
+	                    complexscaling.SetupComplexScaledMatrices
+	couplingPotentials: (list) tuples (potential, degree, amplitude) of
+	                    the potentials multiplied by cos(w t), e.g. a
+	                    LaserPotentialLength section with the field
+	                    amplitude
+	frequency:          (float) w
+	photonCount:        (int) N, the photon blocks are n = -N..N
+	theta:              (float) complex scaling angle
+	"""
+	H0, S = SetupComplexScaledMatrices(prop, staticPotentials, theta)
+	coupling = SetupCoupledMatrix(prop, [(item[0], 0.5 * item[2] * exp(1.0j * item[1] * theta)) \
+		for item in couplingPotentials])
+
+	blockCount = 2 * photonCount + 1
+	photons = arange(-photonCount, photonCount + 1)
+	identity = scipy.sparse.identity(blockCount, format="csr")
+	photonShift = scipy.sparse.spdiags(frequency * photons, 0, blockCount, blockCount)
+	offDiagonal = scipy.sparse.spdiags([ones(blockCount), ones(blockCount)], [-1, 1], \
+		blockCount, blockCount)
+
+	HF = scipy.sparse.kron(identity, H0) + scipy.sparse.kron(photonShift, S) \
+		+ scipy.sparse.kron(offDiagonal, coupling)
+	SF = scipy.sparse.kron(identity, S)
+	return HF.tocsc(), SF.tocsc()
+
+
+@RegisterAll
+class FloquetShiftInvert:
+	"""
+	Solves (H_F - target S_F) x = S_F b, the shift-invert operator of the
+	Floquet eigenvalue problem.
+
+	solver = "direct" factorizes the full matrix. solver = "gmres" uses
+	GMRES, preconditioned by LU factorizations of the diagonal
+	(photon, angular) radial blocks of H_F - target S_F. The shifted
+	system is nearly singular when target is close to a quasienergy, so
+	the GMRES tolerance should not be much below sqrt(machine precision);
+	shift-invert Arnoldi converges with inexact solves.
+	"""
+
+	def __init__(self, HF, SF, target, radialCount, solver="direct", tolerance=1e-8, \
+			krylovSize=50, maxRestarts=20):
+		self.Logger = GetFunctionLogger()
+		self.SF = SF
+		self.Shifted = (HF - target * SF).tocsc()
+		self.RadialCount = radialCount
+		self.Solver = solver
+		self.Tolerance = tolerance
+		self.KrylovSize = krylovSize
+		self.MaxRestarts = maxRestarts
+		self.IterationCount = 0
+
+		if solver == "direct":
+			self.Factorization = scipy.sparse.linalg.splu(self.Shifted)
+		elif solver == "gmres":
+			self.SetupBlockPreconditioner()
+		else:
+			raise Exception("Unknown Floquet solver '%s'" % solver)
+
+	def SetupBlockPreconditioner(self):
+		size = self.Shifted.shape[0]
+		N = self.RadialCount
+		if size % N != 0:
+			raise Exception("Matrix size %i is not a multiple of the radial size %i" % (size, N))
+		shifted = self.Shifted.tocsr()
+		self.BlockFactorizations = [scipy.sparse.linalg.splu(shifted[i:i+N, i:i+N].tocsc()) \
+			for i in range(0, size, N)]
+		self.Preconditioner = scipy.sparse.linalg.LinearOperator(self.Shifted.shape, \
+			matvec=self.SolveBlocks, dtype=complex)
+		self.Operator = scipy.sparse.linalg.aslinearoperator(self.Shifted)
+
+	def SolveBlocks(self, b):
+		x = zeros(b.shape, dtype=complex)
+		N = self.RadialCount
+		for i, lu in enumerate(self.BlockFactorizations):
+			x[i*N:(i+1)*N] = lu.solve(b[i*N:(i+1)*N])
+		return x
+
+	def Solve(self, b):
+		rhs = self.SF * b
+		if self.Solver == "direct":
+			return self.Factorization.solve(rhs)
+
+		x, info = scipy.sparse.linalg.gmres(self.Operator, rhs, M=self.Preconditioner, \
+			tol=self.Tolerance, restart=self.KrylovSize, maxiter=self.MaxRestarts, \
+			callback=self.CountIteration)
+		if info != 0:
+			self.Logger.warning("GMRES did not converge (info = %i)" % info)
+		return x
+
+	def CountIteration(self, residual):
+		self.IterationCount += 1
+
+	def GetLinearOperator(self):
+		return scipy.sparse.linalg.LinearOperator(self.Shifted.shape, matvec=self.Solve, dtype=complex)
+
+
+@RegisterAll
+def FindQuasienergies(prop, staticPotentials, couplingPotentials, frequency, photonCount, \
+		targetEnergy, count=4, theta=0.0, solver="direct"):
+	"""
+	E, Gamma = FindQuasienergies(prop, staticPotentials, couplingPotentials,
+		frequency, photonCount, targetEnergy, count, theta, solver)
+
+	The count quasienergies closest to targetEnergy, as E = Re(E) and
+	Gamma = -2 Im(E) (the ionisation rate, with theta > 0). See
+	SetupFloquetMatrices for the arguments, and FloquetShiftInvert for
+	solver.
+	"""
+	if not pyprop.IsSingleProc():
+		raise Exception("Works only on a single processor")
+
+	logger = GetFunctionLogger()
+	HF, SF = SetupFloquetMatrices(prop, staticPotentials, couplingPotentials, frequency, \
+		photonCount, theta)
+	logger.info("Floquet matrix size %i, %i nonzeros" % (HF.shape[0], HF.nnz))
+
+	radialCount = GetAngularMajorData(prop.psi).shape[1]
+	shiftInvert = FloquetShiftInvert(HF, SF, targetEnergy, radialCount, solver)
+	shiftedE = scipy.sparse.linalg.eigs(shiftInvert.GetLinearOperator(), k=count, \
+		return_eigenvectors=False)
+	if solver == "gmres":
+		logger.info("GMRES iterations: %i" % shiftInvert.IterationCount)
+
+	E = targetEnergy + 1.0 / shiftedE
+	E = E[argsort(abs(E - targetEnergy))]
+	return real(E), -2 * imag(E)
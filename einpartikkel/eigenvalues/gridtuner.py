@@ -0,0 +1,311 @@
+"""
+gridtuner
+=========
+
+Search for the smallest radial B-spline grid meeting accuracy targets,
+instead of hand tuning xsize, xpartition, gamma, order and bpstype in
+[RadialRepresentation].
+
+A grid is accepted when
+
+	1) every target bound state energy is reproduced within tolerance,
+	   found with FindBandedEigenpair on the banded radial matrices, and
+
+	2) (optionally) for the given l values, the box continuum below Emax
+	   agrees with a finer reference grid on the same [xmin, xmax]: the
+	   phase error of box state n,
+
+	       pi |E_n - E_n^ref| / (E_(n+1)^ref - E_n^ref),
+
+	   is below phaseTolerance. A phase error of pi corresponds to a shift
+	   of one whole box state.
+
+For every combination of order, bpstype, xpartition and gamma, the
+smallest accepted xsize is found by bisection (assuming accuracy
+increases with xsize), and the grid with the fewest B-splines is
+returned.
+
+The reference grid has twice the largest candidate size, the highest
+order, and the candidate shape with the most points near the origin
+(largest xpartition and gamma), unless given by the caller. It must be
+converged for the continuum check to be meaningful.
+
+Each grid is evaluated on an angular basis with m = 0 only (l up to the
+largest target l), and only the field free potentials and the overlap are
+generated. The problem is not set up for propagation, so lasers,
+propagator and preconditioner are not created.
+
+Example
+-------
+>>> targets = [(HydrogenicQuantumNumbers(1, 0, 0), -0.5),
+...	(HydrogenicQuantumNumbers(2, 1, 0), -0.125)]
+>>> tuner = RadialGridTuner("config.ini", targets, tolerance=1e-8,
+...	continuumAngularMomenta=[0, 1], Emax=2.0)
+>>> grid = tuner.Tune(orders=[5, 7], partitions=[5., 10.], gammas=[1.5, 2.5])
+>>> print FormatRadialGridConfig(grid)
+
+"""
+from numpy import array, zeros, pi, abs, inf, double
+import scipy.linalg
+import pyprop
+from pyprop.pyproplogging import GetFunctionLogger
+from ..utils import RegisterAll
+from ..core.layout import GetAngularRepresentation, GetAngularMajorData
+from eigenvalues import SetupBandedRadialMatrix, SetupBandedOverlapMatrix, \
+	FindBandedEigenpair, EigenpairConvergenceError
+
+#Keys of [RadialRepresentation] set by the tuner
+RadialGridKeys = ["xsize", "order", "bpstype", "xpartition", "gamma"]
+
+
+@RegisterAll
+def FormatRadialGridConfig(grid):
+	"""
+	The grid as a [RadialRepresentation] config snippet, with the keys
+	used by its bpstype
+	"""
+	lines = ["[RadialRepresentation]"]
+	lines.append("xsize = %i" % grid["xsize"])
+	lines.append("order = %i" % grid["order"])
+	lines.append("bpstype = '%s'" % grid["bpstype"])
+	if grid["bpstype"] == "exponentiallinear":
+		lines.append("xpartition = %s" % grid["xpartition"])
+	if grid["bpstype"] in ["exponentiallinear", "exponential"]:
+		lines.append("gamma = %s" % grid["gamma"])
+	return "\n".join(lines)
+
+
+def GetDenseMatrix(banded):
+	bandwidth = banded.shape[0] - 1
+	size = banded.shape[1]
+	matrix = zeros((size, size), dtype=banded.dtype)
+	for k in range(bandwidth + 1):
+		diagonal = banded[bandwidth - k, k:]
+		matrix[range(size - k), range(k, size)] = diagonal
+		matrix[range(k, size), range(size - k)] = diagonal
+	return matrix
+
+
+@RegisterAll
+def GetContinuumPhaseError(E, Eref):
+	"""
+	Largest phase error pi |E_n - E_n^ref| / spacing_n of the box states
+	E (ascending, 0 < E < Emax) against the reference Eref. Infinite if
+	the number of states differs
+	"""
+	if len(E) != len(Eref):
+		return inf
+	if len(E) < 2:
+		return 0.0
+	spacing = zeros(len(Eref), dtype=double)
+	spacing[:-1] = Eref[1:] - Eref[:-1]
+	spacing[-1] = spacing[-2]
+	return (pi * abs(E - Eref) / spacing).max()
+
+
+@RegisterAll
+class RadialGridTuner(object):
+	"""
+	Parametres
+	----------
+	configFile:              (string) config file of the problem; the
+	                         [RadialRepresentation] grid keys are overridden
+	boundStates:             (list) tuples (quantumNumbers, energy) of the
+	                         target bound states
+	tolerance:               (float) absolute bound state energy tolerance
+	continuumAngularMomenta: (list) l values of the continuum check
+	Emax:                    (float) upper energy of the continuum check
+	phaseTolerance:          (float) largest accepted continuum phase error
+	potentials:              (list) names of the field free potential
+	                         sections (default grid_potential_list of
+	                         [Propagation])
+	"""
+
+	def __init__(self, configFile, boundStates, tolerance=1e-6, continuumAngularMomenta=[], \
+			Emax=None, phaseTolerance=0.01, potentials=None):
+		if not pyprop.IsSingleProc():
+			raise Exception("Works only on a single processor")
+		if len(continuumAngularMomenta) > 0 and Emax == None:
+			raise Exception("The continuum check needs Emax")
+
+		self.Logger = GetFunctionLogger()
+		self.ConfigFile = configFile
+		self.BoundStates = boundStates
+		self.Tolerance = tolerance
+		self.ContinuumAngularMomenta = list(continuumAngularMomenta)
+		self.Emax = Emax
+		self.PhaseTolerance = phaseTolerance
+		self.Potentials = potentials
+		self.AngularMomenta = sorted(set([qn.l for qn, energy in boundStates] + self.ContinuumAngularMomenta))
+		self.ReferenceContinuum = None
+		self.Results = {}
+
+	def GetGridMatrices(self, grid):
+		"""
+		Banded radial Hamiltonians {l: H_l}, the banded overlap, and the
+		number of B-splines of grid
+		"""
+		from einpartikkel.core.indexiterators import FixedMLmIndexIterator
+		conf = pyprop.Load(self.ConfigFile)
+		conf.SetValue("AngularRepresentation", "index_iterator", \
+			FixedMLmIndexIterator(max(self.AngularMomenta), [0]))
+		for key in RadialGridKeys:
+			if key in grid:
+				conf.SetValue("RadialRepresentation", key, grid[key])
+
+		#Only the field free potentials, without setting up the propagation
+		prop = pyprop.Problem(conf)
+		names = self.Potentials
+		if names == None:
+			names = conf.Propagation.grid_potential_list
+		potentials = []
+		for name in names:
+			potential = prop.Propagator.BasePropagator.GeneratePotential(conf.GetSection(name))
+			potential.SetupStep(0.)
+			potentials.append(potential)
+
+		angRange = GetAngularRepresentation(prop.psi).Range
+		H = {}
+		for l in self.AngularMomenta:
+			angIdx = angRange.GetGridIndex(pyprop.core.LmIndex(l, 0))
+			H[l] = SetupBandedRadialMatrix(prop, potentials, angIdx)[0]
+		S = SetupBandedOverlapMatrix(prop)[0]
+		return H, S, GetAngularMajorData(prop.psi).shape[1]
+
+	def GetContinuumEnergies(self, H, S):
+		"""
+		Box state energies 0 < E < Emax of each continuum l
+		"""
+		continuum = {}
+		if len(self.ContinuumAngularMomenta) == 0:
+			return continuum
+		denseS = GetDenseMatrix(S)
+		for l in self.ContinuumAngularMomenta:
+			E = scipy.linalg.eigh(GetDenseMatrix(H[l]), denseS, eigvals_only=True)
+			continuum[l] = E[(E > 0) & (E < self.Emax)]
+		return continuum
+
+	def SetupReference(self, grid):
+		"""
+		Continuum reference energies from a fine grid (should be converged)
+		"""
+		if len(self.ContinuumAngularMomenta) == 0:
+			return
+		self.Logger.info("Computing continuum reference on %s" % grid)
+		H, S, basisSize = self.GetGridMatrices(grid)
+		self.ReferenceContinuum = self.GetContinuumEnergies(H, S)
+
+	def EvaluateGrid(self, grid):
+		"""
+		passed, basisSize, energyError, phaseError = EvaluateGrid(grid)
+
+		Largest bound state energy error and continuum phase error of grid
+		"""
+		key = tuple([grid.get(k, None) for k in RadialGridKeys])
+		if key in self.Results:
+			return self.Results[key]
+
+		H, S, basisSize = self.GetGridMatrices(grid)
+		energyError = 0.0
+		for quantumNumbers, energy in self.BoundStates:
+			try:
+				E, x = FindBandedEigenpair(H[quantumNumbers.l], S, quantumNumbers.GetRadialIndex(), \
+					tolerance=1e-10, energyGuess=energy)
+				energyError = max(energyError, abs(E - energy))
+			except EigenpairConvergenceError:
+				#The grid does not resolve the state
+				energyError = inf
+
+		phaseError = 0.0
+		if self.ReferenceContinuum != None:
+			continuum = self.GetContinuumEnergies(H, S)
+			for l in self.ContinuumAngularMomenta:
+				phaseError = max(phaseError, GetContinuumPhaseError(continuum[l], self.ReferenceContinuum[l]))
+
+		passed = bool(energyError <= self.Tolerance and phaseError <= self.PhaseTolerance)
+		self.Logger.info("Grid %s: %i B-splines, energy error %.2e, phase error %.2e, %s" % \
+			(grid, basisSize, energyError, phaseError, ["rejected", "accepted"][passed]))
+		self.Results[key] = (passed, basisSize, energyError, phaseError)
+		return self.Results[key]
+
+	def SearchSize(self, grid, minSize, maxSize):
+		"""
+		Smallest accepted xsize in [minSize, maxSize] for the other grid
+		parametres, or None if maxSize is not accepted
+		"""
+		grid = dict(grid)
+		grid["xsize"] = maxSize
+		if not self.EvaluateGrid(grid)[0]:
+			return None
+		lower, upper = minSize - 1, maxSize
+		while upper - lower > 1:
+			grid["xsize"] = (lower + upper) // 2
+			if self.EvaluateGrid(grid)[0]:
+				upper = grid["xsize"]
+			else:
+				lower = grid["xsize"]
+		return upper
+
+	def GetDefaultReferenceGrid(self, orders, bpstypes, partitions, gammas, maxSize):
+		"""
+		Twice the largest candidate size, the highest order, and the
+		candidate shape with the most points near the origin
+		"""
+		grid = {"xsize": 2 * maxSize, "order": max(orders)}
+		for bpstype in ["exponentiallinear", "exponential", "linear"]:
+			if bpstype in bpstypes:
+				grid["bpstype"] = bpstype
+				break
+		else:
+			grid["bpstype"] = bpstypes[0]
+		if grid["bpstype"] == "exponentiallinear":
+			grid["xpartition"] = max(partitions)
+		if grid["bpstype"] in ["exponentiallinear", "exponential"]:
+			grid["gamma"] = max(gammas)
+		return grid
+
+	def Tune(self, orders=[5, 7], bpstypes=["exponentiallinear"], partitions=[5., 10., 20.], \
+			gammas=[1.5, 2.5, 4.0], minSize=10, maxSize=300, referenceGrid=None):
+		"""
+		Search the grid parametres, returning the accepted grid (a dict of
+		the [RadialRepresentation] keys, and "basis_size") with the fewest
+		B-splines. The continuum reference is referenceGrid (a dict of the
+		[RadialRepresentation] keys), by default GetDefaultReferenceGrid().
+		"""
+		if self.ReferenceContinuum == None:
+			if referenceGrid == None:
+				referenceGrid = self.GetDefaultReferenceGrid(orders, bpstypes, partitions, gammas, maxSize)
+			self.SetupReference(referenceGrid)
+
+		candidates = []
+		for bpstype in bpstypes:
+			for order in orders:
+				if bpstype == "exponentiallinear":
+					shapes = [(xpartition, gamma) for xpartition in partitions for gamma in gammas]
+				elif bpstype == "exponential":
+					shapes = [(None, gamma) for gamma in gammas]
+				else:
+					shapes = [(None, None)]
+				for xpartition, gamma in shapes:
+					grid = {"order": order, "bpstype": bpstype}
+					if xpartition != None:
+						grid["xpartition"] = xpartition
+					if gamma != None:
+						grid["gamma"] = gamma
+					candidates.append(grid)
+
+		best = None
+		for grid in candidates:
+			xsize = self.SearchSize(grid, minSize, maxSize)
+			if xsize == None:
+				self.Logger.info("Grid %s not accepted at xsize = %i" % (grid, maxSize))
+				continue
+			grid["xsize"] = xsize
+			grid["basis_size"] = self.EvaluateGrid(grid)[1]
+			if best == None or grid["basis_size"] < best["basis_size"]:
+				best = grid
+
+		if best == None:
+			raise Exception("No grid meets the tolerances, increase maxSize")
+		self.Logger.info("Smallest grid (%i B-splines):\n%s" % (best["basis_size"], FormatRadialGridConfig(best)))
+		return best
@@ -0,0 +1,132 @@
+"""
+hydrogenic
+==========
+
+Analytic hydrogenic initial states, projected directly into the radial
+B-spline basis.
+
+For Coulomb targets the radial functions u_nl(r) = r R_nl(r) are known,
+so instead of diagonalising the radial Hamiltonian for every l, u_nl is
+evaluated at the quadrature points and expanded in B-splines (one banded
+overlap solve). Optionally, the expansion is polished by one step of
+inverse iteration against the discrete Hamiltonian,
+
+	(H_l - E_n S) x = S c,
+
+which removes the projection error and gives the discrete eigenvector
+the diagonalisation would have found.
+
+"""
+from numpy import exp, log, sqrt, zeros, ones, array, asarray, double, complex, \
+	vdot
+import scipy.linalg
+from scipy.special import gammaln
+import pyprop
+from ..utils import RegisterAll
+from ..core.layout import GetAngularRepresentation, GetRadialRepresentation, GetAngularMajorData
+from ..core.overlap import InvalidateOverlap
+from eigenvalues import SetupBandedRadialMatrix, SetupBandedOverlapMatrix, \
+	GetGeneralBandedMatrix, MultiplyBandedMatrix
+
+
+@RegisterAll
+def GetHydrogenicRadialFunction(n, l, r, charge=1.0):
+	"""
+	Reduced radial function u_nl(r) = r R_nl(r) of a hydrogenic atom with
+	nuclear charge Z = charge, normalised to int |u|^2 dr = 1, and positive
+	for small r
+	"""
+	r = asarray(r, dtype=double)
+	k = n - l - 1
+	if k < 0:
+		raise Exception("Invalid quantum numbers n = %i, l = %i" % (n, l))
+	rho = 2. * charge * r / n
+
+	#Generalised Laguerre polynomial L_k^(2l+1)(rho) by recurrence
+	alpha = 2 * l + 1
+	laguerrePrev = ones(rho.shape)
+	laguerre = laguerrePrev
+	if k > 0:
+		laguerre = 1 + alpha - rho
+	for j in range(1, k):
+		laguerreNext = ((2 * j + 1 + alpha - rho) * laguerre - (j + alpha) * laguerrePrev) / (j + 1)
+		laguerrePrev, laguerre = laguerre, laguerreNext
+
+	logNorm = 0.5 * (3 * log(2. * charge / n) + gammaln(k + 1) - gammaln(n + l + 1) - log(2. * n))
+	return r * exp(logNorm - rho / 2) * rho**l * laguerre
+
+
+@RegisterAll
+def GetHydrogenicEnergy(n, charge=1.0):
+	return -charge**2 / (2. * n**2)
+
+
+@RegisterAll
+def ExpandHydrogenicState(psi, quantumNumbers, charge=1.0):
+	"""
+	B-spline coefficients of the hydrogenic state u_nl, by projecting on
+	the B-splines and solving with the overlap matrix
+	"""
+	bspl = GetRadialRepresentation(psi).GetBSplineObject()
+	grid = bspl.GetQuadratureGridGlobal()
+	values = array(GetHydrogenicRadialFunction(quantumNumbers.n, quantumNumbers.l, \
+		grid, charge), dtype=complex)
+	coefficients = zeros(GetAngularMajorData(psi).shape[1], dtype=complex)
+	bspl.ExpandFunctionInBSplines(values, coefficients)
+	return coefficients
+
+
+@RegisterAll
+def PolishRadialState(prop, coefficients, angularIndex, energy, potentialIndices=[0], \
+		overlap=None):
+	"""
+	One step of inverse iteration, x = (H_l - energy S)^-1 S c, normalised
+	with S and with the phase of c. All matrices are banded.
+
+	Parametres
+	----------
+	prop:             (pyprop.Problem) the problem defining H
+	coefficients:     (array) radial B-spline coefficients c
+	angularIndex:     (int) angular index of psi selecting the radial H_l
+	energy:           (float) shift, close to the eigenvalue
+	potentialIndices: (list) potentials making up H
+	overlap:          (tuple) banded overlap and bandwidth, as returned by
+	                  SetupBandedOverlapMatrix (computed if not given)
+	"""
+	H, bandwidthH = SetupBandedRadialMatrix(prop, potentialIndices, angularIndex)
+	if overlap == None:
+		overlap = SetupBandedOverlapMatrix(prop)
+	S, bandwidthS = overlap
+	if bandwidthS != bandwidthH:
+		raise Exception("Hamiltonian and overlap have different bandwidths")
+
+	shifted = GetGeneralBandedMatrix(H - energy * S)
+	x = scipy.linalg.solve_banded((bandwidthH, bandwidthH), shifted, \
+		MultiplyBandedMatrix(S, coefficients))
+
+	x *= 1. / sqrt(abs(vdot(x, MultiplyBandedMatrix(S, x))))
+	overlapPhase = vdot(x, MultiplyBandedMatrix(S, coefficients))
+	x *= overlapPhase / abs(overlapPhase)
+	return x
+
+
+@RegisterAll
+def SetHydrogenicState(prop, quantumNumbers, charge=1.0, polish=True, \
+		potentialIndices=[0]):
+	"""
+	Set prop.psi to the hydrogenic state with the given quantum numbers,
+	optionally polished against the discrete Hamiltonian.
+	"""
+	if not pyprop.IsSingleProc():
+		raise Exception("Works only on a single processor")
+
+	psi = prop.psi
+	angIdx = GetAngularRepresentation(psi).Range.GetGridIndex(quantumNumbers.GetLmIndex())
+	coefficients = ExpandHydrogenicState(psi, quantumNumbers, charge)
+	if polish:
+		coefficients = PolishRadialState(prop, coefficients, angIdx, \
+			GetHydrogenicEnergy(quantumNumbers.n, charge), potentialIndices)
+
+	psi.GetData()[:] = 0
+	GetAngularMajorData(psi)[angIdx, :] = coefficients
+	InvalidateOverlap(psi)
@@ -0,0 +1,177 @@
+"""
+Instrumentation
+===============
+
+Structured report of the native instrumentation (core/instrumentation.h)
+compiled into the core and analysis libraries, merged with timers of
+python level hot paths (preconditioner setup and solves).
+
+The native counters are only available when the libraries are compiled with
+USE_INSTRUMENTATION := 1. The python timers are enabled whenever the native
+instrumentation is, or after calling EnableInstrumentation().
+
+With USE_PERF_COUNTERS := 1 the native scopes also record hardware cycles,
+instructions and last level cache misses, from which IPC and bytes/cycle
+are reported. Where the counters are unavailable (e.g. in containers) these
+columns are left out.
+
+Example
+-------
+>>> prop.run()
+>>> PrintInstrumentationReport()
+
+"""
+from __future__ import with_statement
+import time
+from contextlib import contextmanager
+from utils import RegisterAll
+
+_PythonCounters = {}
+_PythonEnabled = False
+_NativeEnabled = None
+
+
+def _GetNativeModules():
+	import core.above
+	import analysis.above
+	return [core.above, analysis.above]
+
+
+@RegisterAll
+def EnableInstrumentation(enable=True):
+	"""
+	Enable the python level timers (native counters are controlled at
+	compile time)
+	"""
+	global _PythonEnabled
+	_PythonEnabled = enable
+
+
+@RegisterAll
+def IsInstrumentationEnabled():
+	"""
+	True if either the native instrumentation is compiled in, or the python
+	timers have been enabled
+	"""
+	global _NativeEnabled
+	if _PythonEnabled:
+		return True
+	if _NativeEnabled == None:
+		_NativeEnabled = True in [m.IsInstrumentationEnabled() for m in _GetNativeModules()]
+	return _NativeEnabled
+
+
+@RegisterAll
+@contextmanager
+def InstrumentScope(name, byteCount=0):
+	"""
+	Time the enclosed block as name, counting calls and bytes touched.
+	Does nothing if instrumentation is disabled.
+
+	>>> with InstrumentScope("RadialPreconditioner.Solve"):
+	>>>     ...
+	"""
+	if not IsInstrumentationEnabled():
+		yield
+		return
+
+	start = time.time()
+	try:
+		yield
+	finally:
+		counter = _PythonCounters.setdefault(name, [0, 0.0, 0])
+		counter[0] += 1
+		counter[1] += time.time() - start
+		counter[2] += byteCount
+
+
+_PerfCounterNames = ["cycles", "instructions", "cachemisses"]
+
+#Bytes transferred from memory per last level cache miss
+CacheLineSize = 64
+
+
+def _AddReportLine(report, name, calls, seconds, bytes, perf=None):
+	entry = report.setdefault(name, {"calls": 0, "time": 0.0, "bytes": 0})
+	entry["calls"] += calls
+	entry["time"] += seconds
+	entry["bytes"] += bytes
+	if perf:
+		for counterName, value in zip(_PerfCounterNames, perf):
+			entry[counterName] = entry.get(counterName, 0) + value
+
+
+@RegisterAll
+def IsPerfCountersAvailable():
+	"""
+	True if hardware counters are compiled in and readable in this process
+	"""
+	return True in [m.IsPerfCountersAvailable() for m in _GetNativeModules()]
+
+
+@RegisterAll
+def GetInstrumentationReport():
+	"""
+	report = GetInstrumentationReport()
+
+	Returns
+	-------
+	report : dict of name -> {"calls", "time", "bytes"}, summed over
+	         threads, over the core and analysis libraries, and the python
+	         timers. Native entries also have "cycles", "instructions" and
+	         "cachemisses" when compiled with USE_PERF_COUNTERS.
+	"""
+	report = {}
+	for module in _GetNativeModules():
+		for line in module.GetInstrumentationReport().splitlines():
+			fields = line.split("\t")
+			name, calls, seconds, bytes = fields[:4]
+			perf = [int(v) for v in fields[4:]]
+			_AddReportLine(report, name, int(calls), float(seconds), int(bytes), perf)
+	for name, (calls, seconds, bytes) in _PythonCounters.iteritems():
+		_AddReportLine(report, name, calls, seconds, bytes)
+	return report
+
+
+@RegisterAll
+def ResetInstrumentation():
+	"""
+	Zero all native counters and python timers
+	"""
+	for module in _GetNativeModules():
+		module.ResetInstrumentation()
+	_PythonCounters.clear()
+
+
+@RegisterAll
+def FormatInstrumentationReport(report=None):
+	"""
+	Returns the report as a table sorted by time
+	"""
+	if report == None:
+		report = GetInstrumentationReport()
+	lines = ["%-60s %10s %12s %12s %10s %8s %10s %10s" % ("Name", "Calls", \
+		"Time (s)", "MB", "GB/s", "IPC", "B/cycle", "DRAM B/c")]
+	for name, entry in sorted(report.iteritems(), key=lambda i: -i[1]["time"]):
+		megabytes = entry["bytes"] / 1024.**2
+		bandwidth = 0.0
+		if entry["time"] > 0:
+			bandwidth = entry["bytes"] / entry["time"] / 1024.**3
+		line = "%-60s %10i %12.4f %12.1f %10.2f" % (name, entry["calls"], \
+			entry["time"], megabytes, bandwidth)
+
+		#IPC, bytes touched per cycle, and memory traffic per cycle estimated
+		#from last level cache misses
+		cycles = entry.get("cycles", 0)
+		if cycles > 0:
+			line += " %8.2f %10.3f %10.3f" % (float(entry["instructions"]) / cycles, \
+				float(entry["bytes"]) / cycles, float(entry["cachemisses"] * CacheLineSize) / cycles)
+		else:
+			line += " %8s %10s %10s" % ("-", "-", "-")
+		lines.append(line)
+	return "\n".join(lines)
+
+
+@RegisterAll
+def PrintInstrumentationReport():
+	print FormatInstrumentationReport()
@@ -0,0 +1,152 @@
+"""
+MemoryLedger
+============
+
+Per-object memory accounting. Large objects (tensor potentials, basis pair
+lists, preconditioner blocks, eigenpairs, Coulomb waves, ...) register their
+size in a category with the process wide ledger. The ledger keeps live and
+peak bytes per category and a list of the largest live objects, which can be
+written to the log and to the output HDF5 file.
+
+Entries registered with an owner object are released automatically when the
+owner is garbage collected (if the owner supports weak references).
+
+Example
+-------
+>>> ledger = GetMemoryLedger()
+>>> ledger.Register("TensorPotential", "CoulombPotential", pot.PotentialData.nbytes, owner=pot)
+>>> ledger.LogReport()
+
+"""
+import weakref
+import pyprop
+from pyprop.pyproplogging import GetClassLogger
+from utils import RegisterAll
+
+
+@RegisterAll
+class MemoryLedger(object):
+	"""
+	Ledger of live and peak allocation sizes per category.
+	"""
+
+	def __init__(self):
+		self.Logger = GetClassLogger(self)
+		self.Entries = {}
+		self.Live = {}
+		self.Peak = {}
+		self.TotalLive = 0
+		self.TotalPeak = 0
+		self._NextKey = 0
+		self._OwnerRefs = {}
+
+	def Register(self, category, name, nbytes, owner=None):
+		"""
+		key = Register(category, name, nbytes, owner)
+
+		Register an allocation of nbytes in category. Returns a key to be
+		passed to Release(). If owner is given, the entry is released when
+		owner is garbage collected.
+		"""
+		key = self._NextKey
+		self._NextKey += 1
+		nbytes = int(nbytes)
+		self.Entries[key] = (category, name, nbytes)
+
+		self.Live[category] = self.Live.get(category, 0) + nbytes
+		self.Peak[category] = max(self.Peak.get(category, 0), self.Live[category])
+		self.TotalLive += nbytes
+		self.TotalPeak = max(self.TotalPeak, self.TotalLive)
+
+		if owner is not None:
+			try:
+				self._OwnerRefs[key] = weakref.ref(owner, lambda ref: self.Release(key))
+			except TypeError:
+				pass
+		return key
+
+	def RegisterArrays(self, category, name, arrays, owner=None):
+		"""
+		Register the total size of a list of numpy arrays (None is ignored)
+		"""
+		nbytes = sum([getattr(a, "nbytes", 0) for a in arrays if a is not None])
+		return self.Register(category, name, nbytes, owner)
+
+	def Release(self, key):
+		"""
+		Release an entry returned by Register(). Releasing an entry twice
+		is a no-op.
+		"""
+		if not key in self.Entries:
+			return
+		category, name, nbytes = self.Entries.pop(key)
+		self._OwnerRefs.pop(key, None)
+		self.Live[category] -= nbytes
+		self.TotalLive -= nbytes
+
+	def GetTopConsumers(self, count=10):
+		"""
+		Returns the count largest live entries as (nbytes, category, name)
+		"""
+		entries = [(nbytes, category, name) for category, name, nbytes in self.Entries.itervalues()]
+		entries.sort(reverse=True)
+		return entries[:count]
+
+	def FormatReport(self, topCount=10):
+		MB = 1024.**2
+		lines = ["Memory ledger: live %.1f MB, peak %.1f MB" % (self.TotalLive / MB, self.TotalPeak / MB)]
+		lines.append("  %-30s %12s %12s" % ("Category", "Live (MB)", "Peak (MB)"))
+		for category in sorted(self.Peak.keys(), key=lambda c: -self.Peak[c]):
+			lines.append("  %-30s %12.1f %12.1f" % (category, self.Live[category] / MB, self.Peak[category] / MB))
+		lines.append("  Top consumers:")
+		for nbytes, category, name in self.GetTopConsumers(topCount):
+			lines.append("  %12.1f MB  %s (%s)" % (nbytes / MB, name, category))
+		return "\n".join(lines)
+
+	def LogReport(self, topCount=10):
+		self.Logger.info(self.FormatReport(topCount))
+
+	def SaveReport(self, h5file, groupName="MemoryLedger", topCount=10):
+		"""
+		Store the ledger in the open HDF5 file h5file (pytables), in the group
+		groupName, replacing an existing group of the same name.
+		"""
+		if groupName in h5file.root:
+			h5file.removeNode(h5file.root, groupName, recursive=True)
+		group = h5file.createGroup("/", groupName)
+
+		categories = sorted(self.Peak.keys())
+		if len(categories) > 0:
+			h5file.createArray(group, "Categories", categories)
+			h5file.createArray(group, "LiveBytes", [self.Live[c] for c in categories])
+			h5file.createArray(group, "PeakBytes", [self.Peak[c] for c in categories])
+		top = self.GetTopConsumers(topCount)
+		if len(top) > 0:
+			h5file.createArray(group, "TopConsumerNames", ["%s (%s)" % (name, cat) for nbytes, cat, name in top])
+			h5file.createArray(group, "TopConsumerBytes", [nbytes for nbytes, cat, name in top])
+		h5file.setNodeAttr(group, "TotalLiveBytes", self.TotalLive)
+		h5file.setNodeAttr(group, "TotalPeakBytes", self.TotalPeak)
+
+
+_Ledger = MemoryLedger()
+
+@RegisterAll
+def GetMemoryLedger():
+	"""
+	Returns the process wide memory ledger
+	"""
+	return _Ledger
+
+
+@RegisterAll
+def RegisterTensorPotential(potential, name=None, category="TensorPotential"):
+	"""
+	Register the potential data and basis pair lists of a pyprop
+	TensorPotential with the memory ledger
+	"""
+	ledger = GetMemoryLedger()
+	if name == None:
+		name = getattr(potential, "Name", "TensorPotential")
+	ledger.Register(category, name, potential.PotentialData.nbytes, owner=potential)
+	basisPairs = getattr(potential, "BasisPairs", [])
+	ledger.RegisterArrays("BasisPairs", name, basisPairs, owner=potential)
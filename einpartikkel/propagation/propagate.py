@@ -9,8 +9,18 @@ evolution of the specified system.
 
 """
 
+from __future__ import with_statement
+import os.path
+import tables
 import pyprop
 from pyprop.pyproplogging import GetClassLogger
+from ..instrumentation import IsInstrumentationEnabled, FormatInstrumentationReport
+from ..memoryledger import GetMemoryLedger, RegisterTensorPotential
+from ..core.layout import ApplyWavefunctionLayout
+from ..core.memoryplacement import ApplyMemoryPlacement
+from ..core.bufferpool import GetDefaultBufferPool
+from ..core.overlap import InvalidateOverlap
+from ..core.laserpulse import ApplyNativeLaserFunctions
 
 class Propagate:
 	"""
@@ -27,8 +37,17 @@ class Propagate:
 		self.NumberOfCallbacks = numberOfCallbacks
 
 		#setup Pyprop problem from config
+		ApplyWavefunctionLayout(self.Config)
+		ApplyNativeLaserFunctions(self.Config)
 		self.Problem = pyprop.Problem(self.Config)
 		self.Problem.SetupStep()
+		for pot in self.Problem.Propagator.BasePropagator.PotentialList:
+			RegisterTensorPotential(pot)
+
+		#NUMA placement and huge pages of the wavefunction and potentials
+		self.MemoryPlacement = None
+		if hasattr(self.Config, "MemoryPlacement"):
+			self.MemoryPlacement = ApplyMemoryPlacement(self.Problem, self.Config.MemoryPlacement)
 
 		self.PreProcessed = False
 		
@@ -38,8 +57,8 @@ class Propagate:
 			task.setupTask(self.Problem)
 
 		#Calculate intial state energy
-		tmpPsi = self.Problem.psi.Copy()
-		en = self.GetEnergyExpectationValue(self.Problem.psi, tmpPsi).real
+		with GetDefaultBufferPool().Buffer(self.Problem.psi) as tmpPsi:
+			en = self.GetEnergyExpectationValue(self.Problem.psi, tmpPsi).real
 		self.Logger.info("Initial state energy = %s" % en)
 
 		self.PreProcessed = True
@@ -47,11 +66,31 @@ class Propagate:
 	def run(self):
 		"""
 		Propagate problem until end time.
+
+		Tasks providing a native task list (GetNativeTaskList(), e.g.
+		NativeObservables) are stepped at every time step, with one native
+		call per task list. The python callbacks are still run 
+		NumberOfCallbacks times.
 		"""
 		assert (self.PreProcessed)
-		for t in self.Problem.Advance(self.NumberOfCallbacks):
-			for task in self.PropagationTasks:
-				task.callback(self.Problem)
+		nativeTaskLists = [task.GetNativeTaskList() for task in self.PropagationTasks \
+			if hasattr(task, "GetNativeTaskList")]
+
+		if len(nativeTaskLists) == 0:
+			for t in self.Problem.Advance(self.NumberOfCallbacks):
+				InvalidateOverlap(self.Problem.psi)
+				for task in self.PropagationTasks:
+					task.callback(self.Problem)
+		else:
+			callbackInterval = self.GetCallbackInterval()
+			for step, t in enumerate(self.Problem.Advance(True)):
+				InvalidateOverlap(self.Problem.psi)
+				data = self.Problem.psi.GetData()
+				for taskList in nativeTaskLists:
+					taskList.Step(t, data)
+				if step % callbackInterval == 0:
+					for task in self.PropagationTasks:
+						task.callback(self.Problem)
 		
 		#run postprocessing
 		self.postProcess()
@@ -64,6 +103,31 @@ class Propagate:
 		for task in self.PropagationTasks:
 			task.postProcess(self.Problem)
 
+		#Memory ledger to log and output file
+		ledger = GetMemoryLedger()
+		ledger.LogReport()
+		GetDefaultBufferPool().LogReport()
+		outputFile = getattr(getattr(self.Config, "Names", None), "output_file_name", "")
+		if self.MemoryPlacement != None:
+			self.MemoryPlacement.LogReport()
+		if pyprop.ProcId == 0 and os.path.isfile(outputFile):
+			with tables.openFile(outputFile, "a") as h5file:
+				ledger.SaveReport(h5file)
+				if self.MemoryPlacement != None:
+					self.MemoryPlacement.SaveReport(h5file)
+
+		if IsInstrumentationEnabled():
+			self.Logger.info("Instrumentation report:\n%s" % FormatInstrumentationReport())
+
+
+	def GetCallbackInterval(self):
+		"""
+		Number of time steps between python callbacks when stepping every
+		time step
+		"""
+		stepCount = self.Problem.Duration / abs(self.Config.Propagation.timestep)
+		return max(1, int(round(stepCount / max(self.NumberOfCallbacks, 1))))
+
 
 	def GetEnergyExpectationValue(self, psi, tmpPsi):
 		"""
@@ -20,8 +20,16 @@ import pypar
 import pyprop
 from pyprop import PrintOut
 from pyprop.pyproplogging import GetClassLogger, GetFunctionLogger
+from numpy import where
 from ..utils import RegisterAll
 from ..eigenvalues import eigenvalues
+from ..eigenvalues import hydrogenic
+from ..analysis.boundstates import CreateBoundStateProjector
+from ..analysis.above import NativeTaskList
+from ..core.overlap import OverlapInnerProduct, InvalidateOverlap, ReleaseOverlap
+from ..core.bufferpool import GetDefaultBufferPool
+from ..core.layout import GetAngularRepresentation, GetAngularMajorData, RequireAngularMajor
+from ..memoryledger import GetMemoryLedger
 
 
 def CreatePath(absFileName):
@@ -69,7 +77,7 @@ class ProgressReport(PropagationTask):
 	def setupTask(self, prop):
 		self.Logger.info("Setting up task...")
 		self.StartTime = time.time()
-		self.InitialPsi = prop.psi.Copy()
+		self.InitialPsi = GetDefaultBufferPool().Checkout(prop.psi, copyData=True)
 	
 		#check if output dir exist, create if not
 		if self.StoreProgressInfo:
@@ -85,7 +93,7 @@ class ProgressReport(PropagationTask):
 		t = prop.PropagatedTime
 		T = prop.Duration + prop.StartTime
 		norm = prop.psi.GetNorm()
-		corr = abs(prop.psi.InnerProduct(self.InitialPsi))**2
+		corr = abs(OverlapInnerProduct(prop.psi, self.InitialPsi))**2
 		eta = self.__EstimateETA(prop)
 		self.ProgressItems["SampleTimes"] += [t]
 		self.ProgressItems["Norm"] += [norm]
@@ -98,6 +106,10 @@ class ProgressReport(PropagationTask):
 		"""
 		Store problem information collected during propagation
 		"""
+		ReleaseOverlap(self.InitialPsi)
+		GetDefaultBufferPool().Return(self.InitialPsi)
+		self.InitialPsi = None
+
 		if self.StoreProgressInfo and (pyprop.ProcId == 0):
 			with tables.openFile(self.OutputFileName, "a") as h5file:
 				for itemName, itemVal in self.ProgressItems.iteritems():
@@ -191,14 +203,27 @@ class ComputeAtomicInitialState(PropagationTask):
 	Diagonalize problem hamiltonian to determine eigenstates, and then
 	set initial wavefunction to one of these eigenstates.
 
+	With targeted=True, only the requested eigenpair is computed, by
+	inertia counting and Rayleigh quotient iteration on the banded radial
+	matrices (eigenvalues.SetupRadialEigenpair), which scales to large
+	radial grids.
+
 	"""
 
-	def __init__(self, initialStateQuantumNumbers):
+	def __init__(self, initialStateQuantumNumbers, targeted=False):
 		self.QuantumNumbers = initialStateQuantumNumbers
+		self.Targeted = targeted
 
 	def setupTask(self, prop):
 		"""Calculate bound state and set prop.psi equal specified one.
 		"""
+		if self.Targeted:
+			E, x, angIdx = eigenvalues.SetupRadialEigenpair(prop, self.QuantumNumbers, potentialIndices=[0])
+			prop.psi.GetData()[:] = 0
+			GetAngularMajorData(prop.psi)[angIdx, :] = x
+			InvalidateOverlap(prop.psi)
+			return
+
 		E, V, angIdxList, lmIdxList = eigenvalues.SetupRadialEigenstates(prop, potentialIndices=[0], mList=[self.QuantumNumbers.m])
 		eigenvalues.SetRadialEigenstate(prop.psi, V, angIdxList, self.QuantumNumbers)
 
@@ -209,3 +234,208 @@ class ComputeAtomicInitialState(PropagationTask):
 		pass
 
 
+@RegisterAll
+class ComputeHydrogenicInitialState(PropagationTask):
+	"""
+	Set initial wavefunction to an analytic hydrogenic state projected on
+	the B-spline basis, avoiding the diagonalisation done by
+	ComputeAtomicInitialState. With polish=True the projection is refined
+	by one banded inverse iteration step against the potentials given by
+	potentialIndices.
+
+	"""
+
+	def __init__(self, initialStateQuantumNumbers, charge=1.0, polish=True, potentialIndices=[0]):
+		self.QuantumNumbers = initialStateQuantumNumbers
+		self.Charge = charge
+		self.Polish = polish
+		self.PotentialIndices = potentialIndices
+
+	def setupTask(self, prop):
+		hydrogenic.SetHydrogenicState(prop, self.QuantumNumbers, self.Charge, \
+			self.Polish, self.PotentialIndices)
+
+	def callback(self, prop):
+		pass
+
+	def postProcess(self, prop):
+		pass
+
+
+@RegisterAll
+class IonizationYield(PropagationTask):
+	"""
+	Track bound state population and ionization yield (total probability 
+	minus bound population) at each callback, and store them in a HDF5-file 
+	when finished.
+
+	The bound states are found by diagonalizing the radial Hamiltonian for
+	each l (as in ComputeAtomicInitialState), and are applied with the native
+	BoundStateProjector, so each callback costs two matrix-vector products 
+	per angular index.
+	"""
+
+	def __init__(self, boundThreshold=0.0, potentialIndices=[0], storeInfo=True):
+		self.BoundThreshold = boundThreshold
+		self.PotentialIndices = potentialIndices
+		self.StoreInfo = storeInfo
+		self.Logger = GetClassLogger(self)
+		self.Projector = None
+		self.YieldItems = {}
+
+	def setupTask(self, prop):
+		self.Logger.info("Setting up task...")
+		self.Projector = CreateBoundProjectorForProblem(prop, self.BoundThreshold, \
+			self.PotentialIndices)
+
+		if self.StoreInfo:
+			self.OutputFileName = prop.Config.Names.output_file_name
+			CreatePath(self.OutputFileName)
+
+		self.YieldItems["IonizationSampleTimes"] = []
+		self.YieldItems["BoundPopulation"] = []
+		self.YieldItems["IonizationYield"] = []
+
+	def callback(self, prop):
+		bound = self.Projector.GetBoundPopulation(prop.psi.GetData())
+		total = prop.psi.InnerProduct(prop.psi).real
+		self.YieldItems["IonizationSampleTimes"] += [prop.PropagatedTime]
+		self.YieldItems["BoundPopulation"] += [bound]
+		self.YieldItems["IonizationYield"] += [total - bound]
+
+	def postProcess(self, prop):
+		"""
+		Store bound population and ionization yield collected during propagation
+		"""
+		if self.StoreInfo and (pyprop.ProcId == 0):
+			with tables.openFile(self.OutputFileName, "a") as h5file:
+				for itemName, itemVal in self.YieldItems.iteritems():
+					if itemName in h5file.root:
+						h5file.removeNode(h5file.root, itemName, recursive=True)
+					h5file.createArray("/", itemName, itemVal)
+
+
+def CreateBoundProjectorForProblem(prop, boundThreshold, potentialIndices):
+	"""
+	Create a BoundStateProjector on the states of prop below boundThreshold.
+
+	The bound states are found by diagonalizing the radial Hamiltonian
+	(the potentials potentialIndices) for each l.
+	"""
+	RequireAngularMajor(prop.psi, "The bound state projector")
+
+	#The radial Hamiltonian does not depend on m, so the m with smallest
+	#|m| gives bound states for all l in the basis
+	angRange = GetAngularRepresentation(prop.psi).Range
+	angularCount = prop.psi.GetData().shape[0]
+	lmList = [angRange.GetLmIndex(i) for i in range(angularCount)]
+	m0 = min([lm.m for lm in lmList], key=abs)
+	E, V, angIdxList, lmIdxList = eigenvalues.SetupRadialEigenstates(prop, \
+		potentialIndices=potentialIndices, mList=[m0])
+
+	#Keep states below threshold, one (radial x bound) block per l
+	lStates = {}
+	for curE, curV, lmIdx in zip(E, V, lmIdxList):
+		idx = where(curE < boundThreshold)[0]
+		lStates[lmIdx.l] = curV[:, idx]
+	angularStates = [lStates.get(lm.l, None) for lm in lmList]
+	return CreateBoundStateProjector(prop.psi, angularStates)
+
+
+@RegisterAll
+class NativeObservables(PropagationTask):
+	"""
+	Observables evaluated natively at every time step, through one call to
+	a NativeTaskList per step (see Propagate.run). Python tasks are still
+	called back numberOfCallbacks times.
+
+	Available observables are the norm (expectation value of the overlap
+	potential), the bound state population, and expectation values of the
+	potentials in the given config sections (e.g. the dipole moment from the
+	static part of a laser potential). The values are buffered natively and 
+	stored in the output file when the propagation is finished, as 
+	"NativeSampleTimes" and "Native<name>" for each observable.
+
+	Parametres
+	----------
+	norm:             (bool) track <psi|S|psi>
+	boundPopulation:  (bool) track the bound state population
+	potentials:       (list) names of potential config sections to track
+	boundThreshold:   (float) energy threshold of the bound states
+	potentialIndices: (list) potentials defining the bound states
+	storeInfo:        (bool) store results in the output file
+	"""
+
+	def __init__(self, norm=True, boundPopulation=False, potentials=[], \
+			boundThreshold=0.0, potentialIndices=[0], storeInfo=True):
+		self.Norm = norm
+		self.BoundPopulation = boundPopulation
+		self.Potentials = potentials
+		self.BoundThreshold = boundThreshold
+		self.PotentialIndices = potentialIndices
+		self.StoreInfo = storeInfo
+		self.Logger = GetClassLogger(self)
+		self.TaskList = None
+		self.Projector = None
+
+	def setupTask(self, prop):
+		self.Logger.info("Setting up task...")
+		if not pyprop.IsSingleProc():
+			raise Exception("NativeObservables works only on a single processor")
+		RequireAngularMajor(prop.psi, "NativeObservables")
+
+		self.TaskList = NativeTaskList()
+		sections = []
+		if self.Norm:
+			sections.append(("Norm", prop.Config.OverlapPotential))
+		sections += [(name, getattr(prop.Config, name)) for name in self.Potentials]
+		for name, section in sections:
+			potential = prop.Propagator.BasePropagator.GeneratePotential(section)
+			potential.SetupStep(0.)
+			self.TaskList.AddTensorExpectationTask(name, potential.PotentialData, \
+				potential.BasisPairs[0], potential.BasisPairs[1])
+			del potential
+
+		if self.BoundPopulation:
+			self.Projector = CreateBoundProjectorForProblem(prop, self.BoundThreshold, \
+				self.PotentialIndices)
+			self.TaskList.AddBoundPopulationTask("BoundPopulation", self.Projector)
+
+		angularCount, radialCount = prop.psi.GetData().shape
+		stepCount = int(round(prop.Duration / abs(prop.Config.Propagation.timestep))) + 1
+		self.TaskList.Setup(angularCount, radialCount, stepCount)
+		GetMemoryLedger().Register("NativeObservables", "Result buffers", \
+			16 * stepCount * (self.TaskList.GetTaskCount() + 1), owner=self.TaskList)
+
+		if self.StoreInfo:
+			self.OutputFileName = prop.Config.Names.output_file_name
+			CreatePath(self.OutputFileName)
+
+	def GetNativeTaskList(self):
+		return self.TaskList
+
+	def callback(self, prop):
+		pass
+
+	def GetResults(self):
+		"""
+		Returns a dict of name -> array of values, and "NativeSampleTimes"
+		"""
+		results = {"NativeSampleTimes": self.TaskList.GetSampleTimes()}
+		for i in range(self.TaskList.GetTaskCount()):
+			results["Native%s" % self.TaskList.GetTaskName(i)] = self.TaskList.GetResults(i)
+		return results
+
+	def postProcess(self, prop):
+		"""
+		Store the buffered observables
+		"""
+		self.TaskList.PostProcess()
+		self.Logger.info("Evaluated %i native observables at %i time steps" % \
+			(self.TaskList.GetTaskCount(), self.TaskList.GetSampleCount()))
+		if self.StoreInfo and (pyprop.ProcId == 0):
+			with tables.openFile(self.OutputFileName, "a") as h5file:
+				for itemName, itemVal in self.GetResults().iteritems():
+					if itemName in h5file.root:
+						h5file.removeNode(h5file.root, itemName, recursive=True)
+					h5file.createArray("/", itemName, itemVal)
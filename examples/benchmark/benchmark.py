@@ -0,0 +1,257 @@
+"""
+End-to-end benchmark of the propagation workflow.
+
+Runs the simple_propagation and h2pluss configurations at several sizes, and
+records for each phase the wall time, the current RSS at its start and end
+(rss_start_mb, rss_end_mb) and the peak RSS of the process so far at its
+end (cumulative_peak_rss_mb):
+
+	setup                 pyprop.Problem construction
+	potential_generation  all tensor potentials (GeneratePotential), 
+	                      including those of the preconditioner
+	preconditioner        RadialPreconditioner.Setup, excluding potentials
+	initial_state         ComputeAtomicInitialState
+	propagation           a fixed number of time steps (steps/s reported)
+	analysis              bound state projection (IonizationYield)
+
+The peak RSS only grows, so cumulative_peak_rss_mb of a phase includes the
+earlier phases; the memory used by a phase is rss_end_mb - rss_start_mb.
+Each benchmark point is run in a separate process, so the peak RSS of one
+point is not polluted by the previous ones.
+
+Usage:
+	python benchmark.py [--output results.json] [--baseline baseline.json]
+	                    [--threshold 0.1] [--steps 100] [--only simple_propagation]
+
+Comparing against a baseline exits with status 1 if any phase is slower
+(or the propagation rate lower) by more than the threshold (relative).
+"""
+import sys
+import os
+import imp
+import time
+import resource
+import subprocess
+import optparse
+try:
+	import json
+except ImportError:
+	import simplejson as json
+sys.path.append(os.path.join(os.path.dirname(os.path.abspath(__file__)), "../.."))
+
+BenchmarkDir = os.path.dirname(os.path.abspath(__file__))
+ExamplesDir = os.path.dirname(BenchmarkDir)
+
+#name : (example directory, config file, [(lmax, xsize), ...])
+BenchmarkCases = {
+	"simple_propagation": ("simple_propagation", "config.ini", [(5, 20), (10, 40), (20, 80)]),
+	"h2pluss": ("h2pluss", "groundstate.ini", [(8, 20), (16, 40)]),
+}
+
+Phases = ["setup", "potential_generation", "preconditioner", "initial_state", \
+	"propagation", "analysis"]
+
+
+def GetPeakRss():
+	"""Peak resident set size of this process so far in MB"""
+	return resource.getrusage(resource.RUSAGE_SELF).ru_maxrss / 1024.
+
+
+def GetCurrentRss():
+	"""
+	Current resident set size of this process in MB (/proc/self/statm),
+	or None if not available
+	"""
+	try:
+		residentPages = int(open("/proc/self/statm").read().split()[1])
+	except (IOError, IndexError, ValueError):
+		return None
+	return residentPages * resource.getpagesize() / 1024.**2
+
+
+class PhaseRecorder:
+	"""
+	Records wall time and RSS of benchmark phases. Time spent in nested
+	phases is not counted in the enclosing phase. A phase entered several
+	times has the RSS at its first start and its last end.
+	"""
+	def __init__(self):
+		self.Results = dict([(p, {"time": 0.0, "rss_start_mb": None, "rss_end_mb": None, \
+			"cumulative_peak_rss_mb": None}) for p in Phases])
+		self.Stack = []
+
+	def Start(self, phase):
+		now = time.time()
+		if self.Results[phase]["rss_start_mb"] == None:
+			self.Results[phase]["rss_start_mb"] = GetCurrentRss()
+		if len(self.Stack) > 0:
+			outerPhase, outerStart = self.Stack[-1]
+			self.Results[outerPhase]["time"] += now - outerStart
+		self.Stack.append((phase, now))
+
+	def Stop(self):
+		now = time.time()
+		phase, start = self.Stack.pop()
+		self.Results[phase]["time"] += now - start
+		self.Results[phase]["rss_end_mb"] = GetCurrentRss()
+		self.Results[phase]["cumulative_peak_rss_mb"] = GetPeakRss()
+		if len(self.Stack) > 0:
+			self.Stack[-1] = (self.Stack[-1][0], now)
+
+	def Wrap(self, cls, methodName, phase):
+		"""Record the time spent in cls.methodName as phase"""
+		method = getattr(cls, methodName)
+		recorder = self
+		def wrapped(*args, **kwargs):
+			recorder.Start(phase)
+			try:
+				return method(*args, **kwargs)
+			finally:
+				recorder.Stop()
+		setattr(cls, methodName, wrapped)
+
+
+def RunSingle(name, lmax, xsize, stepCount):
+	"""
+	Run one benchmark point in this process, and return the result dict
+	"""
+	exampleDir, configFile, sizes = BenchmarkCases[name]
+	os.chdir(os.path.join(ExamplesDir, exampleDir))
+
+	import pyprop
+	import einpartikkel
+	from einpartikkel.propagation.propagate import Propagate
+	from einpartikkel.propagation.tasks import ComputeAtomicInitialState, IonizationYield
+	from einpartikkel import quantumnumbers
+	from einpartikkel.core.indexiterators import DefaultLmIndexIterator
+	from einpartikkel.core.preconditioner import RadialPreconditioner
+	from einpartikkel.utils import UpdatePypropProjectNamespace
+
+	#Laser functions referenced by the config files
+	imp.load_source("benchmark_example_%s" % name, "example.py")
+	UpdatePypropProjectNamespace(pyprop.ProjectNamespace)
+
+	recorder = PhaseRecorder()
+	recorder.Wrap(pyprop.BasisPropagator, "GeneratePotential", "potential_generation")
+	recorder.Wrap(RadialPreconditioner, "Setup", "preconditioner")
+
+	conf = pyprop.Load(configFile)
+	conf.SetValue("AngularRepresentation", "index_iterator", DefaultLmIndexIterator(lmax))
+	conf.SetValue("RadialRepresentation", "xsize", xsize)
+	conf.SetValue("Names", "output_file_name", "/dev/null")
+	timestep = conf.Propagation.timestep
+	conf.SetValue("Propagation", "duration", abs(timestep) * stepCount)
+	conf.SetValue("Propagation", "renormalization", False)
+
+	#Problem setup, potential and preconditioner generation
+	recorder.Start("setup")
+	initialState = ComputeAtomicInitialState(quantumnumbers.HydrogenicQuantumNumbers(1, 0, 0))
+	prop = Propagate(conf, [initialState], stepCount)
+	recorder.Stop()
+
+	recorder.Start("initial_state")
+	prop.preprocess()
+	recorder.Stop()
+
+	recorder.Start("propagation")
+	prop.run()
+	recorder.Stop()
+
+	recorder.Start("analysis")
+	analysis = IonizationYield(storeInfo=False)
+	analysis.setupTask(prop.Problem)
+	analysis.callback(prop.Problem)
+	recorder.Stop()
+
+	propagationTime = recorder.Results["propagation"]["time"]
+	return {
+		"name": name,
+		"lmax": lmax,
+		"xsize": xsize,
+		"steps": stepCount,
+		"steps_per_second": stepCount / max(propagationTime, 1e-12),
+		"cumulative_peak_rss_mb": GetPeakRss(),
+		"phases": recorder.Results,
+	}
+
+
+def RunAll(cases, stepCount):
+	"""
+	Run all benchmark points, each in a separate process
+	"""
+	results = []
+	for name in cases:
+		for lmax, xsize in BenchmarkCases[name][2]:
+			print >> sys.stderr, "Running %s, lmax = %i, xsize = %i" % (name, lmax, xsize)
+			cmd = [sys.executable, os.path.abspath(__file__), "--single", \
+				"%s,%i,%i" % (name, lmax, xsize), "--steps", str(stepCount)]
+			proc = subprocess.Popen(cmd, stdout=subprocess.PIPE)
+			output = proc.communicate()[0]
+			if proc.returncode != 0:
+				raise RuntimeError("Benchmark %s (lmax = %i, xsize = %i) failed" % (name, lmax, xsize))
+			results.append(json.loads(output.strip().split("\n")[-1]))
+	return results
+
+
+def GetResultKey(result):
+	return (result["name"], result["lmax"], result["xsize"])
+
+
+def CompareToBaseline(results, baseline, threshold):
+	"""
+	Compare results to baseline, return list of regressions as strings.
+	A phase regresses if it is more than threshold (relative) slower.
+	"""
+	baselineResults = dict([(GetResultKey(r), r) for r in baseline["results"]])
+	regressions = []
+	for result in results:
+		key = GetResultKey(result)
+		if not key in baselineResults:
+			continue
+		base = baselineResults[key]
+		for phase in Phases:
+			cur = result["phases"][phase]["time"]
+			ref = base["phases"][phase]["time"]
+			if ref > 0 and cur > ref * (1 + threshold):
+				regressions.append("%s %s: %.3fs -> %.3fs (+%.0f%%)" % (key, phase, ref, cur, 100 * (cur / ref - 1)))
+		cur = result["steps_per_second"]
+		ref = base["steps_per_second"]
+		if cur < ref / (1 + threshold):
+			regressions.append("%s steps/s: %.2f -> %.2f" % (key, ref, cur))
+	return regressions
+
+
+if __name__ == "__main__":
+	parser = optparse.OptionParser()
+	parser.add_option("--output", default="benchmark_results.json")
+	parser.add_option("--baseline", default=None)
+	parser.add_option("--threshold", type="float", default=0.1)
+	parser.add_option("--steps", type="int", default=100)
+	parser.add_option("--only", default=None, help="comma separated list of cases")
+	parser.add_option("--single", default=None, help=optparse.SUPPRESS_HELP)
+	options, args = parser.parse_args()
+
+	if options.single != None:
+		name, lmax, xsize = options.single.split(",")
+		result = RunSingle(name, int(lmax), int(xsize), options.steps)
+		sys.stdout.flush()
+		print json.dumps(result)
+		sys.exit(0)
+
+	cases = sorted(BenchmarkCases.keys())
+	if options.only != None:
+		cases = options.only.split(",")
+	results = RunAll(cases, options.steps)
+
+	f = open(options.output, "w")
+	json.dump({"benchmark": "propagation", "threshold": options.threshold, "results": results}, f, indent=1)
+	f.close()
+
+	if options.baseline != None:
+		baseline = json.load(open(options.baseline))
+		regressions = CompareToBaseline(results, baseline, options.threshold)
+		for r in regressions:
+			print "REGRESSION %s" % r
+		if len(regressions) > 0:
+			sys.exit(1)
+		print "No regressions compared to %s" % options.baseline
@@ -11,6 +11,7 @@ from einpartikkel import quantumnumbers
 
 import einpartikkel.core.indexiterators
 import einpartikkel.core.preconditioner
+import einpartikkel.core.laserpulse
 from einpartikkel.utils import UpdatePypropProjectNamespace
 UpdatePypropProjectNamespace(pyprop.ProjectNamespace)
 
@@ -97,6 +98,32 @@ def LaserFunctionSimpleLength_Z(conf, t):
 	return LaserFunctionSimpleLength(conf, t)
 
 
+#Non-dipole laser functions for a plane wave along x (see config.ini)
+SpeedOfLight = 137.036
+
+def LaserFunctionNonDipoleVelocity(conf, t):
+	"""
+		Electric field over c, the time dependence of the first order
+		non-dipole velocity gauge coupling
+	"""
+	return LaserFunctionSimpleLength(conf, t) / SpeedOfLight
+
+def LaserFunctionNonDipoleA2(conf, t, trig):
+	if 0 <= t < conf.pulse_duration:
+		envelope = sin(t * pi / conf.pulse_duration)**2
+		curField = -(conf.amplitude / conf.frequency * envelope)**2 / 4
+		curField *= trig(2 * (conf.frequency * t + conf.phase))
+	else:
+		curField = 0
+	return curField
+
+def LaserFunctionNonDipoleCos(conf, t):
+	return LaserFunctionNonDipoleA2(conf, t, cos)
+
+def LaserFunctionNonDipoleSin(conf, t):
+	return LaserFunctionNonDipoleA2(conf, t, sin)
+
+
 #Put laser function in pyprop project namespace so that config files are
 #loaded properly.
 pyprop.ProjectNamespace["LaserFunctionSimpleVelocity_X"] = LaserFunctionSimpleVelocity_X
@@ -105,3 +132,6 @@ pyprop.ProjectNamespace["LaserFunctionSimpleVelocity_Z"] = LaserFunctionSimpleVe
 pyprop.ProjectNamespace["LaserFunctionSimpleLength_X"] = LaserFunctionSimpleLength_X
 pyprop.ProjectNamespace["LaserFunctionSimpleLength_Y"] = LaserFunctionSimpleLength_Y
 pyprop.ProjectNamespace["LaserFunctionSimpleLength_Z"] = LaserFunctionSimpleLength_Z
+pyprop.ProjectNamespace["LaserFunctionNonDipoleVelocity"] = LaserFunctionNonDipoleVelocity
+pyprop.ProjectNamespace["LaserFunctionNonDipoleCos"] = LaserFunctionNonDipoleCos
+pyprop.ProjectNamespace["LaserFunctionNonDipoleSin"] = LaserFunctionNonDipoleSin
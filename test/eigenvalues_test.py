@@ -0,0 +1,82 @@
+import sys
+import unittest
+sys.path.append("..")
+from numpy import zeros, diag, diagonal, eye, dot, linspace, array
+from numpy.random import RandomState
+import scipy.linalg
+
+
+def GetUpperBandedMatrix(matrix, bandwidth):
+	"""Upper symmetric banded storage, banded[bandwidth - k, j] = matrix[j - k, j]"""
+	size = matrix.shape[0]
+	banded = zeros((bandwidth + 1, size))
+	for k in range(bandwidth + 1):
+		banded[bandwidth - k, k:] = diagonal(matrix, k)
+	return banded
+
+
+class TestBandedEigenpair(unittest.TestCase):
+	"""
+	Test the inertia counts and the single eigenpair solver of the banded 
+	generalized eigenvalue problem against a full diagonalization
+	"""
+
+	def setUp(self):
+		eigenvalues = __import__("einpartikkel.eigenvalues.eigenvalues", fromlist=["eigenvalues"])
+		self.GetBandedInertia = eigenvalues.GetBandedInertia
+		self.FindBandedEigenpair = eigenvalues.FindBandedEigenpair
+
+		#Random symmetric banded H, and banded S diagonally dominant
+		#(positive definite)
+		size = 60
+		self.Bandwidth = 3
+		random = RandomState(1)
+		self.H = zeros((size, size))
+		self.S = 2 * eye(size)
+		for k in range(self.Bandwidth + 1):
+			h = random.standard_normal(size - k)
+			s = 0.1 * random.standard_normal(size - k)
+			self.H += diag(h, k)
+			self.S += diag(s, k)
+			if k > 0:
+				self.H += diag(h, -k)
+				self.S += diag(s, -k)
+		self.Energies = scipy.linalg.eigh(self.H, self.S, eigvals_only=True)
+		self.HBanded = GetUpperBandedMatrix(self.H, self.Bandwidth)
+		self.SBanded = GetUpperBandedMatrix(self.S, self.Bandwidth)
+
+	def GetCount(self, shift):
+		return int((self.Energies < shift).sum())
+
+	def test_inertia_scalar_shift(self):
+		for shift in [-10., -1.3, 0., 0.7, 10.]:
+			count = self.GetBandedInertia(self.HBanded, self.SBanded, shift)
+			self.assertEqual(count, self.GetCount(shift))
+
+	def test_inertia_shift_sequence(self):
+		shifts = linspace(-2, 2, 9)
+		counts = self.GetBandedInertia(self.HBanded, self.SBanded, shifts)
+		self.assertEqual(list(counts), [self.GetCount(shift) for shift in shifts])
+
+	def test_inertia_shift_on_eigenvalue(self):
+		#A zero pivot must not break the factorization, the count is that
+		#of a shift just above or below
+		shift = self.Energies[10]
+		count = self.GetBandedInertia(self.HBanded, self.SBanded, shift)
+		self.assert_(count in [10, 11])
+
+	def test_find_eigenpair(self):
+		for radialIndex in [0, 7, 30, 59]:
+			E, x = self.FindBandedEigenpair(self.HBanded, self.SBanded, radialIndex)
+			self.assertAlmostEqual(E, self.Energies[radialIndex], places=9)
+			self.assertAlmostEqual(dot(x, dot(self.S, x)), 1.0, places=9)
+			residual = dot(self.H, x) - E * dot(self.S, x)
+			self.assert_(max(abs(residual)) < 1e-8)
+
+	def test_find_eigenpair_energy_guess(self):
+		E, x = self.FindBandedEigenpair(self.HBanded, self.SBanded, 20, energyGuess=-5.0)
+		self.assertAlmostEqual(E, self.Energies[20], places=9)
+
+
+if __name__ == "__main__":
+	unittest.main()
@@ -0,0 +1,72 @@
+import sys
+import unittest
+sys.path.append("..")
+from numpy import dot, zeros
+
+
+class TestGaussLobattoQuadrature(unittest.TestCase):
+	"""
+	Test the Gauss-Lobatto-Legendre nodes, weights and Lagrange derivative
+	matrix of the FEDVR basis
+	"""
+
+	def setUp(self):
+		fedvr = __import__("einpartikkel.core.fedvr", fromlist=["fedvr"])
+		self.GetGaussLobattoQuadrature = fedvr.GetGaussLobattoQuadrature
+		self.GetLagrangeDerivativeMatrix = fedvr.GetLagrangeDerivativeMatrix
+		self.NodeCounts = [2, 3, 5, 8, 12, 20]
+
+	def test_nodes(self):
+		for nodeCount in self.NodeCounts:
+			x, w, D = self.GetGaussLobattoQuadrature(nodeCount)
+			self.assertEqual(len(x), nodeCount)
+			self.assertAlmostEqual(x[0], -1.0, places=14)
+			self.assertAlmostEqual(x[-1], 1.0, places=14)
+			self.assert_((x[1:] > x[:-1]).all())
+			self.assert_(abs(x + x[::-1]).max() < 1e-14)
+
+	def test_known_weights(self):
+		x, w, D = self.GetGaussLobattoQuadrature(3)
+		self.assert_(abs(w - [1/3., 4/3., 1/3.]).max() < 1e-14)
+		x, w, D = self.GetGaussLobattoQuadrature(4)
+		self.assert_(abs(w - [1/6., 5/6., 5/6., 1/6.]).max() < 1e-14)
+
+	def test_weights(self):
+		#Gauss-Lobatto with N + 1 nodes is exact for degree 2N - 1
+		for nodeCount in self.NodeCounts:
+			x, w, D = self.GetGaussLobattoQuadrature(nodeCount)
+			self.assertAlmostEqual(w.sum(), 2.0, places=13)
+			self.assert_((w > 0).all())
+			for degree in range(2 * nodeCount - 2):
+				exact = 0.0 if degree % 2 else 2. / (degree + 1)
+				self.assertAlmostEqual(dot(w, x**degree), exact, places=12)
+
+	def test_derivative_matrix(self):
+		#Exact for polynomials of degree <= N
+		for nodeCount in self.NodeCounts:
+			x, w, D = self.GetGaussLobattoQuadrature(nodeCount)
+			for degree in range(nodeCount):
+				derivative = degree * x**(degree - 1) if degree > 0 else zeros(nodeCount)
+				error = abs(dot(D, x**degree) - derivative).max()
+				self.assert_(error < 1e-10 * nodeCount**2, \
+					"degree %i on %i nodes differs by %e" % (degree, nodeCount, error))
+
+	def test_derivative_matrix_general_nodes(self):
+		for nodeCount in self.NodeCounts:
+			x, w, D = self.GetGaussLobattoQuadrature(nodeCount)
+			self.assert_(abs(D - self.GetLagrangeDerivativeMatrix(x)).max() < 1e-10 * nodeCount**2)
+
+	def test_kinetic_symmetry(self):
+		#Integration by parts: sum_k w_k f_i'(x_k) f_j'(x_k) is symmetric
+		#and annihilates constants
+		x, w, D = self.GetGaussLobattoQuadrature(10)
+		T = dot(D.transpose() * w, D)
+		self.assert_(abs(T - T.transpose()).max() < 1e-11)
+		self.assert_(abs(T.sum(axis=1)).max() < 1e-10)
+
+	def test_too_few_nodes(self):
+		self.assertRaises(Exception, self.GetGaussLobattoQuadrature, 1)
+
+
+if __name__ == "__main__":
+	unittest.main()
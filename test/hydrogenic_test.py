@@ -0,0 +1,61 @@
+import sys
+import unittest
+sys.path.append("..")
+from numpy import exp, sqrt, linspace
+import scipy.integrate
+
+
+class TestHydrogenicRadialFunctions(unittest.TestCase):
+	"""
+	Test the analytic hydrogenic radial functions u_nl(r) = r R_nl(r)
+	"""
+
+	def setUp(self):
+		hydrogenic = __import__("einpartikkel.eigenvalues.hydrogenic", fromlist=["hydrogenic"])
+		self.GetRadialFunction = hydrogenic.GetHydrogenicRadialFunction
+		self.GetEnergy = hydrogenic.GetHydrogenicEnergy
+
+	def Integrate(self, f, rmax):
+		return scipy.integrate.quad(f, 0, rmax, limit=400)[0]
+
+	def test_explicit_functions(self):
+		r = linspace(0, 20, 41)
+		for charge in [1.0, 2.0]:
+			Z = charge
+			u10 = 2 * Z**1.5 * r * exp(-Z * r)
+			u20 = Z**1.5 / sqrt(2.) * r * (1 - Z * r / 2) * exp(-Z * r / 2)
+			u21 = Z**2.5 / (2 * sqrt(6.)) * r**2 * exp(-Z * r / 2)
+			for (n, l), u in [((1, 0), u10), ((2, 0), u20), ((2, 1), u21)]:
+				diff = abs(self.GetRadialFunction(n, l, r, charge) - u).max()
+				self.assert_(diff < 1e-12, "u_%i%i (Z = %s) differs by %e" % (n, l, charge, diff))
+
+	def test_orthonormality(self):
+		for charge in [1.0, 3.0]:
+			for l in [0, 1, 4]:
+				for n1 in range(l + 1, l + 5):
+					for n2 in range(n1, l + 5):
+						overlap = self.Integrate(lambda r: self.GetRadialFunction(n1, l, r, charge) * \
+							self.GetRadialFunction(n2, l, r, charge), (10. * n2**2 + 20) / charge)
+						self.assertAlmostEqual(overlap, 1.0 if n1 == n2 else 0.0, places=8)
+
+	def test_positive_at_origin(self):
+		for n in range(1, 6):
+			for l in range(n):
+				self.assert_(self.GetRadialFunction(n, l, 1e-3) > 0)
+
+	def test_large_quantum_numbers(self):
+		#Normalization factor computed in log space, no overflow. The
+		#state extends to about 2 n^2
+		norm = self.Integrate(lambda r: self.GetRadialFunction(40, 20, r)**2, 8000.)
+		self.assertAlmostEqual(norm, 1.0, places=6)
+
+	def test_invalid_quantum_numbers(self):
+		self.assertRaises(Exception, self.GetRadialFunction, 2, 2, 1.0)
+
+	def test_energy(self):
+		self.assertAlmostEqual(self.GetEnergy(1), -0.5)
+		self.assertAlmostEqual(self.GetEnergy(3, charge=2.0), -2. / 9.)
+
+
+if __name__ == "__main__":
+	unittest.main()
@@ -0,0 +1,55 @@
+import sys
+import os
+import tempfile
+import unittest
+sys.path.append("..")
+
+
+class TestSampledLaserPulse(unittest.TestCase):
+	"""
+	Test that sampled pulse components are switched off outside the sampled
+	window, also when the first and last samples are not zero
+	"""
+
+	def setUp(self):
+		laserpulse = __import__("einpartikkel.core.laserpulse", fromlist=["laserpulse"])
+		self.LaserPulse = laserpulse.LaserPulse
+
+		handle, self.Filename = tempfile.mkstemp(suffix=".txt")
+		sampleFile = os.fdopen(handle, "w")
+		sampleFile.write("# t value\n0 0.5\n1 1.0\n2 1.0\n3 0.8\n")
+		sampleFile.close()
+
+	def tearDown(self):
+		os.remove(self.Filename)
+
+	def CreatePulse(self, isField, delay=0.0):
+		pulse = self.LaserPulse()
+		pulse.AddSampledComponent(self.Filename, isField, 1.0, delay)
+		return pulse
+
+	def test_sampled_field_past_end(self):
+		pulse = self.CreatePulse(True)
+		endPotential = pulse.GetVectorPotential(3.0)
+		self.assert_(endPotential < -2.0)
+		for t in [3.5, 10.0, 1000.0]:
+			self.assertEqual(pulse.GetField(t), 0.0)
+			self.assertAlmostEqual(pulse.GetVectorPotential(t), endPotential, places=12)
+
+	def test_sampled_field_before_start(self):
+		pulse = self.CreatePulse(True, delay=5.0)
+		for t in [-100.0, 0.0, 4.5]:
+			self.assertEqual(pulse.GetField(t), 0.0)
+			self.assertEqual(pulse.GetVectorPotential(t), 0.0)
+		self.assertAlmostEqual(pulse.GetField(6.0), 1.0, places=12)
+
+	def test_sampled_vector_potential_outside(self):
+		pulse = self.CreatePulse(False)
+		for t in [-10.0, 3.5, 1000.0]:
+			self.assertEqual(pulse.GetField(t), 0.0)
+		self.assertAlmostEqual(pulse.GetVectorPotential(-10.0), 0.5, places=12)
+		self.assertAlmostEqual(pulse.GetVectorPotential(1000.0), 0.8, places=12)
+
+
+if __name__ == "__main__":
+	unittest.main()